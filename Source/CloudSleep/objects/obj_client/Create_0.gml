@@ -37,6 +37,9 @@ MyCanUseSleeperId = function(sleeperId) {
 
 myTextBox = noone;
 
+noticeText = "";
+noticeTime = 0;
+
 textboxPlaceHolders = [
 	"说点什么吧，我亲爱的" + myName + " (づ￣ 3￣)づ",
 	"早上好" + myName + "！或者……晚上好？",
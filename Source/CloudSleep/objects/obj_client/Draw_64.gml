@@ -11,3 +11,7 @@ if(myTextBox != noone) {
 draw_set_alpha(1.0);
 draw_set_color(c_white);
 
+if(noticeTime > 0) {
+	noticeTime--;
+	DrawChat(display_get_gui_width() / 2, 64, noticeText);
+}
@@ -73,6 +73,12 @@ if(map[? "type"] == network_type_data) {
 				
 				sleepers[mesSleeperId].MyChat(params);
 				break;
+			case CommandType.whisper:
+				// 悄悄话只有对方和自己收得到，气泡照样冒在说话的人头上
+				if(!MyCanUseSleeperId(mesSleeperId)) break;
+				
+				sleepers[mesSleeperId].MyChat(params[1]);
+				break;
 			
 			case CommandType.move:
 				if(!MyCanUseSleeperId(mesSleeperId)) break;
@@ -104,6 +110,33 @@ if(map[? "type"] == network_type_data) {
 					instance_destroy(obj_kickShowVotes);
 				}
 				break;
+			
+			case CommandType.ping:
+				SendPong();
+				break;
+			
+			case CommandType.full:
+				switch(params[0]) {
+					case 2: show_message("同一个 IP 连接的人太多了，请稍后再试！！！"); break;
+					case 4: show_message("你已经被管理员拉黑了！！！"); break;
+					default: show_message("服务器满员了，请稍后再试！！！"); break;
+				}
+				game_restart();
+				break;
+				
+			case CommandType.redirect:
+				// 这台服务器快满了，换到它推荐的服务器上去
+				network_destroy(socket);
+				serverIP = params[0];
+				serverPort = params[1];
+				room_goto(rm_connect);
+				break;
+				
+			case CommandType.notice:
+				// 服务器发来的通知（别的服务器上的聊天、全服公告），在屏幕上方显示一会儿
+				noticeText = params;
+				noticeTime = 7 * 60; // 七秒后消失
+				break;
 		}
 	}
 }
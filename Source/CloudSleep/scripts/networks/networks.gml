@@ -78,6 +78,10 @@ function SendChat(_chatStr) {
 	sendMessageQueue.push_back(CommandMakeMessage(CommandType.chat, _chatStr));
 }
 
+function SendWhisper(_sleeperId, _chatStr) {
+	sendMessageQueue.push_back(CommandMakeMessage(CommandType.whisper, [_sleeperId, _chatStr]));
+}
+
 function SendMove(_x, _y) {
 	sendMessageQueue.push_back(CommandMakeMessage(CommandType.move, [round(_x), round(_y)]));
 }
@@ -98,3 +102,8 @@ function SendRefuse() {
 	sendMessageQueue.push_back(CommandMakeMessage(CommandType.refuse));
 }
 
+// 回应服务器的心跳，服务器太久收不到消息会把连接断开
+function SendPong() {
+	sendMessageQueue.push_back(CommandMakeMessage(CommandType.pong));
+}
+
@@ -12,6 +12,7 @@ enum CommandType {
 	getup,
 	
 	chat,
+	whisper,
 	
 	move,
 	pos,
@@ -21,6 +22,13 @@ enum CommandType {
 	refuse,
 	kickover,
 	
+	ping,
+	pong,
+	
+	full,
+	redirect,
+	notice,
+	
 };
 
 function GetCommandTypeFromString(buf) {
@@ -44,6 +52,8 @@ function GetCommandTypeFromString(buf) {
 			
 		case "chat":
 			return CommandType.chat;
+		case "whisper":
+			return CommandType.whisper;
 			
 		case "move":
 			return CommandType.move;
@@ -58,6 +68,18 @@ function GetCommandTypeFromString(buf) {
 			return CommandType.refuse;
 		case "kickover":
 			return CommandType.kickover;
+			
+		case "ping":
+			return CommandType.ping;
+		case "pong":
+			return CommandType.pong;
+			
+		case "full":
+			return CommandType.full;
+		case "redirect":
+			return CommandType.redirect;
+		case "notice":
+			return CommandType.notice;
 	}
 	
 	return CommandType.unknown;
@@ -139,6 +161,17 @@ function CommandParse(stringWhichNeedsToParse) {
 			result[1] = strTemp;
 			break;
 			
+		case CommandType.whisper:
+		// result[1][0] = 对方的睡客id (int)
+		// result[1][1] = 悄悄话内容 (string)
+			var _colonPos = string_pos(":", strTemp);
+			if(_colonPos < 2 || string_length(string_digits(string_copy(strTemp, 1, _colonPos - 1))) < 1) {
+				result[0] = CommandType.unknown;
+				break;
+			}
+			result[1] = [real(string_digits(string_copy(strTemp, 1, _colonPos - 1))), string_delete(strTemp, 1, _colonPos)];
+			break;
+			
 		case CommandType.move:
 		case CommandType.pos:
 		// result[1][0] = x坐标 (int)
@@ -200,6 +233,31 @@ function CommandParse(stringWhichNeedsToParse) {
 			break;
 		case CommandType.kickover:
 			break;
+			
+		case CommandType.ping:
+		// 无 result[1]
+			break;
+			
+		case CommandType.full:
+		// result[1][0] = 被拒绝的原因 (int)
+			result[1][0] = real(string_digits(strTemp));
+			break;
+			
+		case CommandType.redirect:
+		// result[1][0] = 新服务器的IP (string)
+		// result[1][1] = 新服务器的端口 (int)
+			var _colonPos = string_last_pos(":", strTemp);
+			if(_colonPos < 1 || string_length(string_digits(string_delete(strTemp, 1, _colonPos))) < 1) {
+				result[0] = CommandType.unknown;
+				break;
+			}
+			result[1] = [string_copy(strTemp, 1, _colonPos - 1), real(string_digits(string_delete(strTemp, 1, _colonPos)))];
+			break;
+			
+		case CommandType.notice:
+		// result[1] = 通知内容 (string)
+			result[1] = strTemp;
+			break;
 	}
 	
 	return result;
@@ -238,6 +296,9 @@ function CommandMakeMessage(_CommandType, params = undefined) {
 		case CommandType.chat:
 			res += "chat$" + params;
 			break;
+		case CommandType.whisper:
+			res += "whisper$" + string(params[0]) + ":" + params[1];
+			break;
 			
 		case CommandType.move:
 			res += "move$" + string(params[0]) + "," + string(params[1]);
@@ -260,6 +321,12 @@ function CommandMakeMessage(_CommandType, params = undefined) {
 			
 		case CommandType.kickover:
 			break;
+			
+		case CommandType.ping:
+			break;
+		case CommandType.pong:
+			res += "pong$";
+			break;
 	}
 	
 	return res;
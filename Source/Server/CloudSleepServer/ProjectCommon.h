@@ -5,3 +5,7 @@
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
 #endif // !MAX
 
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif // !MIN
+
@@ -0,0 +1,562 @@
+#include "WheatAdminConsole.h"
+#include "ProjectCommon.h"
+#include "WheatAffinity.h"
+#include "WheatTCPServer.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// ̨䣬С߳ŶУ¼ѭÿתһȦȡһ
+// Сһֱڶ stdin ϣûͣⲻͷţ˳ǰһֱ
+struct WheatStdinMailbox {
+	std::mutex mutex;
+	std::vector<std::string> lines;
+};
+
+static WheatStdinMailbox * GetStdinMailbox()
+{
+	static WheatStdinMailbox * s_pMailbox = new WheatStdinMailbox();
+	return s_pMailbox;
+}
+
+static const char * GetSessionStateName(WheatSession::State state)
+{
+	switch(state) {
+		case WheatSession::State::Free:		return "free";
+		case WheatSession::State::Ready:	return "ready";
+		case WheatSession::State::Running:	return "running";
+		case WheatSession::State::WaitRead:	return "read";
+		case WheatSession::State::Done:		return "done";
+	}
+	return "?";
+}
+
+WheatAdminConsole::WheatAdminConsole(WheatRoom * pRoom, WheatSessionScheduler * pSessions, WheatAdmission * pAdmission)
+{
+	m_pRoom = pRoom;
+	m_pSessions = pSessions;
+	m_pAdmission = pAdmission;
+}
+
+WheatAdminConsole::~WheatAdminConsole()
+{
+	for(AdminClient & client : m_clients) {
+		CloseClient(client);
+	}
+	if(m_listenSocket != INVALID_SOCKET) {
+		closesocket(m_listenSocket);
+	}
+}
+
+bool WheatAdminConsole::Start(int port, int stdinCpu)
+{
+	std::thread([stdinCpu]() {
+		WheatAffinity::PinCurrentThread(stdinCpu);
+
+		char line[WHEATADMIN_LINE_SIZE];
+		while(fgets(line, sizeof(line), stdin) != nullptr) {
+			WheatStdinMailbox * pMailbox = GetStdinMailbox();
+			std::lock_guard<std::mutex> lock(pMailbox->mutex);
+			pMailbox->lines.push_back(line);
+		}
+	}).detach();
+
+	if(port == 0) {
+		return true;
+	}
+
+	m_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(m_listenSocket == INVALID_SOCKET) {
+		printf("Admin socket Error!! %d\n", WSAGetLastError());
+		return false;
+	}
+
+	// ֻã
+	sockaddr_in address;
+	memset(& address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.S_un.S_addr = htonl(INADDR_LOOPBACK);
+
+	if(bind(m_listenSocket, (sockaddr *)& address, sizeof(address)) == SOCKET_ERROR || listen(m_listenSocket, WHEATADMIN_MAX_CLIENTS) == SOCKET_ERROR) {
+		printf("Admin Port %d bind/listen Error!! %d\n", port, WSAGetLastError());
+		closesocket(m_listenSocket);
+		m_listenSocket = INVALID_SOCKET;
+		return false;
+	}
+
+	printf("Admin Console Listening On 127.0.0.1:%d.\n", port);
+	return true;
+}
+
+void WheatAdminConsole::AddToFdSet(fd_set * pReadSet)
+{
+	if(m_listenSocket != INVALID_SOCKET) {
+		FD_SET(m_listenSocket, pReadSet);
+	}
+	for(AdminClient & client : m_clients) {
+		if(client.sock != INVALID_SOCKET) {
+			FD_SET(client.sock, pReadSet);
+		}
+	}
+}
+
+void WheatAdminConsole::Poll(fd_set * pReadSet)
+{
+	if(m_listenSocket != INVALID_SOCKET && FD_ISSET(m_listenSocket, pReadSet)) {
+		FD_CLR(m_listenSocket, pReadSet);
+		AcceptClient();
+	}
+
+	for(AdminClient & client : m_clients) {
+		if(client.sock == INVALID_SOCKET || FD_ISSET(client.sock, pReadSet) == false) {
+			continue;
+		}
+		FD_CLR(client.sock, pReadSet);
+		if(ReceiveFrom(client) == false) {
+			CloseClient(client);
+		}
+	}
+
+	// ̨õֻУִеʱѾſ
+	std::vector<std::string> lines;
+	{
+		WheatStdinMailbox * pMailbox = GetStdinMailbox();
+		std::lock_guard<std::mutex> lock(pMailbox->mutex);
+		if(pMailbox->lines.empty()) {
+			return;
+		}
+		lines.swap(pMailbox->lines);
+	}
+
+	for(std::string & line : lines) {
+		std::string out;
+		Execute(line.c_str(), & out);
+		fputs(out.c_str(), stdout);
+	}
+}
+
+void WheatAdminConsole::AcceptClient()
+{
+	SOCKET sock = accept(m_listenSocket, nullptr, nullptr);
+	if(sock == INVALID_SOCKET) {
+		return;
+	}
+
+	for(AdminClient & client : m_clients) {
+		if(client.sock == INVALID_SOCKET) {
+			client.sock = sock;
+			client.lineLen = 0;
+			client.overflow = false;
+
+			const char * welcome = "CloudSleep Admin Console, type help for commands.\r\n";
+			send(sock, welcome, int(strlen(welcome)), 0);
+			return;
+		}
+	}
+
+	const char * busy = "Too Many Admins.\r\n";
+	send(sock, busy, int(strlen(busy)), 0);
+	closesocket(sock);
+}
+
+bool WheatAdminConsole::ReceiveFrom(AdminClient & client)
+{
+	char buf[WHEATADMIN_LINE_SIZE];
+	int recvRes = recv(client.sock, buf, sizeof(buf), 0);
+	if(recvRes == SOCKET_ERROR || recvRes == 0) {
+		return false;
+	}
+
+	for(int i = 0; i < recvRes; i++) {
+		if(buf[i] != '\n') {
+			if(client.lineLen + 1 < sizeof(client.line)) {
+				client.line[client.lineLen++] = buf[i];
+			} else {
+				client.overflow = true;
+			}
+			continue;
+		}
+
+		client.line[client.lineLen] = '\0';
+		std::string out;
+		if(client.overflow) {
+			out = "Line Too Long!\r\n";
+		} else {
+			Execute(client.line, & out);
+		}
+		client.lineLen = 0;
+		client.overflow = false;
+
+		// telnet Ҫ \r\n Żص
+		std::string reply;
+		for(char c : out) {
+			if(c == '\n') {
+				reply += '\r';
+			}
+			reply += c;
+		}
+		if(send(client.sock, reply.c_str(), int(reply.size()), 0) == SOCKET_ERROR) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void WheatAdminConsole::CloseClient(AdminClient & client)
+{
+	if(client.sock != INVALID_SOCKET) {
+		closesocket(client.sock);
+		client.sock = INVALID_SOCKET;
+	}
+}
+
+void WheatAdminConsole::Execute(const char * line, std::string * pOut)
+{
+	// Σ 1 2
+	char buf[WHEATADMIN_LINE_SIZE];
+	strncpy(buf, line, sizeof(buf) - 1);
+	buf[sizeof(buf) - 1] = '\0';
+
+	const char * words[3] = { "", "", "" };
+	int wordNum = 0;
+	for(char * p = strtok(buf, " \t\r\n"); p != nullptr && wordNum < 3; p = strtok(nullptr, " \t\r\n")) {
+		words[wordNum++] = p;
+	}
+
+	const char * command = words[0];
+	if(wordNum == 0) {
+		return;
+	} else if(strcmp(command, "help") == 0) {
+		CommandHelp(pOut);
+	} else if(strcmp(command, "list") == 0) {
+		CommandList(pOut);
+	} else if(strcmp(command, "stats") == 0) {
+		CommandStats(pOut);
+	} else if(strcmp(command, "top") == 0) {
+		CommandTop(words[1], words[2], pOut);
+	} else if(strcmp(command, "queues") == 0) {
+		CommandQueues(pOut);
+	} else if(strcmp(command, "kick") == 0) {
+		CommandKick(words[1], pOut);
+	} else if(strcmp(command, "ban") == 0) {
+		CommandBan(words[1], pOut);
+	} else if(strcmp(command, "unban") == 0) {
+		CommandUnban(words[1], pOut);
+	} else if(strcmp(command, "trace") == 0) {
+		CommandTrace(words[1], pOut);
+	} else if(strcmp(command, "latency") == 0) {
+		CommandLatency(words[1], pOut);
+	} else if(strcmp(command, "tracedump") == 0) {
+		CommandTraceDump(words[1], pOut);
+	} else if(strcmp(command, "bus") == 0) {
+		CommandBus(pOut);
+	} else if(strcmp(command, "announce") == 0) {
+		// пո
+		const char * text = strstr(line, "announce") + strlen("announce");
+		while(*text == ' ' || *text == '\t') {
+			text++;
+		}
+		CommandAnnounce(text, pOut);
+	} else if(strcmp(command, "tls") == 0) {
+		CommandTls(pOut);
+	} else {
+		WheatPrintf(pOut, "Unknown Command: %s, type help for commands.\n", command);
+	}
+}
+
+void WheatAdminConsole::CommandHelp(std::string * pOut)
+{
+	WheatPrintf(pOut, "help                    show this help\n");
+	WheatPrintf(pOut, "list                    list all sleepers\n");
+	WheatPrintf(pOut, "stats                   room, connection, admission, allocation and handler stats\n");
+	WheatPrintf(pOut, "top [n] [bytes|msgs]    sleepers who sent the most (default %d, by bytes)\n", WHEATADMIN_TOP_NUM);
+	WheatPrintf(pOut, "queues                  buffered bytes, pending messages and unsent bytes of every connection\n");
+	WheatPrintf(pOut, "kick <sleeperId>        disconnect a sleeper\n");
+	WheatPrintf(pOut, "ban [ip|sleeperId]      ban an ip and kick everyone from it, no argument lists banned ips\n");
+	WheatPrintf(pOut, "unban <ip>              unban an ip\n");
+	WheatPrintf(pOut, "trace [on|off]          print every received message\n");
+	WheatPrintf(pOut, "latency [reset]         recv to last send latency of sampled messages\n");
+	WheatPrintf(pOut, "tracedump [file]        write sampled messages as chrome trace json (default %s)\n", WHEATADMIN_TRACE_FILE);
+	WheatPrintf(pOut, "bus                     message bus stats and sleepers on other nodes\n");
+	WheatPrintf(pOut, "announce <text>         send a notice to everyone on every node\n");
+	WheatPrintf(pOut, "tls                     tls handshakes, resumptions and encryption cost\n");
+}
+
+void WheatAdminConsole::CommandList(std::string * pOut)
+{
+	WheatBedManager & bedManager = m_pRoom->m_bedManager;
+
+	int sleeperNum = 0;
+	WheatPrintf(pOut, "%-6s %-8s %-16s %-5s %-5s %-12s %-20s\n", "id", "socket", "ip", "type", "bed", "pos", "name");
+	for(size_t i = 0; i < bedManager.m_sleepers.size(); i++) {
+		Sleeper & sleeper = bedManager.m_sleepers[i];
+		if(sleeper.empty) {
+			continue;
+		}
+		sleeperNum++;
+
+		char pos[32];
+		snprintf(pos, sizeof(pos), "%d,%d", sleeper.posLastData.x, sleeper.posLastData.y);
+		WheatPrintf(pOut, "%-6zu %-8lld %-16s %-5s %-5d %-12s %-20s\n", i, static_cast<long long>(sleeper.sock), sleeper.IPADDRESS.c_str(), sleeper.type == SleeperType::Girl ? "girl" : "boy", sleeper.sleepingBedId, pos, sleeper.name.c_str());
+	}
+	WheatPrintf(pOut, "%d sleepers.\n", sleeperNum);
+}
+
+void WheatAdminConsole::CommandStats(std::string * pOut)
+{
+	int sleeperNum = m_pRoom->GetSleeperNum();
+
+	WheatPrintf(pOut, "----------- Room Stats ----------\n");
+	WheatPrintf(pOut, "sleepers          : %d\n", sleeperNum);
+	WheatPrintf(pOut, "spectators        : %zu\n", m_pRoom->GetSpectatorNum());
+	WheatPrintf(pOut, "crowd mode        : %s (%zu cells, %llu sends saved)\n", m_pRoom->IsCrowded() ? "on" : "off", m_pRoom->GetCrowdCellNum(), m_pRoom->GetCrowdSkippedSends());
+	WheatPrintf(pOut, "chat history      : %zu/%zu (%zu bytes)\n", m_pRoom->GetChatHistory().GetFrameNum(), m_pRoom->GetChatHistory().GetCapacity(), m_pRoom->GetChatHistory().GetByteNum());
+	WheatPrintf(pOut, "tick              : %d (%d ms)\n", m_pRoom->GetTickNum(), m_pRoom->GetServerMs());
+	WheatPrintf(pOut, "sessions          : %zu (%zu pooled)\n", m_pSessions->GetSessionNum(), m_pSessions->GetPooledSessionNum());
+	WheatPrintf(pOut, "voting            : %s\n", m_pRoom->m_voteKick.IsVoting() ? "yes" : "no");
+	WheatPrintf(pOut, "trace             : %s\n", m_pRoom->m_trace ? "on" : "off");
+	WheatPrintf(pOut, "latency sampling  : 1/%d (%llu traced)\n", m_pRoom->m_tracer.GetSampleEvery(), m_pRoom->m_tracer.GetTracedNum());
+
+	m_pRoom->m_metrics.PrintConnectionStats(pOut);
+	m_pAdmission->PrintStats(pOut);
+	m_pRoom->m_metrics.PrintAllocationStats(pOut);
+	m_pRoom->m_metrics.PrintHandlerStats(pOut);
+	if(m_pRoom->m_tracer.GetTracedNum() > 0) {
+		m_pRoom->m_metrics.PrintLatencyStats(pOut);
+	}
+	if(m_pGovernor != nullptr) {
+		m_pGovernor->PrintStats(pOut);
+	}
+}
+
+void WheatAdminConsole::CommandTop(const char * arg1, const char * arg2, std::string * pOut)
+{
+	// ˭˭
+	size_t topNum = WHEATADMIN_TOP_NUM;
+	bool byMessages = false;
+	for(const char * arg : { arg1, arg2 }) {
+		if(strcmp(arg, "msgs") == 0) {
+			byMessages = true;
+		} else if(atoi(arg) > 0) {
+			topNum = atoi(arg);
+		}
+	}
+
+	std::vector<Sleeper> & sleepers = m_pRoom->m_bedManager.m_sleepers;
+	std::vector<size_t> ids;
+	for(size_t i = 0; i < sleepers.size(); i++) {
+		if(sleepers[i].empty == false) {
+			ids.push_back(i);
+		}
+	}
+
+	topNum = MIN(topNum, ids.size());
+	std::partial_sort(ids.begin(), ids.begin() + topNum, ids.end(), [&](size_t a, size_t b) {
+		return byMessages ? sleepers[a].messagesIn > sleepers[b].messagesIn : sleepers[a].bytesIn > sleepers[b].bytesIn;
+	});
+
+	WheatPrintf(pOut, "%-6s %12s %12s %-16s %-20s\n", "id", "bytes", "msgs", "ip", "name");
+	for(size_t i = 0; i < topNum; i++) {
+		Sleeper & sleeper = sleepers[ids[i]];
+		WheatPrintf(pOut, "%-6zu %12llu %12llu %-16s %-20s\n", ids[i], sleeper.bytesIn, sleeper.messagesIn, sleeper.IPADDRESS.c_str(), sleeper.name.c_str());
+	}
+}
+
+void WheatAdminConsole::CommandQueues(std::string * pOut)
+{
+	// һѹڻỰĻһѹڷԱ
+	size_t totalBytes = 0;
+	size_t totalFrames = 0;
+	size_t totalUnsent = 0;
+	WheatPrintf(pOut, "%-8s %-16s %-8s %10s %8s %10s\n", "socket", "ip", "state", "buffered", "pending", "unsent");
+	for(WheatSession * pSession : m_pSessions->GetSessions()) {
+		size_t unsentBytes = m_pServer ? m_pServer->GetPendingSendBytes(pSession->GetSocket()) : 0;
+		totalBytes += pSession->GetBufferedBytes();
+		totalFrames += pSession->GetPendingFrameNum();
+		totalUnsent += unsentBytes;
+		if(pSession->GetBufferedBytes() == 0 && pSession->GetPendingFrameNum() == 0 && unsentBytes == 0) {
+			continue;
+		}
+		WheatPrintf(pOut, "%-8lld %-16s %-8s %10zu %8zu %10zu\n", static_cast<long long>(pSession->GetSocket()), pSession->GetIPAddress(), GetSessionStateName(pSession->GetState()), pSession->GetBufferedBytes(), pSession->GetPendingFrameNum(), unsentBytes);
+	}
+	WheatPrintf(pOut, "%zu sessions, %zu bytes buffered, %zu messages pending, %zu bytes unsent, %zu ready to run.\n", m_pSessions->GetSessionNum(), totalBytes, totalFrames, totalUnsent, m_pSessions->GetReadyNum());
+	WheatPrintf(pOut, "arena this loop: %zu / %zu bytes.\n", m_pRoom->GetArena().GetUsedBytes(), m_pRoom->GetArena().GetCapacity());
+}
+
+void WheatAdminConsole::CommandKick(const char * arg, std::string * pOut)
+{
+	WheatBedManager & bedManager = m_pRoom->m_bedManager;
+
+	char * pEnd = nullptr;
+	long sleeperId = strtol(arg, & pEnd, 10);
+	if(pEnd == arg || sleeperId < 0 || sleeperId >= static_cast<long>(bedManager.m_sleepers.size()) || bedManager.m_sleepers[sleeperId].empty) {
+		WheatPrintf(pOut, "No Such Sleeper: %s\n", arg);
+		return;
+	}
+
+	m_pRoom->CloseClient(bedManager.m_sleepers[sleeperId].sock);
+	WheatPrintf(pOut, "Sleeper %ld Kicked.\n", sleeperId);
+}
+
+void WheatAdminConsole::CommandBan(const char * arg, std::string * pOut)
+{
+	if(*arg == '\0') {
+		for(unsigned long bannedIP : m_pAdmission->GetBannedIPs()) {
+			in_addr address;
+			address.S_un.S_addr = bannedIP;
+			WheatPrintf(pOut, "%s\n", inet_ntoa(address));
+		}
+		WheatPrintf(pOut, "%zu ips banned.\n", m_pAdmission->GetBannedIPs().size());
+		return;
+	}
+
+	//  '.' ĵ ˯id IP
+	std::string ipAddress = arg;
+	if(strchr(arg, '.') == nullptr) {
+		WheatBedManager & bedManager = m_pRoom->m_bedManager;
+		long sleeperId = strtol(arg, nullptr, 10);
+		if(sleeperId < 0 || sleeperId >= static_cast<long>(bedManager.m_sleepers.size()) || bedManager.m_sleepers[sleeperId].empty) {
+			WheatPrintf(pOut, "No Such Sleeper: %s\n", arg);
+			return;
+		}
+		ipAddress = bedManager.m_sleepers[sleeperId].IPADDRESS;
+	}
+
+	unsigned long ip = inet_addr(ipAddress.c_str());
+	if(ip == INADDR_NONE) {
+		WheatPrintf(pOut, "Invalid IP: %s\n", ipAddress.c_str());
+		return;
+	}
+
+	m_pAdmission->Ban(ip);
+	int kickedNum = KickIP(ipAddress.c_str());
+	WheatPrintf(pOut, "%s Banned, %d Sleepers Kicked.\n", ipAddress.c_str(), kickedNum);
+}
+
+void WheatAdminConsole::CommandUnban(const char * arg, std::string * pOut)
+{
+	unsigned long ip = inet_addr(arg);
+	if(ip == INADDR_NONE || m_pAdmission->IsBanned(ip) == false) {
+		WheatPrintf(pOut, "Not Banned: %s\n", arg);
+		return;
+	}
+
+	m_pAdmission->Unban(ip);
+	WheatPrintf(pOut, "%s Unbanned.\n", arg);
+}
+
+void WheatAdminConsole::CommandTrace(const char * arg, std::string * pOut)
+{
+	if(strcmp(arg, "on") == 0) {
+		m_pRoom->m_trace = true;
+	} else if(strcmp(arg, "off") == 0) {
+		m_pRoom->m_trace = false;
+	} else if(*arg == '\0') {
+		m_pRoom->m_trace = m_pRoom->m_trace == false;
+	}
+	WheatPrintf(pOut, "Trace %s.\n", m_pRoom->m_trace ? "On" : "Off");
+}
+
+void WheatAdminConsole::CommandLatency(const char * arg, std::string * pOut)
+{
+	WheatTracer & tracer = m_pRoom->m_tracer;
+	if(strcmp(arg, "reset") == 0) {
+		m_pRoom->m_metrics.ResetLatencyStats();
+		tracer.Reset();
+		WheatPrintf(pOut, "Latency Stats Reset.\n");
+		return;
+	}
+
+	if(tracer.GetSampleEvery() == 0) {
+		WheatPrintf(pOut, "Latency Sampling Off, set latency_sample_every in config.\n");
+	} else {
+		WheatPrintf(pOut, "Sampling 1 of every %d messages, %llu traced.\n", tracer.GetSampleEvery(), tracer.GetTracedNum());
+	}
+	m_pRoom->m_metrics.PrintLatencyStats(pOut);
+}
+
+void WheatAdminConsole::CommandTraceDump(const char * arg, std::string * pOut)
+{
+	const char * path = *arg == '\0' ? WHEATADMIN_TRACE_FILE : arg;
+
+	std::string json;
+	m_pRoom->m_tracer.WriteChromeTrace(json);
+
+	FILE * fp = fopen(path, "wb");
+	if(fp == nullptr) {
+		WheatPrintf(pOut, "Cannot Open %s.\n", path);
+		return;
+	}
+	fwrite(json.data(), 1, json.size(), fp);
+	fclose(fp);
+
+	WheatPrintf(pOut, "%zu Traced Messages Written To %s.\n", m_pRoom->m_tracer.GetRecordNum(), path);
+}
+
+void WheatAdminConsole::CommandBus(std::string * pOut)
+{
+	if(m_pBus == nullptr) {
+		WheatPrintf(pOut, "Bus Disabled.\n");
+		return;
+	}
+
+	m_pBus->PrintStats(pOut);
+
+	int remoteSleeperNum = m_pRoom->GetRemoteSleeperNum();
+	for(auto & pair : m_pRoom->GetRemoteSleepers()) {
+		WheatPrintf(pOut, "  node %-28s sleepers %d\n", pair.first.c_str(), pair.second.first);
+	}
+	WheatPrintf(pOut, "%d sleepers here, %d on other nodes.\n", m_pRoom->GetSleeperNum(), remoteSleeperNum);
+}
+
+void WheatAdminConsole::CommandAnnounce(const char * text, std::string * pOut)
+{
+	// ȥβĻ
+	size_t len = strlen(text);
+	while(len > 0 && (text[len - 1] == '\r' || text[len - 1] == '\n')) {
+		len--;
+	}
+	if(len == 0) {
+		WheatPrintf(pOut, "Usage: announce <text>\n");
+		return;
+	}
+
+	m_pRoom->SendNotice(text, len);
+	if(m_pBus != nullptr) {
+		m_pBus->Publish(WHEATBUS_TOPIC_ANNOUNCE, text, len);
+	}
+	WheatPrintf(pOut, "Announced.\n");
+}
+
+int WheatAdminConsole::KickIP(const char * ipAddress)
+{
+	// ȼҪߵ socket˻ĶǼǱ
+	std::vector<SOCKET> socks;
+	for(Sleeper & sleeper : m_pRoom->m_bedManager.m_sleepers) {
+		if(sleeper.empty == false && sleeper.IPADDRESS == ipAddress) {
+			socks.push_back(sleeper.sock);
+		}
+	}
+
+	for(SOCKET sock : socks) {
+		m_pRoom->CloseClient(sock);
+	}
+	return static_cast<int>(socks.size());
+}
+
+void WheatAdminConsole::CommandTls(std::string * pOut)
+{
+	if(m_pTls == nullptr) {
+		WheatPrintf(pOut, "TLS Disabled.\n");
+		return;
+	}
+
+	m_pTls->PrintStats(pOut);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "WheatRoom.h"
+#include "WheatSession.h"
+#include "WheatAdmission.h"
+#include "WheatBus.h"
+#include "WheatTls.h"
+#include "WheatGovernor.h"
+
+#include <winsock.h>
+#include <string>
+
+// ˿ͬʱӴλԱ
+#define WHEATADMIN_MAX_CLIENTS 4
+
+// һйֽڣӵ
+#define WHEATADMIN_LINE_SIZE 256
+
+// top Ĭгλ˯
+#define WHEATADMIN_TOP_NUM 10
+
+// tracedump Ĭϰ Chrome trace дĸļ
+#define WHEATADMIN_TRACE_FILE "trace.json"
+
+class WheatTCPServer;
+
+// ֵྭάԱش "ô"г˯͡ͳơ˭˵ӻѹ˶Ϣˡ IP򿪹Ϣ
+// Դ̨(stdin)ֻ 127.0.0.1 Ĺ˿ڣ telnet У
+//  stdin һֱţԽһֻܶС̣߳зŽ䣻¼ѭִ߳У
+// ķһһµģҪҲῨס˯
+class WheatAdminConsole {
+public:
+	WheatAdminConsole(WheatRoom * pRoom, WheatSessionScheduler * pSessions, WheatAdmission * pAdmission);
+	~WheatAdminConsole();
+
+	WheatAdminConsole(const WheatAdminConsole &) = delete;
+	WheatAdminConsole & operator=(const WheatAdminConsole &) = delete;
+
+	// ʼֵࣺ stdin ̣߳stdinCpu Ϊ -1 ʱǸ߼ϣport Ϊ 0 ʱ 127.0.0.1:port ϼ˿
+	bool Start(int port, int stdinCpu = -1);
+
+	// ѹ˿ں͹ԱӼӽ select Ҫļ
+	void AddToFdSet(fd_set * pReadSet);
+
+	// select Ժ¼ѭãӴµĹԱִյͿ̨
+	// ԺԼ socket  pReadSet õ¼ѭǵ˯͵
+	void Poll(fd_set * pReadSet);
+
+	// ִһ *pOut 
+	void Execute(const char * line, std::string * pOut);
+
+	// ϢߵĻԲ鿴ߵҲԷȫ
+	inline void SetBus(WheatBusClient * pBus) { m_pBus = pBus; }
+
+	//  TLS ĻԲ鿴ֺͼܵĿ
+	inline void SetTls(WheatTls * pTls) { m_pTls = pTls; }
+	// Ա stats ʾ
+	inline void SetGovernor(WheatGovernor * pGovernor) { m_pGovernor = pGovernor; }
+	// Ա queues ʾÿӻжֽûȥ
+	inline void SetServer(WheatTCPServer * pServer) { m_pServer = pServer; }
+
+private:
+
+	struct AdminClient {
+		SOCKET sock = INVALID_SOCKET;
+		char line[WHEATADMIN_LINE_SIZE];
+		size_t lineLen = 0;
+		bool overflow = false;		// һ̫ˣӵΪֹ
+	};
+
+	void AcceptClient();
+	// չԱݣչһоִУ false ʾӶϿ
+	bool ReceiveFrom(AdminClient & client);
+	void CloseClient(AdminClient & client);
+
+	void CommandHelp(std::string * pOut);
+	void CommandList(std::string * pOut);
+	void CommandStats(std::string * pOut);
+	void CommandTop(const char * arg1, const char * arg2, std::string * pOut);
+	void CommandQueues(std::string * pOut);
+	void CommandKick(const char * arg, std::string * pOut);
+	void CommandBan(const char * arg, std::string * pOut);
+	void CommandUnban(const char * arg, std::string * pOut);
+	void CommandTrace(const char * arg, std::string * pOut);
+	void CommandLatency(const char * arg, std::string * pOut);
+	void CommandTraceDump(const char * arg, std::string * pOut);
+	void CommandBus(std::string * pOut);
+	void CommandAnnounce(const char * text, std::string * pOut);
+	void CommandTls(std::string * pOut);
+
+	// ߳ IP ˯ͣ߳
+	int KickIP(const char * ipAddress);
+
+	WheatRoom * m_pRoom = nullptr;
+	WheatSessionScheduler * m_pSessions = nullptr;
+	WheatAdmission * m_pAdmission = nullptr;
+	WheatBusClient * m_pBus = nullptr;
+	WheatTls * m_pTls = nullptr;
+	WheatGovernor * m_pGovernor = nullptr;
+	WheatTCPServer * m_pServer = nullptr;
+
+	SOCKET m_listenSocket = INVALID_SOCKET;
+	AdminClient m_clients[WHEATADMIN_MAX_CLIENTS];
+};
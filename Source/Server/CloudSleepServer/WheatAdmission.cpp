@@ -0,0 +1,135 @@
+#include "WheatAdmission.h"
+#include "ProjectCommon.h"
+#include "WheatMetrics.h"
+
+#include <iostream>
+
+WheatAdmission::WheatAdmission(WheatClock * pClock, size_t hardMaxConnections)
+{
+	m_pClock = pClock;
+	m_hardMaxConnections = hardMaxConnections;
+
+	// տŵʱ
+	m_tokensMilli = static_cast<long long>(m_acceptBurst) * 1000;
+	m_lastRefillMs = m_pClock->NowMs();
+
+	SetLimits(m_maxConnections, m_maxPerIP, m_acceptsPerSecond, m_acceptBurst);
+}
+
+void WheatAdmission::SetLimits(size_t maxConnections, size_t maxPerIP, int acceptsPerSecond, int acceptBurst)
+{
+	// 糬 FD_SETSIZE  socket Ž fd_set ʱᱻĶԶղϢ
+	maxConnections = MIN(maxConnections, m_hardMaxConnections);
+
+	// ɵٶȰѵΪֹòƲϣٻµ
+	Refill();
+
+	m_maxConnections = maxConnections;
+	m_maxPerIP = maxPerIP;
+	m_acceptsPerSecond = acceptsPerSecond;
+	m_acceptBurst = MAX(acceptBurst, 1);
+
+	// иƣȸãһͰƣֻװµĲֵ
+	m_tokensMilli = MIN(m_tokensMilli, static_cast<long long>(m_acceptBurst) * 1000);
+
+	m_entries.reserve(m_maxConnections);
+}
+
+WheatAdmission::Result WheatAdmission::TryAdmit(SOCKET sock, unsigned long ipAddress)
+{
+	Result result = Result::Admitted;
+
+	Refill();
+
+	if(IsBanned(ipAddress)) {
+		result = Result::Banned;
+	} else if(m_entries.size() >= m_maxConnections) {
+		result = Result::ServerFull;
+	} else if(m_tokensMilli < 1000) {
+		result = Result::TooFast;
+	} else {
+		size_t sameIPNum = 0;
+		for(Entry & entry : m_entries) {
+			if(entry.ipAddress == ipAddress) {
+				sameIPNum++;
+			}
+		}
+		if(sameIPNum >= m_maxPerIP) {
+			result = Result::TooManyFromIP;
+		}
+	}
+
+	m_resultNum[static_cast<int>(result)]++;
+
+	if(result == Result::Admitted) {
+		m_tokensMilli -= 1000;
+		m_entries.push_back(Entry { sock, ipAddress });
+	}
+
+	return result;
+}
+
+void WheatAdmission::Release(SOCKET sock)
+{
+	for(size_t i = 0; i < m_entries.size(); i++) {
+		if(m_entries[i].sock == sock) {
+			m_entries[i] = m_entries.back();
+			m_entries.pop_back();
+			return;
+		}
+	}
+}
+
+void WheatAdmission::Ban(unsigned long ipAddress)
+{
+	if(IsBanned(ipAddress) == false) {
+		m_bannedIPs.push_back(ipAddress);
+	}
+}
+
+void WheatAdmission::Unban(unsigned long ipAddress)
+{
+	for(size_t i = 0; i < m_bannedIPs.size(); i++) {
+		if(m_bannedIPs[i] == ipAddress) {
+			m_bannedIPs[i] = m_bannedIPs.back();
+			m_bannedIPs.pop_back();
+			return;
+		}
+	}
+}
+
+bool WheatAdmission::IsBanned(unsigned long ipAddress)
+{
+	for(unsigned long bannedIP : m_bannedIPs) {
+		if(bannedIP == ipAddress) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void WheatAdmission::Refill()
+{
+	long long nowMs = m_pClock->NowMs();
+	long long passedMs = nowMs - m_lastRefillMs;
+	if(passedMs <= 0) {
+		return;
+	}
+	m_lastRefillMs = nowMs;
+
+	// ÿ벹 m_acceptsPerSecond / 1000 ƣҲ m_acceptsPerSecond  "ǧ֮һ"
+	long long maxTokensMilli = static_cast<long long>(m_acceptBurst) * 1000;
+	m_tokensMilli = MIN(maxTokensMilli, m_tokensMilli + passedMs * m_acceptsPerSecond);
+}
+
+void WheatAdmission::PrintStats(std::string * pOut)
+{
+	WheatPrintf(pOut, "-------- Admission Stats --------\n");
+	WheatPrintf(pOut, "connections       : %zu / %zu\n", m_entries.size(), m_maxConnections);
+	WheatPrintf(pOut, "admitted          : %llu\n", GetResultNum(Result::Admitted));
+	WheatPrintf(pOut, "server full       : %llu\n", GetResultNum(Result::ServerFull));
+	WheatPrintf(pOut, "too many from ip  : %llu\n", GetResultNum(Result::TooManyFromIP));
+	WheatPrintf(pOut, "too fast          : %llu\n", GetResultNum(Result::TooFast));
+	WheatPrintf(pOut, "banned            : %llu (%zu ips)\n", GetResultNum(Result::Banned), m_bannedIPs.size());
+	WheatPrintf(pOut, "---------------------------------\n");
+}
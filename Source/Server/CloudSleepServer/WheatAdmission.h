@@ -0,0 +1,90 @@
+#pragma once
+
+#include "WheatClock.h"
+
+#include <winsock.h>
+#include <vector>
+#include <string>
+
+// ȫͬʱжٸ
+#define WHEATADMISSION_MAX_CONNECTIONS 1000
+
+// ͬһ IP ͬʱжٸӣͬһɡ˯͹һ IP̫ܿ
+#define WHEATADMISSION_MAX_PER_IP 16
+
+// ÿŶٸӽţԼһܷŶٸ
+#define WHEATADMISSION_ACCEPTS_PER_SECOND 50
+#define WHEATADMISSION_ACCEPT_BURST 100
+
+// վ TCPԱ ſڣܲܽ
+// ˡͬһ IP ̫ࡢʱӿ̫ࡢ IP Աˣᱻ⣬ŵӲõݣҲŷ˯
+class WheatAdmission {
+public:
+
+	enum class Result {
+		Admitted,		// 
+		ServerFull,		// 
+		TooManyFromIP,	//  IP ̫
+		TooFast,		// ŵ̫ˣһ
+		Banned,			//  IP Ա
+		count
+	};
+
+	// hardMaxConnections ΪԱɵ select ֻܿ FD_SETSIZE  socketôƶᳬ
+	WheatAdmission(WheatClock * pClock = GetSystemClock(), size_t hardMaxConnections = WHEATADMISSION_MAX_CONNECTIONS);
+
+	// ƣmaxConnections ᱻ hardMaxConnections ڣҲʱģѾŵӲӰ
+	void SetLimits(size_t maxConnections, size_t maxPerIP, int acceptsPerSecond, int acceptBurst);
+
+	// µţipAddress Ϊֽ IPv4 ַ
+	// еĻǼӶϿʱҪ Release()
+	Result TryAdmit(SOCKET sock, unsigned long ipAddress);
+
+	// ӶϿˣλóûеǼǹʲô
+	void Release(SOCKET sock);
+
+	// /ųһ IPipAddress Ϊֽ IPv4 ַֻӰ֮ŵӣѾŵҪ߳ȥ
+	void Ban(unsigned long ipAddress);
+	void Unban(unsigned long ipAddress);
+	bool IsBanned(unsigned long ipAddress);
+	inline const std::vector<unsigned long> & GetBannedIPs() { return m_bannedIPs; }
+
+	inline size_t GetConnectionNum() { return m_entries.size(); }
+	inline size_t GetMaxConnections() { return m_maxConnections; }
+
+	// ΪԭĴ±Ϊ Result
+	inline unsigned long long GetResultNum(Result result) { return m_resultNum[static_cast<int>(result)]; }
+
+	// ӡŵͳƣpOut ˼ͬ WheatPrintf()
+	void PrintStats(std::string * pOut = nullptr);
+
+private:
+
+	struct Entry {
+		SOCKET sock;
+		unsigned long ipAddress;
+	};
+
+	// ʱͰﲹ
+	void Refill();
+
+	WheatClock * m_pClock = nullptr;
+
+	size_t m_hardMaxConnections = WHEATADMISSION_MAX_CONNECTIONS;
+	size_t m_maxConnections = WHEATADMISSION_MAX_CONNECTIONS;
+	size_t m_maxPerIP = WHEATADMISSION_MAX_PER_IP;
+
+	// ͰÿŽһõһƣư m_acceptsPerSecond ٶȲ䣬 m_acceptBurst 
+	int m_acceptsPerSecond = WHEATADMISSION_ACCEPTS_PER_SECOND;
+	int m_acceptBurst = WHEATADMISSION_ACCEPT_BURST;
+	long long m_tokensMilli = 0;	//  * 1000С
+	long long m_lastRefillMs = 0;
+
+	// Ѿŵӣ m_maxConnections һ׼
+	std::vector<Entry> m_entries;
+
+	// ɹԱֶάܳ
+	std::vector<unsigned long> m_bannedIPs;
+
+	unsigned long long m_resultNum[static_cast<int>(Result::count)] = {};
+};
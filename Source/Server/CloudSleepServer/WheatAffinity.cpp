@@ -0,0 +1,73 @@
+#include "WheatAffinity.h"
+#include "ProjectCommon.h"
+
+#include <winsock.h>
+#include <iostream>
+
+// ѱŻ (, ڱ)ųΧ false
+static bool ToProcessorNumber(int cpu, PROCESSOR_NUMBER * pNumber)
+{
+	if(cpu < 0) {
+		return false;
+	}
+
+	WORD groupNum = GetActiveProcessorGroupCount();
+	for(WORD group = 0; group < groupNum; group++) {
+		int groupCpuNum = static_cast<int>(GetActiveProcessorCount(group));
+		if(cpu < groupCpuNum) {
+			pNumber->Group = group;
+			pNumber->Number = static_cast<BYTE>(cpu);
+			pNumber->Reserved = 0;
+			return true;
+		}
+		cpu -= groupCpuNum;
+	}
+	return false;
+}
+
+bool WheatAffinity::PinCurrentThread(int cpu)
+{
+	if(cpu == -1) {
+		return true;
+	}
+
+	PROCESSOR_NUMBER number;
+	if(ToProcessorNumber(cpu, & number) == false) {
+		printf("CPU %d Does Not Exist, Only %d CPUs.\n", cpu, GetCpuNum());
+		return false;
+	}
+
+	GROUP_AFFINITY affinity;
+	memset(& affinity, 0, sizeof(affinity));
+	affinity.Group = number.Group;
+	affinity.Mask = static_cast<KAFFINITY>(1) << number.Number;
+	if(SetThreadGroupAffinity(GetCurrentThread(), & affinity, nullptr) == FALSE) {
+		printf("SetThreadGroupAffinity Failed! %lu\n", GetLastError());
+		return false;
+	}
+	return true;
+}
+
+int WheatAffinity::GetNumaNode(int cpu)
+{
+	PROCESSOR_NUMBER number;
+	if(ToProcessorNumber(cpu, & number) == false) {
+		return -1;
+	}
+
+	USHORT node = 0;
+	if(GetNumaProcessorNodeEx(& number, & node) == FALSE) {
+		return -1;
+	}
+	return static_cast<int>(node);
+}
+
+int WheatAffinity::GetCpuNum()
+{
+	int cpuNum = 0;
+	WORD groupNum = GetActiveProcessorGroupCount();
+	for(WORD group = 0; group < groupNum; group++) {
+		cpuNum += static_cast<int>(GetActiveProcessorCount(group));
+	}
+	return cpuNum;
+}
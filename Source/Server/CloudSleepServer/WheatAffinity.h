@@ -0,0 +1,16 @@
+#pragma once
+
+// Ա߳λ̶ָ߳߼ϣϵͳŲŲȥӺͷһֱȵ
+// ߼ 0 ʼαţ 0  0..63ŵ 1  0..63Դƣ 64 ˵ĻҲ
+class WheatAffinity {
+public:
+
+	// ѵǰ̶߳ڵ cpu ߼ϣcpu Ϊ -1 ʱʲôʧܷ false
+	static bool PinCurrentThread(int cpu);
+
+	//  cpu ߼ĸ NUMA ڵϣ֪Ļ -1
+	static int GetNumaNode(int cpu);
+
+	// һжٸ߼
+	static int GetCpuNum();
+};
@@ -0,0 +1,101 @@
+#include "WheatArena.h"
+#include "ProjectCommon.h"
+
+#include <cstring>
+
+WheatArena::~WheatArena()
+{
+	Chunk * pChunk = m_pFirst;
+	while(pChunk != nullptr) {
+		Chunk * pNext = pChunk->pNext;
+		delete [] reinterpret_cast<char *>(pChunk);
+		pChunk = pNext;
+	}
+}
+
+void * WheatArena::Allocate(size_t size, size_t align)
+{
+	// ӵǰ鿪ʼңҵܷµĿΪֹŲ¾ͽһµ
+	Chunk * pChunk = m_pCurrent;
+	while(pChunk != nullptr) {
+		size_t offset = (pChunk->used + align - 1) & ~(align - 1);
+		if(offset + size <= pChunk->size) {
+			pChunk->used = offset + size;
+			m_pCurrent = pChunk;
+			return pChunk->data + offset;
+		}
+		pChunk = pChunk->pNext;
+	}
+
+	// ¿ڿͷ棬ͷС max_align_t 㱾Ƕ
+	pChunk = NewChunk(size);
+	pChunk->used = size;
+	m_pCurrent = pChunk;
+	return pChunk->data;
+}
+
+char * WheatArena::CopyString(const char * str, size_t len)
+{
+	char * dest = static_cast<char *>(Allocate(len + 1, 1));
+	memcpy(dest, str, len);
+	dest[len] = '\0';
+	return dest;
+}
+
+void WheatArena::Reset()
+{
+	for(Chunk * pChunk = m_pFirst; pChunk != nullptr; pChunk = pChunk->pNext) {
+		pChunk->used = 0;
+	}
+	m_pCurrent = m_pFirst;
+}
+
+size_t WheatArena::GetUsedBytes()
+{
+	// ǰĿһﻹûù
+	size_t used = 0;
+	for(Chunk * pChunk = m_pFirst; pChunk != nullptr; pChunk = pChunk->pNext) {
+		used += pChunk->used;
+		if(pChunk == m_pCurrent) {
+			break;
+		}
+	}
+	return used;
+}
+
+size_t WheatArena::GetCapacity()
+{
+	size_t capacity = 0;
+	for(Chunk * pChunk = m_pFirst; pChunk != nullptr; pChunk = pChunk->pNext) {
+		capacity += pChunk->size;
+	}
+	return capacity;
+}
+
+WheatArena::Chunk * WheatArena::NewChunk(size_t minSize)
+{
+	size_t size = MAX(m_chunkSize, minSize);
+
+	// ͷݷͬһ
+	static_assert(sizeof(Chunk) % alignof(std::max_align_t) == 0, "Chunk header must keep data aligned");
+	char * raw = new char[sizeof(Chunk) + size];
+	Chunk * pChunk = reinterpret_cast<Chunk *>(raw);
+	pChunk->pNext = nullptr;
+	pChunk->size = size;
+	pChunk->used = 0;
+	pChunk->data = raw + sizeof(Chunk);
+	m_chunkNum++;
+
+	// 
+	if(m_pFirst == nullptr) {
+		m_pFirst = pChunk;
+	} else {
+		Chunk * pLast = m_pFirst;
+		while(pLast->pNext != nullptr) {
+			pLast = pLast->pNext;
+		}
+		pLast->pNext = pChunk;
+	}
+
+	return pChunk;
+}
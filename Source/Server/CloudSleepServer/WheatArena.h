@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+// ÿһڴĬϴС
+#define WHEATARENA_CHUNK_SIZE (64 * 1024)
+
+// ʱֿԱרŴŻһִʱݣ̫Ųָݣ
+// ҪڴʱֻǰָŲһŲԺһ Reset() ȫϣһһػȫֶ
+// ֿڴֻReset() ԺŸһãȶԺ󲻻ȫֶҪڴ
+class WheatArena {
+public:
+	WheatArena(size_t chunkSize = WHEATARENA_CHUNK_SIZE) { m_chunkSize = chunkSize; }
+	~WheatArena();
+
+	WheatArena(const WheatArena &) = delete;
+	WheatArena & operator=(const WheatArena &) = delete;
+
+	//  size ֽڣ align 룬Reset() ֮ǰһֱЧ
+	void * Allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+	// һַβ '\0'
+	char * CopyString(const char * str, size_t len);
+
+	// ڴ棬ڴ
+	void Reset();
+
+	// ϴ Reset() Ժһõ˶ֽڣ˷ѵĲ֣
+	size_t GetUsedBytes();
+	// ڴһжֽ
+	size_t GetCapacity();
+	// ȫֶҪڴ飬ȶԺӦò
+	inline size_t GetChunkNum() { return m_chunkNum; }
+
+private:
+	struct Chunk {
+		Chunk * pNext;
+		size_t size;
+		size_t used;
+		char * data;
+	};
+
+	Chunk * NewChunk(size_t minSize);
+
+	size_t m_chunkSize;
+
+	Chunk * m_pFirst = nullptr;
+	Chunk * m_pCurrent = nullptr;
+
+	size_t m_chunkNum = 0;
+};
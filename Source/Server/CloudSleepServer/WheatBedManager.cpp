@@ -1,18 +1,23 @@
 #include "WheatBedManager.h"
 #include "ProjectCommon.h"
 
+WheatBedManager::WheatBedManager()
+{
+	m_sleepers.reserve(SLEEPER_RESERVED_NUM);
+}
+
 void WheatBedManager::GetupBed(int getupBedSleepId)
 {
 	m_arrBeds[getupBedSleepId].Clear();
 }
 
-bool WheatBedManager::SleepBed(int sleepBedSleepId)
+bool WheatBedManager::SleepBed(int sleepBedSleepId, int sleeperId)
 {
 	if(IsBedEmpty(sleepBedSleepId) == false) {
 		return false;
 	}
 
-	m_arrBeds[sleepBedSleepId].Set(false, GetSleeper(FindSleeperId(sleepBedSleepId)));
+	m_arrBeds[sleepBedSleepId].Set(false, sleeperId);
 
 	return true;
 }
@@ -50,17 +55,22 @@ int WheatBedManager::FindSleeperId(SOCKET sleeperSocket)
 	return -1;
 }
 
-int WheatBedManager::RegisterNewSleeper(Sleeper sleeper)
+int WheatBedManager::RegisterNewSleeper(SOCKET sock, const char * ipAddress)
 {
-	sleeper.empty = false;
 	int emptyId = FindEmptySleeperId();
 	
 	if(emptyId == -1) {
-		m_sleepers.push_back(sleeper);
-		return static_cast<int>(m_sleepers.size()) - 1;
+		m_sleepers.emplace_back();
+		m_sleepers.back().name.reserve(SLEEPER_NAME_RESERVED_SIZE);
+		emptyId = static_cast<int>(m_sleepers.size()) - 1;
 	}
 
-	m_sleepers[emptyId].copy(sleeper);
+	// ͵صǼǣһʱ˯ٸƹ
+	Sleeper & sleeper = m_sleepers[emptyId];
+	sleeper.clear();
+	sleeper.empty = false;
+	sleeper.sock = sock;
+	sleeper.IPADDRESS.assign(ipAddress);
 
 	return emptyId;
 }
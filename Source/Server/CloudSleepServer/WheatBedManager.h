@@ -6,6 +6,12 @@
 
 #define BED_NUM 256
 
+// Ԥ׼õ˯͵ǼǱλô˯ڽǼǱ
+// λϼǵ ˯id ָ룬ǼǱҲûϵת˯Ͳܳ
+#define SLEEPER_RESERVED_NUM 1024
+// ÿǼǱλΪԤ̵ָֽȥȫֶҪڴ
+#define SLEEPER_NAME_RESERVED_SIZE 64
+
 enum class SleeperType {
 	Girl,
 	Boy
@@ -44,6 +50,10 @@ public:
 
 	int sleepingBedId = -1;
 
+	// λ˯һ˶ϢֽڣԱ˭˵ʱ
+	unsigned long long messagesIn = 0;
+	unsigned long long bytesIn = 0;
+
 	void set(bool _empty, SOCKET _sock, const char * _name, SleeperType _type) {
 		empty = _empty;
 		sock = _sock;
@@ -63,11 +73,22 @@ public:
 		firstMoved = another.firstMoved;
 	}
 
+	// յǼǱλãһλ˯ãַֻݣѾҪڴ
 	void clear() {
 		empty = true;
+		name.clear();
+		type = SleeperType::Boy;
+
+		moveLastData = Vec2<int>();
+		posLastData = Vec2<int>();
+
 		firstMoved = false;
+		sleepingBedId = -1;
+
+		messagesIn = 0;
+		bytesIn = 0;
 
-		IPADDRESS = "";
+		IPADDRESS.clear();
 	}
 
 	SleeperType TransformIntToSleeperType(int _intval);
@@ -76,27 +97,29 @@ public:
 class Bed {
 public:
 	inline bool Empty() { return empty; }
-	inline Sleeper * GetSleeper() { return pSleeper; }
+	// ˯Ŵϵ ˯idմΪ -1
+	inline int GetSleeperId() { return sleeperId; }
 	
 	inline void Set(bool _empty) { empty = _empty; }
-	inline void Set(bool _empty, Sleeper * _pSleeper) { empty = _empty; pSleeper = _pSleeper; }
+	inline void Set(bool _empty, int _sleeperId) { empty = _empty; sleeperId = _sleeperId; }
 
-	inline void Clear() { empty = true; }
+	inline void Clear() { empty = true; sleeperId = -1; }
 
 private:
 	bool empty = true;
-	Sleeper * pSleeper = nullptr;
+	int sleeperId = -1;
 };
 
 // λα˾Ĵλ˯ǵĴλ
 class WheatBedManager {
 public:
+	WheatBedManager();
 
 	// Ӵ
 	void GetupBed(int getupBedSleepId);
 	
-	// ڴ˯
-	bool SleepBed(int sleepBedSleepId);
+	// ˯ڴ˯
+	bool SleepBed(int sleepBedSleepId, int sleeperId);
 
 	bool IsBedEmpty(int checkBedSleepId);
 
@@ -108,9 +131,9 @@ public:
 	int FindSleeperId(SOCKET sock);
 
 	// Ǽµ˯
-	// пе ˯id滻 ˯id  ˯ͣûпе ˯idpush_back() һµ ˯id
+	// пе ˯idֱڸλϵǼǣûпе ˯idpush_back() һµ ˯id
 	// Ϊ˯ע ˯id
-	int RegisterNewSleeper(Sleeper sleeper);
+	int RegisterNewSleeper(SOCKET sock, const char * ipAddress);
 
 	// ע˯ͣ˯뿪
 	void CancelSleeper(int sleeperId);
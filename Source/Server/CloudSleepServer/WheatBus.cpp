@@ -0,0 +1,483 @@
+#include "WheatBus.h"
+#include "ProjectCommon.h"
+#include "WheatMetrics.h"
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+bool WheatBusTopicMatch(const std::string & subscription, const char * topic, size_t topicLen)
+{
+	if(subscription.empty() == false && subscription.back() == '*') {
+		size_t prefixLen = subscription.size() - 1;
+		return topicLen >= prefixLen && memcmp(subscription.data(), topic, prefixLen) == 0;
+	}
+	return subscription.size() == topicLen && memcmp(subscription.data(), topic, topicLen) == 0;
+}
+
+//  Publish ֡ϢʽԷ false
+static bool SplitPublish(const char * payload, size_t len, const char ** pTopic, size_t * pTopicLen, const char ** pMessage, size_t * pMessageLen)
+{
+	if(len < 1) {
+		return false;
+	}
+	size_t topicLen = static_cast<unsigned char>(payload[0]);
+	if(topicLen == 0 || 1 + topicLen > len) {
+		return false;
+	}
+	*pTopic = payload + 1;
+	*pTopicLen = topicLen;
+	*pMessage = payload + 1 + topicLen;
+	*pMessageLen = len - 1 - topicLen;
+	return true;
+}
+
+#pragma region WheatBusBroker
+
+bool WheatBusBroker::Start(const char * listenAddress, int port, const std::string & secret)
+{
+	if(port == 0) {
+		return true;
+	}
+
+	if(secret.empty() && WheatMuxIsLoopback(listenAddress) == false) {
+		printf("Bus Refuses To Listen On %s Without link_secret!\n", listenAddress);
+		return false;
+	}
+	m_secret = secret;
+
+	m_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(m_listenSocket == INVALID_SOCKET) {
+		printf("Bus socket Error!! %d\n", WSAGetLastError());
+		return false;
+	}
+
+	sockaddr_in address;
+	memset(& address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.S_un.S_addr = inet_addr(listenAddress);
+	if(address.sin_addr.S_un.S_addr == INADDR_NONE) {
+		printf("Invalid Bus Address %s!\n", listenAddress);
+		closesocket(m_listenSocket);
+		m_listenSocket = INVALID_SOCKET;
+		return false;
+	}
+
+	if(bind(m_listenSocket, (sockaddr *)& address, sizeof(address)) == SOCKET_ERROR || listen(m_listenSocket, WHEATBUS_MAX_LINKS) == SOCKET_ERROR) {
+		printf("Bus bind/listen Error!! %d\n", WSAGetLastError());
+		closesocket(m_listenSocket);
+		m_listenSocket = INVALID_SOCKET;
+		return false;
+	}
+
+	printf("Bus Listening On %s:%d.\n", listenAddress, port);
+	return true;
+}
+
+void WheatBusBroker::Close()
+{
+	for(int i = 0; i < WHEATBUS_MAX_LINKS; i++) {
+		CloseLink(i);
+	}
+	if(m_listenSocket != INVALID_SOCKET) {
+		closesocket(m_listenSocket);
+		m_listenSocket = INVALID_SOCKET;
+	}
+}
+
+void WheatBusBroker::AddToFdSet(fd_set * pReadSet)
+{
+	if(m_listenSocket != INVALID_SOCKET) {
+		FD_SET(m_listenSocket, pReadSet);
+	}
+	for(BusLink & link : m_links) {
+		if(link.mux.IsOpen()) {
+			FD_SET(link.mux.GetSocket(), pReadSet);
+		}
+	}
+}
+
+void WheatBusBroker::Poll(fd_set * pReadSet)
+{
+	if(m_listenSocket != INVALID_SOCKET && FD_ISSET(m_listenSocket, pReadSet)) {
+		FD_CLR(m_listenSocket, pReadSet);
+		Accept();
+	}
+
+	for(int i = 0; i < WHEATBUS_MAX_LINKS; i++) {
+		WheatMuxLink & mux = m_links[i].mux;
+		if(mux.IsOpen() == false || FD_ISSET(mux.GetSocket(), pReadSet) == false) {
+			continue;
+		}
+		FD_CLR(mux.GetSocket(), pReadSet);
+
+		if(mux.Receive() == false) {
+			printf("Bus Link %d (%s) Closed.\n", i, m_links[i].address.c_str());
+			CloseLink(i);
+			continue;
+		}
+
+		WheatMuxHeader header;
+		const char * payload = nullptr;
+		while(mux.PeekFrame(& header, & payload)) {
+			// ϰ֮ǰʲô֡ԲϾͶϿ˭нڵϷ
+			if(mux.IsTrusted() == false && mux.AcceptHello(header, payload, m_secret) == false) {
+				printf("Bus Link %d (%s) Refused, Bad Secret.\n", i, m_links[i].address.c_str());
+				CloseLink(i);
+				break;
+			}
+			if(header.type != WheatMuxType::Hello) {
+				HandleFrame(i, header, payload);
+			}
+			mux.PopFrame();
+		}
+		if(mux.IsOpen() && mux.IsBroken()) {
+			CloseLink(i);
+		}
+	}
+}
+
+void WheatBusBroker::Flush()
+{
+	for(int i = 0; i < WHEATBUS_MAX_LINKS; i++) {
+		if(m_links[i].mux.IsOpen() && m_links[i].mux.Flush() == false) {
+			CloseLink(i);
+		}
+	}
+}
+
+void WheatBusBroker::PrintLinks()
+{
+	printf("------------- Bus ---------------\n");
+	for(int i = 0; i < WHEATBUS_MAX_LINKS; i++) {
+		BusLink & link = m_links[i];
+		if(link.mux.IsOpen() == false) {
+			continue;
+		}
+		printf("%-2d %-22s published %-8llu delivered %-8llu topics", i, link.address.c_str(), link.publishedMessages, link.deliveredMessages);
+		for(const std::string & subscription : link.subscriptions) {
+			printf(" %s", subscription.c_str());
+		}
+		printf("\n");
+	}
+	printf("---------------------------------\n");
+}
+
+void WheatBusBroker::Accept()
+{
+	sockaddr_in address;
+	int len = sizeof(address);
+	SOCKET sock = accept(m_listenSocket, (sockaddr *)& address, & len);
+	if(sock == INVALID_SOCKET) {
+		return;
+	}
+
+	for(int i = 0; i < WHEATBUS_MAX_LINKS; i++) {
+		BusLink & link = m_links[i];
+		if(link.mux.IsOpen() == false) {
+			BOOL noDelay = TRUE;
+			setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *)& noDelay, sizeof(noDelay));
+
+			link.mux.Attach(sock);
+			link.address = std::string(inet_ntoa(address.sin_addr)) + ":" + std::to_string(ntohs(address.sin_port));
+			link.subscriptions.clear();
+			link.publishedMessages = 0;
+			link.deliveredMessages = 0;
+			printf("Bus Link %d Connected From %s\n", i, link.address.c_str());
+			return;
+		}
+	}
+
+	printf("Bus Link Refused, Too Many Links.\n");
+	closesocket(sock);
+}
+
+void WheatBusBroker::CloseLink(int linkIndex)
+{
+	m_links[linkIndex].mux.Close();
+	m_links[linkIndex].subscriptions.clear();
+}
+
+void WheatBusBroker::HandleFrame(int linkIndex, const WheatMuxHeader & header, const char * payload)
+{
+	BusLink & from = m_links[linkIndex];
+
+	if(header.type == WheatMuxType::Subscribe || header.type == WheatMuxType::Unsubscribe) {
+		if(header.payloadLen == 0 || header.payloadLen > WHEATBUS_TOPIC_SIZE) {
+			return;
+		}
+		std::string topic(payload, header.payloadLen);
+		auto it = std::find(from.subscriptions.begin(), from.subscriptions.end(), topic);
+		if(header.type == WheatMuxType::Subscribe && it == from.subscriptions.end()) {
+			from.subscriptions.push_back(topic);
+		} else if(header.type == WheatMuxType::Unsubscribe && it != from.subscriptions.end()) {
+			from.subscriptions.erase(it);
+		}
+		return;
+	}
+
+	const char * topic = nullptr;
+	const char * message = nullptr;
+	size_t topicLen = 0;
+	size_t messageLen = 0;
+	if(header.type != WheatMuxType::Publish || SplitPublish(payload, header.payloadLen, & topic, & topicLen, & message, & messageLen) == false) {
+		return;
+	}
+	from.publishedMessages++;
+
+	// ԭתڵ㣬ͬһڵкüİҲֻתһ
+	for(int i = 0; i < WHEATBUS_MAX_LINKS; i++) {
+		BusLink & to = m_links[i];
+		if(i == linkIndex || to.mux.IsOpen() == false || to.mux.GetQueuedBytes() + header.payloadLen > WHEATBUS_MAX_QUEUED_BYTES) {
+			continue;
+		}
+		for(const std::string & subscription : to.subscriptions) {
+			if(WheatBusTopicMatch(subscription, topic, topicLen)) {
+				to.mux.Queue(WheatMuxType::Publish, 0, payload, header.payloadLen);
+				to.deliveredMessages++;
+				break;
+			}
+		}
+	}
+}
+
+#pragma endregion
+
+#pragma region WheatBusClient
+
+bool WheatBusClient::Start(const char * brokerAddress, int port, const std::string & secret)
+{
+	if(brokerAddress == nullptr || brokerAddress[0] == '\0' || port == 0) {
+		return true;
+	}
+
+	memset(& m_brokerAddress, 0, sizeof(m_brokerAddress));
+	m_brokerAddress.sin_family = AF_INET;
+	m_brokerAddress.sin_port = htons(port);
+	m_brokerAddress.sin_addr.S_un.S_addr = inet_addr(brokerAddress);
+	if(m_brokerAddress.sin_addr.S_un.S_addr == INADDR_NONE) {
+		printf("Invalid Bus Address %s, Bus Disabled.\n", brokerAddress);
+		return false;
+	}
+
+	m_secret = secret;
+	m_enabled = true;
+	m_nextConnectMs = 0;
+	printf("Bus Enabled, Broker %s:%d.\n", brokerAddress, port);
+	return true;
+}
+
+void WheatBusClient::Close()
+{
+	m_link.Close();
+	if(m_connectingSocket != INVALID_SOCKET) {
+		closesocket(m_connectingSocket);
+		m_connectingSocket = INVALID_SOCKET;
+	}
+	m_enabled = false;
+}
+
+void WheatBusClient::Subscribe(const std::string & topic, Handler handler)
+{
+	if(topic.empty() || topic.size() > WHEATBUS_TOPIC_SIZE) {
+		return;
+	}
+
+	for(Subscription & subscription : m_subscriptions) {
+		if(subscription.topic == topic) {
+			subscription.handler = handler;
+			return;
+		}
+	}
+
+	Subscription subscription;
+	subscription.topic = topic;
+	subscription.handler = handler;
+	m_subscriptions.push_back(subscription);
+
+	if(m_link.IsOpen()) {
+		m_link.Queue(WheatMuxType::Subscribe, 0, topic.data(), topic.size());
+	}
+}
+
+void WheatBusClient::Unsubscribe(const std::string & topic)
+{
+	for(auto it = m_subscriptions.begin(); it != m_subscriptions.end(); ++it) {
+		if(it->topic == topic) {
+			m_subscriptions.erase(it);
+			if(m_link.IsOpen()) {
+				m_link.Queue(WheatMuxType::Unsubscribe, 0, topic.data(), topic.size());
+			}
+			return;
+		}
+	}
+}
+
+void WheatBusClient::Publish(const std::string & topic, const char * payload, size_t len)
+{
+	if(m_enabled == false) {
+		return;
+	}
+	if(topic.empty() || topic.size() > WHEATBUS_TOPIC_SIZE || len > WHEATMUX_MAX_PAYLOAD_SIZE - 1 - topic.size()
+		|| m_link.IsOpen() == false || m_link.GetQueuedBytes() + len > WHEATBUS_MAX_QUEUED_BYTES) {
+		m_droppedMessages++;
+		return;
+	}
+
+	// ֡Ҫһ𣬻̣ܶϢһҲջƴ
+	char frame[WHEATMUX_MAX_PAYLOAD_SIZE];
+	frame[0] = static_cast<char>(topic.size());
+	memcpy(frame + 1, topic.data(), topic.size());
+	memcpy(frame + 1 + topic.size(), payload, len);
+	m_link.Queue(WheatMuxType::Publish, 0, frame, 1 + topic.size() + len);
+
+	m_publishedMessages++;
+}
+
+void WheatBusClient::AddToFdSet(fd_set * pReadSet, fd_set * pWriteSet)
+{
+	if(m_link.IsOpen()) {
+		FD_SET(m_link.GetSocket(), pReadSet);
+	} else if(m_connectingSocket != INVALID_SOCKET) {
+		FD_SET(m_connectingSocket, pWriteSet);
+	}
+}
+
+void WheatBusClient::Poll(fd_set * pReadSet, fd_set * pWriteSet)
+{
+	//  connect ˻ɿдϵĻʱ䵽
+	if(m_connectingSocket != INVALID_SOCKET && FD_ISSET(m_connectingSocket, pWriteSet)) {
+		FD_CLR(m_connectingSocket, pWriteSet);
+		OnConnected();
+		return;
+	}
+
+	if(m_link.IsOpen() == false || FD_ISSET(m_link.GetSocket(), pReadSet) == false) {
+		return;
+	}
+	FD_CLR(m_link.GetSocket(), pReadSet);
+
+	if(m_link.Receive() == false) {
+		printf("Bus Link Closed.\n");
+		m_link.Close();
+		m_nextConnectMs = m_pClock->NowMs() + WHEATBUS_RECONNECT_MS;
+		return;
+	}
+
+	WheatMuxHeader header;
+	const char * payload = nullptr;
+	while(m_link.PeekFrame(& header, & payload)) {
+		HandleFrame(header, payload);
+		m_link.PopFrame();
+	}
+	if(m_link.IsBroken()) {
+		m_link.Close();
+		m_nextConnectMs = m_pClock->NowMs() + WHEATBUS_RECONNECT_MS;
+	}
+}
+
+void WheatBusClient::Tick()
+{
+	if(m_enabled == false || m_link.IsOpen()) {
+		return;
+	}
+
+	long long nowMs = m_pClock->NowMs();
+	if(nowMs < m_nextConnectMs) {
+		return;
+	}
+
+	// һεӵڻûϣ
+	if(m_connectingSocket != INVALID_SOCKET) {
+		closesocket(m_connectingSocket);
+		m_connectingSocket = INVALID_SOCKET;
+	}
+	m_nextConnectMs = nowMs + WHEATBUS_RECONNECT_MS;
+	StartConnect();
+}
+
+void WheatBusClient::Flush()
+{
+	if(m_link.IsOpen() == false || m_link.GetQueuedBytes() == 0) {
+		return;
+	}
+
+	m_flushes++;
+	if(m_link.Flush() == false) {
+		m_link.Close();
+		m_nextConnectMs = m_pClock->NowMs() + WHEATBUS_RECONNECT_MS;
+	}
+}
+
+void WheatBusClient::PrintStats(std::string * pOut)
+{
+	if(m_enabled == false) {
+		WheatPrintf(pOut, "Bus Disabled.\n");
+		return;
+	}
+
+	WheatPrintf(pOut, "Bus %s, Published %llu, Dropped %llu, Flushes %llu\n", m_link.IsOpen() ? "Connected" : "Disconnected", m_publishedMessages, m_droppedMessages, m_flushes);
+	for(Subscription & subscription : m_subscriptions) {
+		WheatPrintf(pOut, "  %-32s received %llu\n", subscription.topic.c_str(), subscription.receivedMessages);
+	}
+}
+
+void WheatBusClient::StartConnect()
+{
+	SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(sock == INVALID_SOCKET) {
+		return;
+	}
+
+	u_long nonBlocking = 1;
+	ioctlsocket(sock, FIONBIO, & nonBlocking);
+
+	if(connect(sock, (sockaddr *)& m_brokerAddress, sizeof(m_brokerAddress)) == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) {
+		closesocket(sock);
+		return;
+	}
+
+	m_connectingSocket = sock;
+}
+
+void WheatBusClient::OnConnected()
+{
+	// ԺĻģsend һη
+	u_long nonBlocking = 0;
+	ioctlsocket(m_connectingSocket, FIONBIO, & nonBlocking);
+
+	BOOL noDelay = TRUE;
+	setsockopt(m_connectingSocket, IPPROTO_TCP, TCP_NODELAY, (const char *)& noDelay, sizeof(noDelay));
+
+	m_link.Attach(m_connectingSocket);
+	m_connectingSocket = INVALID_SOCKET;
+
+	// ȶ԰ţ̨Ǳ߲ǵöϿǰĶģ¶һ
+	m_link.QueueHello(m_secret);
+	for(Subscription & subscription : m_subscriptions) {
+		m_link.Queue(WheatMuxType::Subscribe, 0, subscription.topic.data(), subscription.topic.size());
+	}
+
+	printf("Bus Connected.\n");
+}
+
+void WheatBusClient::HandleFrame(const WheatMuxHeader & header, const char * payload)
+{
+	const char * topic = nullptr;
+	const char * message = nullptr;
+	size_t topicLen = 0;
+	size_t messageLen = 0;
+	if(header.type != WheatMuxType::Publish || SplitPublish(payload, header.payloadLen, & topic, & topicLen, & message, & messageLen) == false) {
+		return;
+	}
+
+	for(Subscription & subscription : m_subscriptions) {
+		if(WheatBusTopicMatch(subscription.topic, topic, topicLen)) {
+			subscription.receivedMessages++;
+			subscription.handler(topic, topicLen, message, messageLen);
+		}
+	}
+}
+
+#pragma endregion
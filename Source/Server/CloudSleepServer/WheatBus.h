@@ -0,0 +1,141 @@
+#pragma once
+
+#include "WheatMux.h"
+#include "WheatClock.h"
+
+#include <winsock.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ϢĬϵ TCP ˿ڣ̨
+#define WHEATBUS_PORT 11461
+
+// ̨Ӽڵ
+#define WHEATBUS_MAX_LINKS 32
+
+// ֽ
+#define WHEATBUS_TOPIC_SIZE 64
+
+// ̨·Ժλ 
+#define WHEATBUS_RECONNECT_MS 3000
+
+// һ·ֽܶûȥٶϢֱӵֻ֤ʹ
+#define WHEATBUS_MAX_QUEUED_BYTES (1024 * 1024)
+
+// ֮ԼõĻ
+#define WHEATBUS_TOPIC_ANNOUNCE "announce"			// ȫ棬ϢΪ
+#define WHEATBUS_TOPIC_CHAT_PREFIX "chat/"			// ϢΪ "ڵ\0˯\0"
+#define WHEATBUS_TOPIC_PRESENCE_PREFIX "presence/"	// ϢΪ "ڵ\0˯"ÿڵÿ뱨һ
+
+// ĵĻǷ⣬ '*' βĶİǰ沿ֿͷĻ
+bool WheatBusTopicMatch(const std::string & subscription, const char * topic, size_t topicLen);
+
+// ߵԱ̨(WheatDirectory)ÿڵ㶼һ TCP ·
+// ڵԼЩ⣬ڵ㷢Ϣֻתڵ㣬Ӳתظ
+// תϢ·һȦһηȥϢӳ̨һȦ
+class WheatBusBroker {
+public:
+	WheatBusBroker() {}
+	~WheatBusBroker() { Close(); }
+
+	// port Ϊ 0 ʾ
+	//  announcechat/ Ϣнڵ˯͵֪ͨ·ĵһ֡ŶԵϵİ secretΪʱֻϼַ
+	bool Start(const char * listenAddress, int port, const std::string & secret);
+	void Close();
+
+	void AddToFdSet(fd_set * pReadSet);
+	// Ӵ½ڵ㣬սڵ㷢֡õ socket  pReadSet 
+	void Poll(fd_set * pReadSet);
+	// һȦµ֡ȥ
+	void Flush();
+
+	void PrintLinks();
+
+private:
+
+	struct BusLink {
+		WheatMuxLink mux;
+		std::string address;
+		std::vector<std::string> subscriptions;
+		unsigned long long publishedMessages = 0;	// ڵ㷢˶
+		unsigned long long deliveredMessages = 0;	// תڵ
+	};
+
+	void Accept();
+	void CloseLink(int linkIndex);
+	void HandleFrame(int linkIndex, const WheatMuxHeader & header, const char * payload);
+
+	SOCKET m_listenSocket = INVALID_SOCKET;
+	BusLink m_links[WHEATBUS_MAX_LINKS];
+	std::string m_secret;
+};
+
+// ͨѶԱ̨̺ϵߵԱ(WheatBusBroker)һ·
+// ĵĻ·ԺԶ¶ģϢһȦ¼ѭ Flush() һηȥ
+class WheatBusClient {
+public:
+	// payload ΪϢڻص֮ǰЧ
+	using Handler = std::function<void(const char * topic, size_t topicLen, const char * payload, size_t len)>;
+
+	WheatBusClient(WheatClock * pClock = GetSystemClock()) { m_pClock = pClock; }
+	~WheatBusClient() { Close(); }
+
+	WheatBusClient(const WheatBusClient &) = delete;
+	WheatBusClient & operator=(const WheatBusClient &) = delete;
+
+	// ʼߣbrokerAddress Ϊջ port Ϊ 0 ʱͶĶʲôҲ
+	// secret Ϊ̨ԼõİţÿԺһ֡ȥ
+	bool Start(const char * brokerAddress, int port, const std::string & secret);
+	void Close();
+
+	inline bool IsEnabled() { return m_enabled; }
+	inline bool IsConnected() { return m_link.IsOpen(); }
+
+	// һ⣬յϢʱ handler
+	void Subscribe(const std::string & topic, Handler handler);
+	void Unsubscribe(const std::string & topic);
+
+	// һϢ·ûϵʱֱӵ
+	void Publish(const std::string & topic, const char * payload, size_t len);
+
+	// ͹˿һ TCPԱ  select ϣʱĿд¼
+	void AddToFdSet(fd_set * pReadSet, fd_set * pWriteSet);
+	// ߷Ϣߣõ socket 
+	void Poll(fd_set * pReadSet, fd_set * pWriteSet);
+	// ¼ѭĵδã·˵Ļ
+	void Tick();
+	// һȦµϢȥ
+	void Flush();
+
+	// ӡߵͳƣpOut ˼ͬ WheatPrintf()
+	void PrintStats(std::string * pOut = nullptr);
+
+private:
+
+	struct Subscription {
+		std::string topic;
+		Handler handler;
+		unsigned long long receivedMessages = 0;
+	};
+
+	void StartConnect();
+	void OnConnected();
+	void HandleFrame(const WheatMuxHeader & header, const char * payload);
+
+	WheatClock * m_pClock = nullptr;
+
+	bool m_enabled = false;
+	sockaddr_in m_brokerAddress;
+	std::string m_secret;
+
+	WheatMuxLink m_link;
+	SOCKET m_connectingSocket = INVALID_SOCKET;
+	long long m_nextConnectMs = 0;
+
+	std::vector<Subscription> m_subscriptions;
+
+	unsigned long long m_publishedMessages = 0;
+	unsigned long long m_droppedMessages = 0;
+	unsigned long long m_flushes = 0;
+};
@@ -0,0 +1,83 @@
+#include "WheatChatHistory.h"
+#include "ProjectCommon.h"
+
+#include <cstring>
+
+void WheatChatHistory::SetCapacity(size_t frameNum)
+{
+	if(frameNum == m_slots.size()) {
+		return;
+	}
+
+	// Ӿɵµ˳ᵽµĻŲµĶɵ
+	std::vector<Slot> slots(frameNum);
+	for(Slot & slot : slots) {
+		slot.frame.reserve(WHEATCHATHISTORY_FRAME_RESERVED_SIZE);
+	}
+
+	size_t oldSize = m_slots.size();
+	size_t keepNum = MIN(m_frameNum, frameNum);
+	for(size_t i = 0; i < keepNum; i++) {
+		// µһ֡ keepNum ֡
+		Slot & oldSlot = m_slots[(m_next + oldSize - keepNum + i) % oldSize];
+		slots[i].sleeperId = oldSlot.sleeperId;
+		slots[i].valid = oldSlot.valid;
+		slots[i].frame.swap(oldSlot.frame);
+	}
+
+	m_slots.swap(slots);
+	m_next = frameNum == 0 ? 0 : keepNum % frameNum;
+	m_frameNum = keepNum;
+	m_byteNum = 0;
+	for(Slot & slot : m_slots) {
+		if(slot.valid) {
+			m_byteNum += slot.frame.size();
+		}
+	}
+}
+
+void WheatChatHistory::Push(int sleeperId, const char * frame, size_t len)
+{
+	if(m_slots.empty()) {
+		return;
+	}
+
+	Slot & slot = m_slots[m_next];
+	if(slot.valid) {
+		m_byteNum -= slot.frame.size();
+	}
+	if(m_frameNum < m_slots.size()) {
+		m_frameNum++;
+	}
+
+	slot.sleeperId = sleeperId;
+	slot.valid = true;
+	slot.frame.assign(frame, len);
+	m_byteNum += len;
+
+	m_next = (m_next + 1) % m_slots.size();
+}
+
+void WheatChatHistory::Forget(int sleeperId)
+{
+	for(Slot & slot : m_slots) {
+		if(slot.valid && slot.sleeperId == sleeperId) {
+			slot.valid = false;
+			m_byteNum -= slot.frame.size();
+		}
+	}
+}
+
+size_t WheatChatHistory::CopyTo(char * dest)
+{
+	size_t len = 0;
+	for(size_t i = 0; i < m_frameNum; i++) {
+		Slot & slot = m_slots[(m_next + m_slots.size() - m_frameNum + i) % m_slots.size()];
+		if(slot.valid == false) {
+			continue;
+		}
+		memcpy(dest + len, slot.frame.data(), slot.frame.size());
+		len += slot.frame.size();
+	}
+	return len;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+// Ĭϼס
+#define WHEATCHATHISTORY_DEFAULT_SIZE 20
+
+// ÿԤ̵ֽڻﻻȥȫֶҪڴ
+#define WHEATCHATHISTORY_FRAME_RESERVED_SIZE 256
+
+// 첾ڴŷļ죬˯ͽʱŷһ𷢹ȥʡһʲô֪
+// ǵѾõ֡ "˯id\0Ϣ\0"ԭͣٱ룬Ҳọ̈Ժµһɵһ
+class WheatChatHistory {
+public:
+	WheatChatHistory() { SetCapacity(WHEATCHATHISTORY_DEFAULT_SIZE); }
+
+	// Ƕ0 ʾǣС˶ɵļ
+	void SetCapacity(size_t frameNum);
+	inline size_t GetCapacity() { return m_slots.size(); }
+
+	// һ֡sleeperId Ϊ˵˯ͣ-1 ʾλ˯˵ģ֪ͨ
+	void Push(int sleeperId, const char * frame, size_t len);
+
+	// λ˯뿪ˣλ˯˵Ļ ˯id Ժ󻰱˯ͷ
+	void Forget(int sleeperId);
+
+	// ڼżһֽ
+	inline size_t GetFrameNum() { return m_frameNum; }
+	inline size_t GetByteNum() { return m_byteNum; }
+
+	// Ӿɵµ˳֡βд destdest Ҫ GetByteNum() ֽڣдֽ
+	size_t CopyTo(char * dest);
+
+private:
+
+	struct Slot {
+		int sleeperId = -1;
+		bool valid = false;
+		std::string frame;
+	};
+
+	std::vector<Slot> m_slots;
+	size_t m_next = 0;		// һ֡дĸλãҲɵһ֡ڵλ
+	size_t m_frameNum = 0;
+	size_t m_byteNum = 0;
+};
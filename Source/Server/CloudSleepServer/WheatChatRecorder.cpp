@@ -4,24 +4,39 @@ WheatChatRecorder::WheatChatRecorder() {
 	// Init();
 }
 
+WheatChatRecorder::~WheatChatRecorder() {
+	Close();
+}
+
 bool WheatChatRecorder::Init()
 {
 	m_file = fopen("records.txt", "a");
 
-	return true;
+	return m_file != nullptr;
 }
 
 void WheatChatRecorder::Close() {
-	fclose(m_file);
+	if(m_file != nullptr) {
+		fclose(m_file);
+		m_file = nullptr;
+	}
 }
 
-bool WheatChatRecorder::Record(std::string ip, std::string input)
+bool WheatChatRecorder::Record(std::string_view ip, std::string_view input)
 {
-	Init();
-
-	fputs((ip + "}:" + input + "\n").c_str(), m_file);
-
-	Close();
+	if(m_enabled == false) {
+		return false;
+	}
+	if(m_file == nullptr && Init() == false) {
+		return false;
+	}
+
+	fwrite(ip.data(), 1, ip.length(), m_file);
+	fputs("}:", m_file);
+	fwrite(input.data(), 1, input.length(), m_file);
+	fputc('\n', m_file);
+
+	fflush(m_file);
 
 	return true;
 }
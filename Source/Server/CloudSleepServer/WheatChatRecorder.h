@@ -2,17 +2,24 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 
 class WheatChatRecorder {
 public:
 	WheatChatRecorder();
+	~WheatChatRecorder();
 
 	bool Init();
 	void Close();
 
-	bool Record(std::string ip, std::string input);
+	// ļһμ¼ʱ򿪣֮һֱţÿ¼д fflushΪÿ¼һļ
+	bool Record(std::string_view ip, std::string_view input);
+
+	// صԺʲôǣϰʱ records.txt дٵ
+	inline void SetEnabled(bool enabled) { m_enabled = enabled; }
 
 private:
-	FILE * m_file;
+	FILE * m_file = nullptr;
+	bool m_enabled = true;
 
 };
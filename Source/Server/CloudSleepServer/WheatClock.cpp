@@ -0,0 +1,21 @@
+#include "WheatClock.h"
+#include "ProjectCommon.h"
+
+#include <chrono>
+#include <thread>
+
+long long WheatSystemClock::NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void WheatSystemClock::SleepMs(long long ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+WheatClock * GetSystemClock()
+{
+	static WheatSystemClock systemClock;
+	return & systemClock;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// ʱԱ˾кʱйص鶼Ҫ˽Կ(timeSleep)
+// ϵͳʱԱ(WheatSystemClock) ʵӣⱨʱԱ(WheatVirtualClock) һⲦ
+// ⱨʱԱͿڼȷԵģⷿＸСʱĻ롢ͶƱʱ
+class WheatClock {
+public:
+	virtual ~WheatClock() {}
+
+	// ǰʱ䣬λ 룬㲻̶ֻʱ
+	virtual long long NowNs() = 0;
+
+	// ȴһʱ䣬λ 
+	virtual void SleepMs(long long ms) = 0;
+
+	inline long long NowUs() { return NowNs() / 1000; }
+	inline long long NowMs() { return NowNs() / 1000000; }
+};
+
+class WheatSystemClock : public WheatClock {
+public:
+	long long NowNs() override;
+	void SleepMs(long long ms) override;
+};
+
+class WheatVirtualClock : public WheatClock {
+public:
+	long long NowNs() override { return m_nowNs; }
+
+	// Ӳĵȴֻǰָǰ
+	void SleepMs(long long ms) override { AdvanceMs(ms); }
+
+	inline void AdvanceNs(long long ns) { m_nowNs += ns; }
+	inline void AdvanceMs(long long ms) { m_nowNs += ms * 1000000; }
+
+private:
+	long long m_nowNs = 0;
+};
+
+// ȡȫΨһϵͳʱԱ
+WheatClock * GetSystemClock();
@@ -1,23 +1,55 @@
 #include "WheatCommand.h"
 #include "ProjectCommon.h"
 
+#include <charconv>
+
+void WheatCommand::SetText(const char * text, size_t len, WheatArena * pArena)
+{
+	if(len > 0xFFFF) {
+		len = 0xFFFF;
+	}
+
+	if(len <= WHEATCOMMAND_INLINE_TEXT_SIZE) {
+		memcpy(m_text.inlineText, text, len);
+		m_textSpilled = false;
+	} else if(pArena != nullptr) {
+		m_text.pSpilled = pArena->CopyString(text, len);
+		m_textSpilled = true;
+	} else {
+		len = WHEATCOMMAND_INLINE_TEXT_SIZE;
+		memcpy(m_text.inlineText, text, len);
+		m_textSpilled = false;
+	}
+	m_textLen = static_cast<unsigned short>(len);
+}
+
 WheatCommand WheatCommandProgrammer::Parse(const char* buf)
+{
+	size_t len = strlen(buf);
+	const char * pDollar = static_cast<const char *>(memchr(buf, '$', len));
+
+	return Parse(buf, len, pDollar == nullptr ? len : static_cast<size_t>(pDollar - buf));
+}
+
+WheatCommand WheatCommandProgrammer::Parse(const char * buf, size_t len, size_t opcodeLen, WheatArena * pArena)
 {
 	WheatCommand resultCommand;
-	
-	std::vector<std::string> vecCuttedBuf = CutMessage(buf, '$', 2);
 
 	/* ȡ resultCommand.typeCommandTypes */
 
-	// ڻһΣûҵָţ˷ָţٻ2ΣʹڶΪַԶΪ unknown
-	if(vecCuttedBuf.size() <= 1) {
+	// ûҵָţԶΪ unknownָź漴ʹʲôûУҲҵˣ
+	if(opcodeLen >= len) {
 		resultCommand.type = WheatCommandType::unknown;
 		return resultCommand;
 	}
 
-	resultCommand.type = GetCommandTypeFromString(vecCuttedBuf[0].c_str());
-	
-	/* ȡ resultCommand.nParam  resultCommand.strParamparams */
+	resultCommand.type = GetCommandTypeFromString(buf, opcodeLen);
+
+	/* ȡ resultCommand.nParam  ֲparams */
+
+	// ֱԭ buf ϶гһһε std::stringbuf  '\0' βatoi  ','  '\0' Լͣ
+	const char * param = buf + opcodeLen + 1;
+	size_t paramLen = len - opcodeLen - 1;
 
 	switch(resultCommand.type) {
 		case WheatCommandType::yourid:
@@ -25,10 +57,10 @@ WheatCommand WheatCommandProgrammer::Parse(const char* buf)
 			resultCommand.type = WheatCommandType::unknown;
 			break;
 		case WheatCommandType::name:
-			resultCommand.strParam = vecCuttedBuf[1];
+			resultCommand.SetText(param, paramLen, pArena);
 			break;
 		case WheatCommandType::type:
-			resultCommand.nParam[0] = atoi(vecCuttedBuf[1].c_str());
+			resultCommand.nParam[0] = atoi(param);
 			break;
 
 		case WheatCommandType::leave:
@@ -36,26 +68,43 @@ WheatCommand WheatCommandProgrammer::Parse(const char* buf)
 			break;
 
 		case WheatCommandType::sleep:
-			resultCommand.nParam[0] = atoi(vecCuttedBuf[1].c_str());
+			resultCommand.nParam[0] = atoi(param);
 			break;
 		case WheatCommandType::getup:
 			break;
 
 		case WheatCommandType::chat:
-			resultCommand.strParam = vecCuttedBuf[1];
+			resultCommand.SetText(param, paramLen, pArena);
 			break;
+		case WheatCommandType::whisper:
+		{
+			// ȱ ':' Ļ unknown
+			const char * pColon = static_cast<const char *>(memchr(param, ':', paramLen));
+			if(pColon == nullptr) {
+				resultCommand.type = WheatCommandType::unknown;
+				break;
+			}
+			resultCommand.nParam[0] = atoi(param);
+			resultCommand.SetText(pColon + 1, paramLen - (pColon + 1 - param), pArena);
+		}
+		break;
 
 		case WheatCommandType::move:
 		case WheatCommandType::pos:
 		{
-			std::vector<std::string> vecPosCutTemp = CutMessage(vecCuttedBuf[1].c_str(), ',');
-			resultCommand.nParam[0] = atoi(vecPosCutTemp[0].c_str());
-			resultCommand.nParam[1] = atoi(vecPosCutTemp[1].c_str());
+			// ȱ ','  unknown
+			const char * pComma = static_cast<const char *>(memchr(param, ',', paramLen));
+			if(pComma == nullptr) {
+				resultCommand.type = WheatCommandType::unknown;
+				break;
+			}
+			resultCommand.nParam[0] = atoi(param);
+			resultCommand.nParam[1] = atoi(pComma + 1);
 		}
 		break;
 
 		case WheatCommandType::kick:
-			resultCommand.nParam[0] = atoi(vecCuttedBuf[1].c_str());
+			resultCommand.nParam[0] = atoi(param);
 			break;
 		case WheatCommandType::agree:
 			break;
@@ -63,6 +112,22 @@ WheatCommand WheatCommandProgrammer::Parse(const char* buf)
 			break;
 		case WheatCommandType::kickover:
 			break;
+
+		case WheatCommandType::ping:
+		case WheatCommandType::pong:
+			break;
+		case WheatCommandType::time:
+			resultCommand.nParam[0] = atoi(param);
+			break;
+
+		case WheatCommandType::full:
+		case WheatCommandType::redirect:
+		case WheatCommandType::notice:
+		case WheatCommandType::crowd:
+		case WheatCommandType::beds:
+		case WheatCommandType::tick:
+			resultCommand.type = WheatCommandType::unknown;
+			break;
 	}
 
 	return resultCommand;
@@ -70,60 +135,110 @@ WheatCommand WheatCommandProgrammer::Parse(const char* buf)
 
 std::string WheatCommandProgrammer::MakeMessage(const WheatCommand& command)
 {
-	std::string res = "";
+	std::string res(GetFrameMaxSize(command), '\0');
+	res.resize(WriteMessage(& res[0], command));
+	return res;
+}
+
+// ָ 8 ֽڣkickoverredirect '$' int  ',' Լ '\0'˯id Ҳһ int
+#define WHEATCOMMAND_FRAME_FIXED_SIZE 48
+
+size_t WheatCommandProgrammer::GetFrameMaxSize(const WheatCommand & command)
+{
+	return WHEATCOMMAND_FRAME_FIXED_SIZE + command.GetText().length();
+}
+
+// д "ָ$"дԺλ
+static char * WriteOpcode(char * dest, const char * name)
+{
+	size_t len = strlen(name);
+	memcpy(dest, name, len);
+	dest[len] = '$';
+	return dest + len + 1;
+}
+
+// дһдԺλãint  11 ֽ
+static char * WriteInt(char * dest, int value)
+{
+	return std::to_chars(dest, dest + 11, value).ptr;
+}
+
+size_t WheatCommandProgrammer::WriteMessage(char * dest, const WheatCommand & command)
+{
+	char * p = dest;
 
 	switch(command.type) {
 		case WheatCommandType::yourid:
-			res = res + "yourid$" + std::to_string(command.nParam[0]);
-			break;
 		case WheatCommandType::sleeper:
-			res = res + "sleeper$" + std::to_string(command.nParam[0]);
-			break;
-		case WheatCommandType::name:
-			res = res + "name$" + command.strParam;
-			break;
 		case WheatCommandType::type:
-			res = res + "type$" + std::to_string(command.nParam[0]);
+		case WheatCommandType::leave:
+		case WheatCommandType::sleep:
+		case WheatCommandType::kick:
+		case WheatCommandType::full:
+			p = WriteOpcode(p, GetCommandTypeName(command.type));
+			p = WriteInt(p, command.nParam[0]);
 			break;
 
-		case WheatCommandType::leave:
-			res = res + "leave$" + std::to_string(command.nParam[0]);
+		case WheatCommandType::name:
+		case WheatCommandType::chat:
+		case WheatCommandType::notice:
+		case WheatCommandType::crowd:
+		case WheatCommandType::beds:
+			p = WriteOpcode(p, GetCommandTypeName(command.type));
+			memcpy(p, command.GetText().data(), command.GetText().length());
+			p += command.GetText().length();
 			break;
 
-		case WheatCommandType::sleep:
-			res = res + "sleep$" + std::to_string(command.nParam[0]);
+		case WheatCommandType::whisper:
+			p = WriteOpcode(p, GetCommandTypeName(command.type));
+			p = WriteInt(p, command.nParam[0]);
+			*p++ = ':';
+			memcpy(p, command.GetText().data(), command.GetText().length());
+			p += command.GetText().length();
 			break;
+
 		case WheatCommandType::getup:
-			res += "getup$";
+		case WheatCommandType::kickover:
+		case WheatCommandType::ping:
+		case WheatCommandType::pong:
+			p = WriteOpcode(p, GetCommandTypeName(command.type));
 			break;
 
-		case WheatCommandType::chat:
-			res = res + "chat$" + command.strParam;
+		case WheatCommandType::redirect:
+			p = WriteOpcode(p, GetCommandTypeName(command.type));
+			memcpy(p, command.GetText().data(), command.GetText().length());
+			p += command.GetText().length();
+			*p++ = ':';
+			p = WriteInt(p, command.nParam[0]);
 			break;
 
 		case WheatCommandType::move:
-			res = res + "move$" + std::to_string(command.nParam[0]) + "," + std::to_string(command.nParam[1]);
-			break;
 		case WheatCommandType::pos:
-			res = res + "pos$" + std::to_string(command.nParam[0]) + "," + std::to_string(command.nParam[1]);
-			break;
-
-		case WheatCommandType::kick:
-			res = res + "kick$" + std::to_string(command.nParam[0]);
-			break;
 		case WheatCommandType::agree:
-			res = res + "agree$" + std::to_string(command.nParam[0]) + "," + std::to_string(command.nParam[1]);
-			break;
 		case WheatCommandType::refuse:
-			res = res + "refuse$" + std::to_string(command.nParam[0]) + "," + std::to_string(command.nParam[1]);
+		case WheatCommandType::time:
+		case WheatCommandType::tick:
+			p = WriteOpcode(p, GetCommandTypeName(command.type));
+			p = WriteInt(p, command.nParam[0]);
+			*p++ = ',';
+			p = WriteInt(p, command.nParam[1]);
 			break;
-		case WheatCommandType::kickover:
-			res += "kickover$";
+
+		// unknown κ
+		default:
 			break;
 	}
 
-	const char * szRes = res.c_str();
-	return res;
+	*p = '\0';
+	return static_cast<size_t>(p - dest);
+}
+
+size_t WheatCommandProgrammer::WriteFrame(char * dest, int sleeperId, const WheatCommand & command)
+{
+	char * p = WriteInt(dest, sleeperId);
+	*p++ = '\0';
+	p += WriteMessage(p, command) + 1;
+	return static_cast<size_t>(p - dest);
 }
 
 std::vector<std::string> WheatCommandProgrammer::CutMessage(const char* buf, const char delimiterChar, int pieces)
@@ -164,77 +279,102 @@ std::vector<std::string> WheatCommandProgrammer::CutMessage(const char* buf, siz
 	return result;
 }
 
+// ָ͵ƣ˳Ҫ WheatCommandType һ
+static const char * s_commandTypeNames[static_cast<int>(WheatCommandType::count)] = {
+	"unknown",
+
+	"yourid",
+	"sleeper",
+	"name",
+	"type",
+
+	"leave",
+
+	"sleep",
+	"getup",
+
+	"chat",
+	"whisper",
+
+	"move",
+	"pos",
+
+	"kick",
+	"agree",
+	"refuse",
+	"kickover",
+
+	"ping",
+	"pong",
+	"time",
+
+	"full",
+	"redirect",
+	"notice",
+
+	"crowd",
+	"beds",
+	"tick"
+};
+
 WheatCommandType WheatCommandProgrammer::GetCommandTypeFromString(const char* sz)
 {
-	if(strcmp(sz, "yourid") == 0)
-		return WheatCommandType::yourid;
-	if(strcmp(sz, "sleeper") == 0)
-		return WheatCommandType::sleeper;
-	if(strcmp(sz, "name") == 0)
-		return WheatCommandType::name;
-	if(strcmp(sz, "type") == 0)
-		return WheatCommandType::type;
-	
-	if(strcmp(sz, "leave") == 0)
-		return WheatCommandType::leave;
-
-	if(strcmp(sz, "sleep") == 0)
-		return WheatCommandType::sleep;
-	if(strcmp(sz, "getup") == 0)
-		return WheatCommandType::getup;
-
-	if(strcmp(sz, "chat") == 0)
-		return WheatCommandType::chat;
-
-	if(strcmp(sz, "move") == 0)
-		return WheatCommandType::move;
-	if(strcmp(sz, "pos") == 0)
-		return WheatCommandType::pos;
-
-	if(strcmp(sz, "kick") == 0)
-		return WheatCommandType::kick;
-	if(strcmp(sz, "agree") == 0)
-		return WheatCommandType::agree;
-	if(strcmp(sz, "refuse") == 0)
-		return WheatCommandType::refuse;
-	if(strcmp(sz, "kickover") == 0)
-		return WheatCommandType::kickover;
+	return GetCommandTypeFromString(sz, strlen(sz));
+}
+
+WheatCommandType WheatCommandProgrammer::GetCommandTypeFromString(const char * sz, size_t len)
+{
+	//  1 ʼ"unknown" ǿͻָܷ
+	for(int i = 1; i < static_cast<int>(WheatCommandType::count); i++) {
+		if(strncmp(sz, s_commandTypeNames[i], len) == 0 && s_commandTypeNames[i][len] == '\0')
+			return static_cast<WheatCommandType>(i);
+	}
 	
 	return WheatCommandType::unknown;
 }
 
+const char * WheatCommandProgrammer::GetCommandTypeName(WheatCommandType type)
+{
+	if(static_cast<int>(type) < 0 || type >= WheatCommandType::count) {
+		return s_commandTypeNames[0];
+	}
+	return s_commandTypeNames[static_cast<int>(type)];
+}
+
 void WheatCommandProgrammer::PrintWheatCommand(WheatCommand& command)
 {
 	printf("--------- Command Print ---------\n");
 	printf("type: %d\n", static_cast<int>(command.type));
-	printf("strParam: %s\n", command.strParam.c_str());
+	printf("text: %.*s\n", static_cast<int>(command.GetText().length()), command.GetText().data());
 	printf("nParams: [ %d, %d ]\n", command.nParam[0], command.nParam[1]);
 	printf("---------------------------------\n");
 }
 
-void WheatCommandProgrammer::VectorPushBackOriginalSleepersData(std::vector<int>* vectorDestSleepersIds, std::vector<WheatCommand>* vectorDestSleepersCommands, WheatBedManager & srcBedManager, int originalSleeperId)
+void WheatCommandProgrammer::ArrayPushBackOriginalSleepersData(int * destSleepersIds, WheatCommand * destSleepersCommands, size_t * pCommandNum, WheatBedManager & srcBedManager, int originalSleeperId, WheatArena * pArena)
 {
-	std::vector<int>* vecIds = vectorDestSleepersIds;
-	std::vector<WheatCommand>* vecCmds = vectorDestSleepersCommands;
+	int * ids = destSleepersIds;
+	WheatCommand * cmds = destSleepersCommands;
+	size_t & n = *pCommandNum;
 	WheatBedManager & bedManager = srcBedManager;
 	int sleeperId = originalSleeperId;
 	
-	vecIds->push_back(sleeperId);
-	vecCmds->push_back(WheatCommand(WheatCommandType::sleeper, "", sleeperId, 0));
-	vecIds->push_back(sleeperId);
-	vecCmds->push_back(WheatCommand(WheatCommandType::name, bedManager.m_sleepers[sleeperId].name.c_str(), 0, 0));
-	vecIds->push_back(sleeperId);
-	vecCmds->push_back(WheatCommand(WheatCommandType::type, "", static_cast<int>(bedManager.m_sleepers[sleeperId].type), 0));
+	ids[n] = sleeperId;
+	cmds[n++] = WheatCommand(WheatCommandType::sleeper, "", sleeperId, 0);
+	ids[n] = sleeperId;
+	cmds[n] = WheatCommand(WheatCommandType::name, "", 0, 0);
+	cmds[n++].SetText(bedManager.m_sleepers[sleeperId].name.c_str(), bedManager.m_sleepers[sleeperId].name.length(), pArena);
+	ids[n] = sleeperId;
+	cmds[n++] = WheatCommand(WheatCommandType::type, "", static_cast<int>(bedManager.m_sleepers[sleeperId].type), 0);
 
 	if(bedManager.m_sleepers[sleeperId].sleepingBedId != -1) {
-		vecIds->push_back(sleeperId);
-		vecCmds->push_back(WheatCommand(WheatCommandType::sleep, "", bedManager.m_sleepers[sleeperId].sleepingBedId, 0));
+		ids[n] = sleeperId;
+		cmds[n++] = WheatCommand(WheatCommandType::sleep, "", bedManager.m_sleepers[sleeperId].sleepingBedId, 0);
 	} else {
-		vecIds->push_back(sleeperId);
-		vecCmds->push_back(WheatCommand(WheatCommandType::pos, "", bedManager.m_sleepers[sleeperId].posLastData.x, bedManager.m_sleepers[sleeperId].posLastData.y));
+		ids[n] = sleeperId;
+		cmds[n++] = WheatCommand(WheatCommandType::pos, "", bedManager.m_sleepers[sleeperId].posLastData.x, bedManager.m_sleepers[sleeperId].posLastData.y);
 		if(bedManager.m_sleepers[sleeperId].firstMoved == true) {
-			vecIds->push_back(sleeperId);
-			vecCmds->push_back(WheatCommand(WheatCommandType::move, "", bedManager.m_sleepers[sleeperId].moveLastData.x, bedManager.m_sleepers[sleeperId].moveLastData.y));
+			ids[n] = sleeperId;
+			cmds[n++] = WheatCommand(WheatCommandType::move, "", bedManager.m_sleepers[sleeperId].moveLastData.x, bedManager.m_sleepers[sleeperId].moveLastData.y);
 		}
 	}
 }
@@ -1,9 +1,20 @@
 #pragma once
 
 #include "WheatBedManager.h"
+#include "WheatArena.h"
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstring>
+#include <type_traits>
+
+// ֱָӷŵµֳȣֽڣһָռһУ64 ֽڣ
+// ֺʹ󲿷춼ŵ£ַŵʱֿ(WheatArena)ָֻһָ
+#define WHEATCOMMAND_INLINE_TEXT_SIZE 48
+
+// ˯ͽһλ˯Ҫָsleepernametypeټ sleep  posmove
+#define WHEATCOMMAND_SLEEPER_DATA_MAX 4
 
 enum class WheatCommandType {
 	unknown,
@@ -19,6 +30,7 @@ enum class WheatCommandType {
 	getup,
 
 	chat,
+	whisper,
 
 	move,
 	pos,
@@ -26,19 +38,52 @@ enum class WheatCommandType {
 	kick,
 	agree,
 	refuse,
-	kickover
+	kickover,
+
+	ping,
+	pong,
+	time,
+
+	full,
+	redirect,
+	notice,
+
+	crowd,
+	beds,
+	tick,
+
+	// ָ͵ָµָҪǰ
+	count
 };
 
+// ָӵκζڴ棬 memcpyŽСϰնڴ
+// ֲҪôֱӷָҪôָʱֿһڴ棬ֻڲֿ Reset() ֮ǰЧ
 class WheatCommand {
 public:
 	WheatCommand() {}
-	WheatCommand(WheatCommandType _type, const char * _strParam, const int nParam_0, const int nParam_1) { type = _type; strParam = _strParam; nParam[0] = nParam_0; nParam[1] = nParam_1; }
+	// _strParam ŲµĲֻᱻصҪųֵĻ SetText() һʱֿ
+	WheatCommand(WheatCommandType _type, const char * _strParam, const int nParam_0, const int nParam_1) { type = _type; SetText(_strParam, strlen(_strParam), nullptr); nParam[0] = nParam_0; nParam[1] = nParam_1; }
+
+	// ֲŲµʱŵ pArena pArena Ϊ nullptr ʱصŲµĲ
+	void SetText(const char * text, size_t len, WheatArena * pArena);
+
+	inline std::string_view GetText() const { return std::string_view(m_textSpilled ? m_text.pSpilled : m_text.inlineText, m_textLen); }
 
 	WheatCommandType type = WheatCommandType::unknown;
-	std::string strParam = "";
 	int nParam[2] = { 0, 0 };
+
+private:
+	unsigned short m_textLen = 0;
+	bool m_textSpilled = false;
+
+	union {
+		char inlineText[WHEATCOMMAND_INLINE_TEXT_SIZE];
+		const char * pSpilled;
+	} m_text = { "" };
 };
 
+static_assert(std::is_trivially_copyable<WheatCommand>::value, "WheatCommand must stay memcpy-able");
+
 // ָԱ𱾹˾ķ˵ָɹ
 // ָԱʵһֱ TCPԱ(WheatTCPServer)ˣָԱڹ˾һͬͬ¾TCPԱ
 class WheatCommandProgrammer {
@@ -46,10 +91,20 @@ public:
 
 	// ָ
 	WheatCommand Parse(const char * buf);
+	// ֡Ա(WheatFrameScanner)ѾҺñָ߽buf[len]  '\0'opcodeLen Ϊָȣһ '$' λã
+	// Ųָĳַŵ pArena pArena Ϊ nullptr ʱص
+	WheatCommand Parse(const char * buf, size_t len, size_t opcodeLen, WheatArena * pArena = nullptr);
 
 	// ָϢ
 	std::string MakeMessage(const WheatCommand & command);
 
+	// ָһ֡ "˯id\0Ϣ\0" ҪֽڣǰʱֿҪڴ
+	size_t GetFrameMaxSize(const WheatCommand & command);
+	// Ϣֱд destβ '\0'дֽβ '\0'κڴ
+	size_t WriteMessage(char * dest, const WheatCommand & command);
+	// һ֡ "˯id\0Ϣ\0" ֱд destдֽ '\0'dest Ҫ GetFrameMaxSize() ֽ
+	size_t WriteFrame(char * dest, int sleeperId, const WheatCommand & command);
+
 	// иϢ
 	// buf ҪָϢdelimiterChar ָţpieces ʾҪƬķĬ0Ϊָÿһ
 	//  ("ABC$DEF$114$514", '$', 3) õ "ABC" "DEF" "114$514"
@@ -57,10 +112,16 @@ public:
 	std::vector<std::string> CutMessage(const char * buf, size_t len, const char delimiterChar, int pieces = 0);
 
 	WheatCommandType GetCommandTypeFromString(const char * sz);
+	WheatCommandType GetCommandTypeFromString(const char * sz, size_t len);
+
+	// ȡָ͵ƣ GetCommandTypeName(WheatCommandType::move) ᷵ "move"
+	const char * GetCommandTypeName(WheatCommandType type);
 
 	void PrintWheatCommand(WheatCommand & command);
 	
-	void VectorPushBackOriginalSleepersData(std::vector<int> * vectorDestSleepersIds, std::vector<WheatCommand> * vectorDestSleepersCommands, WheatBedManager & srcBedManager, int originalSleeperId);
+	// һλ˯͵׷ӵ destSleepersIds  destSleepersCommands ĵ *pCommandNum λú棬*pCommandNum ֮
+	// ٻҪ WHEATCOMMAND_SLEEPER_DATA_MAX λ
+	void ArrayPushBackOriginalSleepersData(int * destSleepersIds, WheatCommand * destSleepersCommands, size_t * pCommandNum, WheatBedManager & srcBedManager, int originalSleeperId, WheatArena * pArena = nullptr);
 
 private:
 
@@ -0,0 +1,299 @@
+#include "WheatConfig.h"
+#include "ProjectCommon.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// ᣬֻҪ WheatConfig һԱǼһ
+// pIntpBoolpString ֻһ nullptrֵ [minValue, maxValue] ֮
+struct WheatConfigItem {
+	const char * name;
+	int WheatConfig::* pInt;
+	bool WheatConfig::* pBool;
+	std::string WheatConfig::* pString;
+	int minValue;
+	int maxValue;
+	bool hotReload;
+};
+
+static const WheatConfigItem s_configItems[] = {
+	{ "mode",					nullptr,								nullptr,						& WheatConfig::mode,	0, 0, false },
+	{ "listen_address",			nullptr,								nullptr,						& WheatConfig::listenAddress,	0, 0, false },
+	{ "port",					& WheatConfig::port,					nullptr,						nullptr,	1, 65535, false },
+	{ "recv_buffer_size",		& WheatConfig::recvBufferSize,			nullptr,						nullptr,	256, 1024 * 1024, false },
+	{ "session_pool_size",		& WheatConfig::sessionPoolSize,			nullptr,						nullptr,	0, 65536, false },
+	{ "large_pages",			nullptr,								& WheatConfig::largePages,		nullptr,	0, 0, false },
+	{ "event_loop_cpu",			& WheatConfig::eventLoopCpu,			nullptr,						nullptr,	-1, 4095, false },
+	{ "stdin_cpu",				& WheatConfig::stdinCpu,				nullptr,						nullptr,	-1, 4095, false },
+	{ "numa_local_memory",		nullptr,								& WheatConfig::numaLocalMemory,	nullptr,	0, 0, false },
+	{ "admin_port",				& WheatConfig::adminPort,				nullptr,						nullptr,	0, 65535, false },
+	{ "directory_address",		nullptr,								nullptr,						& WheatConfig::directoryAddress,	0, 0, false },
+	{ "directory_port",			& WheatConfig::directoryPort,			nullptr,						nullptr,	1, 65535, false },
+	{ "directory_listen_address",	nullptr,							nullptr,						& WheatConfig::directoryListenAddress,	0, 0, false },
+	{ "node_name",				nullptr,								nullptr,						& WheatConfig::nodeName,	0, 0, false },
+	{ "room_name",				nullptr,								nullptr,						& WheatConfig::roomName,	0, 0, false },
+	{ "public_address",			nullptr,								nullptr,						& WheatConfig::publicAddress,	0, 0, false },
+	{ "bus_port",				& WheatConfig::busPort,					nullptr,						nullptr,	0, 65535, false },
+	{ "bus_listen_address",		nullptr,								nullptr,						& WheatConfig::busListenAddress,	0, 0, false },
+	{ "websocket_port",			& WheatConfig::websocketPort,			nullptr,						nullptr,	0, 65535, false },
+	{ "websocket_tls",			nullptr,								& WheatConfig::websocketTls,	nullptr,	0, 0, false },
+	{ "tls_port",				& WheatConfig::tlsPort,					nullptr,						nullptr,	0, 65535, false },
+	{ "tls_certificate",		nullptr,								nullptr,						& WheatConfig::tlsCertificate,	0, 0, false },
+	{ "tls_password",			nullptr,								nullptr,						& WheatConfig::tlsPassword,	0, 0, false },
+	{ "tls_session_minutes",	& WheatConfig::tlsSessionMinutes,		nullptr,						nullptr,	1, 24 * 60, false },
+	{ "spectator_port",			& WheatConfig::spectatorPort,			nullptr,						nullptr,	0, 65535, false },
+	{ "gateway_link_port",		& WheatConfig::gatewayLinkPort,			nullptr,						nullptr,	0, 65535, false },
+	{ "gateway_backends",		nullptr,								nullptr,						& WheatConfig::gatewayBackends,	0, 0, false },
+	{ "gateway_link_address",	nullptr,								nullptr,						& WheatConfig::gatewayLinkAddress,	0, 0, false },
+	{ "gateway_links_per_backend",	& WheatConfig::gatewayLinksPerBackend,	nullptr,					nullptr,	1, 8, false },
+	{ "link_secret",			nullptr,								nullptr,						& WheatConfig::linkSecret,	0, 0, false },
+
+	{ "tick_ms",				& WheatConfig::tickMs,					nullptr,						nullptr,	1, 1000, true },
+	{ "vote_seconds",			& WheatConfig::voteSeconds,				nullptr,						nullptr,	1, 3600, true },
+	{ "heartbeat_ms",			& WheatConfig::heartbeatMs,				nullptr,						nullptr,	100, 3600 * 1000, true },
+	{ "idle_timeout_ms",		& WheatConfig::idleTimeoutMs,			nullptr,						nullptr,	100, 24 * 3600 * 1000, true },
+	{ "handshake_timeout_ms",	& WheatConfig::handshakeTimeoutMs,		nullptr,						nullptr,	100, 3600 * 1000, true },
+	{ "max_connections",		& WheatConfig::maxConnections,			nullptr,						nullptr,	1, 1000000, true },
+	{ "max_connections_per_ip",	& WheatConfig::maxConnectionsPerIP,		nullptr,						nullptr,	1, 1000000, true },
+	{ "accepts_per_second",		& WheatConfig::acceptsPerSecond,		nullptr,						nullptr,	1, 1000000, true },
+	{ "accept_burst",			& WheatConfig::acceptBurst,				nullptr,						nullptr,	1, 1000000, true },
+	{ "handler_timing",			nullptr,								& WheatConfig::handlerTiming,	nullptr,	0, 0, true },
+	{ "latency_sample_every",	& WheatConfig::latencySampleEvery,		nullptr,						nullptr,	0, 1000000, true },
+	{ "loop_budget_ms",			& WheatConfig::loopBudgetMs,			nullptr,						nullptr,	0, 10000, true },
+	{ "spectator_interval_ms",	& WheatConfig::spectatorIntervalMs,		nullptr,						nullptr,	10, 10000, true },
+	{ "crowd_threshold",		& WheatConfig::crowdThreshold,			nullptr,						nullptr,	0, 1000000, true },
+	{ "crowd_radius",			& WheatConfig::crowdRadius,				nullptr,						nullptr,	16, 1000000, true },
+	{ "crowd_cell_size",		& WheatConfig::crowdCellSize,			nullptr,						nullptr,	16, 1000000, true },
+	{ "crowd_interval_ms",		& WheatConfig::crowdIntervalMs,			nullptr,						nullptr,	50, 60000, true },
+	{ "chat_radius",			& WheatConfig::chatRadius,				nullptr,						nullptr,	0, 1000000, true },
+	{ "chat_history_size",		& WheatConfig::chatHistorySize,			nullptr,						nullptr,	0, 1000, true },
+	{ "redirect_percent",		& WheatConfig::redirectPercent,			nullptr,						nullptr,	1, 100, true },
+	{ "gateway_messages_per_second",	& WheatConfig::gatewayMessagesPerSecond,	nullptr,				nullptr,	1, 100000, true },
+	{ "gateway_message_burst",	& WheatConfig::gatewayMessageBurst,		nullptr,						nullptr,	1, 100000, true },
+};
+
+static const WheatConfigItem * FindConfigItem(const char * name)
+{
+	for(const WheatConfigItem & item : s_configItems) {
+		if(strcmp(item.name, name) == 0) {
+			return & item;
+		}
+	}
+	return nullptr;
+}
+
+static bool SameConfigValue(const WheatConfig & a, const WheatConfig & b, const WheatConfigItem & item)
+{
+	if(item.pInt != nullptr) {
+		return a.*item.pInt == b.*item.pInt;
+	}
+	if(item.pBool != nullptr) {
+		return a.*item.pBool == b.*item.pBool;
+	}
+	return a.*item.pString == b.*item.pString;
+}
+
+static void CopyConfigValue(WheatConfig & dest, const WheatConfig & src, const WheatConfigItem & item)
+{
+	if(item.pInt != nullptr) {
+		dest.*item.pInt = src.*item.pInt;
+	} else if(item.pBool != nullptr) {
+		dest.*item.pBool = src.*item.pBool;
+	} else {
+		dest.*item.pString = src.*item.pString;
+	}
+}
+
+// ȥβĿհף͵޸ģµ
+static char * Trim(char * str)
+{
+	while(*str == ' ' || *str == '\t') {
+		str++;
+	}
+	size_t len = strlen(str);
+	while(len > 0 && (str[len - 1] == ' ' || str[len - 1] == '\t' || str[len - 1] == '\r' || str[len - 1] == '\n')) {
+		str[--len] = '\0';
+	}
+	return str;
+}
+
+bool WheatConfig::Load(int argc, char * argv[])
+{
+	bool ok = true;
+
+	m_overrides.clear();
+	for(int i = 1; i < argc; i++) {
+		const char * arg = argv[i];
+		const char * pEqual = strchr(arg, '=');
+		if(strncmp(arg, "--", 2) != 0 || pEqual == nullptr) {
+			printf("Unknown Argument: %s\n", arg);
+			ok = false;
+			continue;
+		}
+
+		std::string name(arg + 2, pEqual - arg - 2);
+		if(name == "config") {
+			m_path = pEqual + 1;
+		} else {
+			m_overrides.push_back(std::make_pair(name, std::string(pEqual + 1)));
+		}
+	}
+
+	if(LoadFile(m_path.c_str()) == false) {
+		printf("Config File %s Not Found, Using Defaults.\n", m_path.c_str());
+	}
+
+	for(auto & override : m_overrides) {
+		if(Set(override.first.c_str(), override.second.c_str()) == false) {
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+bool WheatConfig::LoadFile(const char * path)
+{
+	m_fileModifiedTime = GetFileModifiedTime();
+
+	FILE * file = fopen(path, "r");
+	if(file == nullptr) {
+		return false;
+	}
+
+	char line[512];
+	int lineNum = 0;
+	while(fgets(line, sizeof(line), file) != nullptr) {
+		lineNum++;
+
+		char * pComment = strchr(line, '#');
+		if(pComment != nullptr) {
+			*pComment = '\0';
+		}
+
+		char * str = Trim(line);
+		if(*str == '\0') {
+			continue;
+		}
+
+		char * pEqual = strchr(str, '=');
+		if(pEqual == nullptr) {
+			printf("%s:%d Missing '='!\n", path, lineNum);
+			continue;
+		}
+		*pEqual = '\0';
+
+		if(Set(Trim(str), Trim(pEqual + 1)) == false) {
+			printf("%s:%d Ignored.\n", path, lineNum);
+		}
+	}
+
+	fclose(file);
+	return true;
+}
+
+bool WheatConfig::Set(const char * name, const char * value)
+{
+	const WheatConfigItem * pItem = FindConfigItem(name);
+	if(pItem == nullptr) {
+		printf("Unknown Config: %s\n", name);
+		return false;
+	}
+
+	if(pItem->pString != nullptr) {
+		this->*pItem->pString = value;
+		return true;
+	}
+
+	if(pItem->pBool != nullptr) {
+		if(strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+			this->*pItem->pBool = true;
+			return true;
+		}
+		if(strcmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+			this->*pItem->pBool = false;
+			return true;
+		}
+		printf("Config %s Must Be true Or false: %s\n", name, value);
+		return false;
+	}
+
+	char * pEnd = nullptr;
+	long n = strtol(value, & pEnd, 10);
+	if(pEnd == value || *pEnd != '\0' || n < pItem->minValue || n > pItem->maxValue) {
+		printf("Config %s Must Be An Integer In [%d, %d]: %s\n", name, pItem->minValue, pItem->maxValue, value);
+		return false;
+	}
+	this->*pItem->pInt = static_cast<int>(n);
+	return true;
+}
+
+bool WheatConfig::ReloadIfChanged()
+{
+	if(GetFileModifiedTime() == m_fileModifiedTime) {
+		return false;
+	}
+
+	// ȶһݸеĸЧ
+	WheatConfig next = *this;
+	if(next.LoadFile(m_path.c_str()) == false) {
+		// ļɾˣԭֻǼʱ䣬һֱض
+		m_fileModifiedTime = next.m_fileModifiedTime;
+		return false;
+	}
+	for(auto & override : m_overrides) {
+		next.Set(override.first.c_str(), override.second.c_str());
+	}
+
+	// ֻʱЧȸ£ԭ
+	bool changed = false;
+	for(const WheatConfigItem & item : s_configItems) {
+		if(SameConfigValue(*this, next, item)) {
+			continue;
+		}
+		if(item.hotReload == false) {
+			printf("Config %s Changed, Restart Required.\n", item.name);
+			CopyConfigValue(next, *this, item);
+			continue;
+		}
+		changed = true;
+	}
+
+	*this = next;
+
+	if(changed) {
+		printf("Config Reloaded.\n");
+		Print();
+	}
+	return changed;
+}
+
+void WheatConfig::Print()
+{
+	printf("------------- Config ------------\n");
+	for(const WheatConfigItem & item : s_configItems) {
+		if(item.pInt != nullptr) {
+			printf("%-28s = %d\n", item.name, this->*item.pInt);
+		} else if(item.pBool != nullptr) {
+			printf("%-28s = %s\n", item.name, this->*item.pBool ? "true" : "false");
+		} else if(item.pString == & WheatConfig::tlsPassword && tlsPassword.empty() == false) {
+			// 벻
+			printf("%-28s = ******\n", item.name);
+		} else {
+			printf("%-28s = %s\n", item.name, (this->*item.pString).c_str());
+		}
+	}
+	printf("---------------------------------\n");
+}
+
+long long WheatConfig::GetFileModifiedTime()
+{
+	struct stat fileStat;
+	if(stat(m_path.c_str(), & fileStat) != 0) {
+		return 0;
+	}
+	return static_cast<long long>(fileStat.st_mtime);
+}
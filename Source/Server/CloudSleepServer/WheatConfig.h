@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// ĬϵļͳĹĿ¼һ
+#define WHEATCONFIG_DEFAULT_PATH "ServerConfig.txt"
+
+// ùԱǰдڴĸֵ˿ڡСδơŵļ
+// ļÿһ " = ֵ"'#' עͣϵ --=ֵ Ḳļͬ--config=· ָļ
+// ʱļԶ¶ȡȸµЧֻʱЧҪУʾ
+class WheatConfig {
+public:
+
+	/* ֻʱЧ */
+
+	std::string mode = "room";				// room Ϊͨķdirectory Ϊ̨gateway Ϊأsimulate Ϊϰ
+	std::string listenAddress = "0.0.0.0";	// ĵַ
+	int port = 11451;						// Ķ˿
+	int recvBufferSize = 4096;				// ÿӵĽջСһϢܱ
+	int sessionPoolSize = 1024;				// Ԥ׼õĻỰ
+	bool largePages = false;				// ỰڴǷڴҳ
+	int eventLoopCpu = -1;					// ¼ѭĸ߼ϣ-1 ʾ
+	int stdinCpu = -1;						// ̶̨߳ĸ߼ϣ-1 ʾ
+	bool numaLocalMemory = true;			// ס¼ѭʱỰڴǷڵ NUMA ڵ
+	int adminPort = 11452;					// ˿ڣֻ 127.0.0.10 ʾ
+
+	std::string directoryAddress = "";		// ̨ĵַΪʱ
+	int directoryPort = 11460;				// ̨ UDP ˿ڣ̨ԼҲ˿
+	std::string directoryListenAddress = "127.0.0.1";	// ̨ձĵַǱַʱ linkSecret
+	std::string nodeName = "";				// ڵ̨֣Ϊʱ "ַ:˿"
+	std::string roomName = "default";		// ڵ㿪ķ
+	std::string publicAddress = "127.0.0.1";	// ˯ӱڵҪõĵַ̨߱Ľڵ
+	int busPort = 11461;					// ̨Ϣߵ TCP ˿ڣ̨ԼҲ˿ڣ0 ʾ
+	std::string busListenAddress = "127.0.0.1";	// ̨Ϣ߼ĵַǱַʱ linkSecret
+
+	int websocketPort = 0;					// ˯ WebSocket ӵĶ˿ڣ0 ʾ
+	bool websocketTls = false;				// WebSocket ˿Ƿܣwss://
+
+	int tlsPort = 0;						// ӵĶ˿ڣ0 ʾ
+	std::string tlsCertificate = "server.pfx";	// ֤˽ԿPFX ʽ
+	std::string tlsPassword = "";			// PFX ļ
+	int tlsSessionMinutes = 10;				// TLS Ựãôڶ
+
+	int spectatorPort = 0;					// ӵĶ˿ڣ0 ʾ
+
+	int gatewayLinkPort = 0;				// Ӵ·Ķ˿ڣ0 ʾ
+	std::string gatewayLinkAddress = "127.0.0.1";	// Ӵ·ĵַǱַʱ linkSecret
+	std::string gatewayBackends = "127.0.0.1:11470";	// Ҫķ"ַ:˿"  ',' 
+	int gatewayLinksPerBackend = 2;			// غÿ֮俪·
+
+	std::string linkSecret = "";			// ֮䳤··ϢߣİţԺһ֡ԷԲϵ·ֱӶϿڵ̨ҲҪ
+
+	/* ȸ */
+
+	int tickMs = 10;					// ʱӵδļҲ select ȴʱ
+	int voteSeconds = 10;				// ͶƱ˳
+	int heartbeatMs = 15000;			// ûյĳӵϢͷһ
+	int idleTimeoutMs = 45000;			// ûյĳӵκϢͶϿ
+	int handshakeTimeoutMs = 10000;		// WebSocket ӽԺûû־ͶϿ
+	int maxConnections = 1000;			// ȫͬʱжٸ
+	int maxConnectionsPerIP = 16;		// ͬһ IP ͬʱжٸ
+	int acceptsPerSecond = 50;			// ÿŶٸӽ
+	int acceptBurst = 100;				// һŶٸӽ
+	bool handlerTiming = true;			// Ƿͳָʱ
+	int latencySampleEvery = 0;			// ÿϢ׷һյͳŵĺʱ0 ʾ׷
+	int loopBudgetMs = 50;				// ¼ѭһȦæã˾Զ0 ʾ
+	int spectatorIntervalMs = 250;		// ڶһηı仯
+	int crowdThreshold = 0;				// ˯ʹﵽʱȺģʽ0 ʾ
+	int crowdRadius = 800;				// Ⱥģʽö˯ͲŻյ˴˵ move  posأ
+	int crowdCellSize = 400;			// Ⱥģʽ»ֵͼĸӱ߳أ
+	int crowdIntervalMs = 1000;			// Ⱥģʽ¶÷һȺſ
+	int chatRadius = 0;					// ֻ˯ͣأ0 ʾ˯
+	int chatHistorySize = 20;			// ס죬˯ͽʱſһ𷢣0 ʾ
+	int redirectPercent = 80;			// ﵽİٷ֮ʱ˯̨ƼĸеĽڵ
+	int gatewayMessagesPerSecond = 20;	// ÿλ˯ÿתϢ
+	int gatewayMessageBurst = 40;		// ÿλ˯һתϢ
+
+	// ȡУ--config=· ָļĬ WHEATCONFIG_DEFAULT_PATHȻȡļϵ
+	// вʶ߲Ϸ falseӡܶЧ
+	bool Load(int argc, char * argv[]);
+
+	// ȡļļʱ falseԭ
+	bool LoadFile(const char * path);
+
+	// һƲʶֵϷ false
+	bool Set(const char * name, const char * value);
+
+	// ļĹĻ¶ȡ¼ѭڵã true ʾñˣҪӦ
+	// ֻʱЧʹļҲԭʾҪ
+	bool ReloadIfChanged();
+
+	// ӡ
+	void Print();
+
+	inline const std::string & GetPath() { return m_path; }
+
+private:
+
+	// ļһ޸ĵʱ䣬жҪҪ¶ȡ
+	long long GetFileModifiedTime();
+
+	std::string m_path = WHEATCONFIG_DEFAULT_PATH;
+	long long m_fileModifiedTime = 0;
+
+	// ϵĸÿ¶ȡļԺҪ¸һ
+	std::vector<std::pair<std::string, std::string>> m_overrides;
+};
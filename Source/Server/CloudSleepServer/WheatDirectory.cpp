@@ -0,0 +1,346 @@
+#include "WheatDirectory.h"
+#include "ProjectCommon.h"
+#include "WheatCommand.h"
+
+#include <iostream>
+#include <cstdlib>
+
+// a  b еĻ true˱Ƚ /ó
+static bool IsLessLoaded(long long aConnections, long long aMaxConnections, long long bConnections, long long bMaxConnections)
+{
+	return aConnections * MAX(bMaxConnections, 1) < bConnections * MAX(aMaxConnections, 1);
+}
+
+// ظ "best$ַ$˿$$"
+static void MakeBestReply(const WheatNodeInfo & node, std::string * pReply)
+{
+	char reply[WHEATDIRECTORY_MESSAGE_SIZE];
+	snprintf(reply, sizeof(reply), "best$%s$%d$%d$%d", node.host.c_str(), node.port, node.connections, node.maxConnections);
+	*pReply = reply;
+}
+
+bool WheatDirectory::Init(const char * listenAddress, int port, const std::string & secret, int busPort, const char * busAddress)
+{
+	if(secret.empty() && WheatMuxIsLoopback(listenAddress) == false) {
+		printf("Directory Refuses To Listen On %s Without link_secret!\n", listenAddress);
+		return false;
+	}
+	m_secret = secret;
+
+	if(WSAStartup(MAKEWORD(2, 2), &m_WSAData) != 0) {
+		printf("WSAStartup Failed!\n");
+		return false;
+	}
+
+	m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(m_socket == INVALID_SOCKET) {
+		printf("Directory socket Error!! %d\n", WSAGetLastError());
+		return false;
+	}
+
+	sockaddr_in address;
+	memset(& address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.S_un.S_addr = inet_addr(listenAddress);
+	if(address.sin_addr.S_un.S_addr == INADDR_NONE) {
+		printf("Invalid Directory Address %s!\n", listenAddress);
+		return false;
+	}
+	if(bind(m_socket, (sockaddr *)& address, sizeof(address)) == SOCKET_ERROR) {
+		printf("Directory bind Error!! %d\n", WSAGetLastError());
+		return false;
+	}
+
+	printf("Directory Listening On UDP %s:%d.\n", listenAddress, port);
+
+	return m_busBroker.Start(busAddress, busPort, secret);
+}
+
+void WheatDirectory::Close()
+{
+	m_busBroker.Close();
+	if(m_socket != INVALID_SOCKET) {
+		closesocket(m_socket);
+		m_socket = INVALID_SOCKET;
+	}
+	WSACleanup();
+}
+
+void WheatDirectory::Run()
+{
+	printf("Directory Start to Run.\n");
+
+	long long nextExpireMs = m_pClock->NowMs() + WHEATDIRECTORY_REPORT_MS;
+
+	while(1) {
+		fd_set fdRead;
+		FD_ZERO(&fdRead);
+		FD_SET(m_socket, &fdRead);
+		m_busBroker.AddToFdSet(&fdRead);
+
+		// tv_usec Сһ룬룬Ž tv_sec
+		timeval tm;
+		tm.tv_sec = WHEATDIRECTORY_REPORT_MS / 1000;
+		tm.tv_usec = (WHEATDIRECTORY_REPORT_MS % 1000) * 1000;
+
+		int selectRes = select(0, &fdRead, NULL, NULL, &tm);
+
+		// յϢתȥһα
+		if(selectRes > 0) {
+			m_busBroker.Poll(&fdRead);
+			m_busBroker.Flush();
+		}
+
+		if(selectRes > 0 && FD_ISSET(m_socket, &fdRead)) {
+			char message[WHEATDIRECTORY_MESSAGE_SIZE];
+			sockaddr_in from;
+			int fromLen = sizeof(from);
+
+			// ظʱ Windows һ recvfrom  WSAECONNRESETù
+			int recvRes = recvfrom(m_socket, message, sizeof(message) - 1, 0, (sockaddr *)& from, & fromLen);
+			if(recvRes > 0) {
+				message[recvRes] = '\0';
+
+				size_t nodeNum = m_nodes.size();
+				std::string reply;
+				if(HandleMessage(message, & reply)) {
+					sendto(m_socket, reply.c_str(), int(reply.size()), 0, (sockaddr *)& from, fromLen);
+				}
+				if(m_nodes.size() != nodeNum) {
+					PrintNodes();
+					m_busBroker.PrintLinks();
+				}
+			}
+		}
+
+		if(m_pClock->NowMs() >= nextExpireMs) {
+			if(ExpireNodes() > 0) {
+				PrintNodes();
+			}
+			nextExpireMs = m_pClock->NowMs() + WHEATDIRECTORY_REPORT_MS;
+		}
+	}
+}
+
+bool WheatDirectory::HandleMessage(const char * message, std::string * pReply)
+{
+	// е 8 Ϊֹ '$' Ҳûϵ
+	WheatCommandProgrammer commandProgrammer;
+	std::vector<std::string> pieces = commandProgrammer.CutMessage(message, '$', 8);
+
+	std::string room;
+	if(pieces[0] == "node" && pieces.size() == 8) {
+		if(WheatMuxSecretMatch(pieces[7].data(), pieces[7].size(), m_secret) == false) {
+			printf("Directory Refused Node %s, Bad Secret.\n", pieces[1].c_str());
+			return false;
+		}
+
+		// ½ڵǼϽڵ¸
+		WheatNodeInfo * pNode = nullptr;
+		for(WheatNodeInfo & node : m_nodes) {
+			if(node.name == pieces[1]) {
+				pNode = & node;
+				break;
+			}
+		}
+		if(pNode == nullptr) {
+			m_nodes.push_back(WheatNodeInfo());
+			pNode = & m_nodes.back();
+			pNode->name = pieces[1];
+			printf("Node %s Joined.\n", pieces[1].c_str());
+		}
+
+		pNode->room = pieces[2];
+		pNode->host = pieces[3];
+		pNode->port = atoi(pieces[4].c_str());
+		pNode->connections = atoi(pieces[5].c_str());
+		pNode->maxConnections = atoi(pieces[6].c_str());
+		pNode->lastSeenMs = m_pClock->NowMs();
+
+		room = pNode->room;
+	} else if(pieces[0] == "where" && pieces.size() == 2) {
+		room = pieces[1];
+	} else {
+		printf("Directory Unknown Message: %s\n", message);
+		return false;
+	}
+
+	const WheatNodeInfo * pBest = FindBestNode(room);
+	if(pBest == nullptr) {
+		*pReply = "best$";
+	} else {
+		MakeBestReply(*pBest, pReply);
+	}
+	return true;
+}
+
+const WheatNodeInfo * WheatDirectory::FindBestNode(const std::string & room)
+{
+	const WheatNodeInfo * pBest = nullptr;
+	for(const WheatNodeInfo & node : m_nodes) {
+		if(node.room != room) {
+			continue;
+		}
+		if(pBest == nullptr || IsLessLoaded(node.connections, node.maxConnections, pBest->connections, pBest->maxConnections)) {
+			pBest = & node;
+		}
+	}
+	return pBest;
+}
+
+int WheatDirectory::ExpireNodes()
+{
+	int expiredNum = 0;
+	long long nowMs = m_pClock->NowMs();
+	for(size_t i = 0; i < m_nodes.size(); ) {
+		if(nowMs - m_nodes[i].lastSeenMs < WHEATDIRECTORY_NODE_TIMEOUT_MS) {
+			i++;
+			continue;
+		}
+		printf("Node %s Timeout.\n", m_nodes[i].name.c_str());
+		m_nodes[i] = m_nodes.back();
+		m_nodes.pop_back();
+		expiredNum++;
+	}
+	return expiredNum;
+}
+
+void WheatDirectory::PrintNodes()
+{
+	printf("------------- Nodes -------------\n");
+	for(const WheatNodeInfo & node : m_nodes) {
+		printf("%-20s %-12s %s:%d  %d / %d\n", node.name.c_str(), node.room.c_str(), node.host.c_str(), node.port, node.connections, node.maxConnections);
+	}
+	printf("---------------------------------\n");
+}
+
+WheatDirectoryAgent::~WheatDirectoryAgent()
+{
+	if(m_socket != INVALID_SOCKET) {
+		closesocket(m_socket);
+	}
+}
+
+bool WheatDirectoryAgent::Start(const char * directoryAddress, int directoryPort, const char * nodeName, const char * roomName, const char * publicHost, int publicPort, const std::string & secret)
+{
+	if(directoryAddress == nullptr || *directoryAddress == '\0') {
+		return true;
+	}
+
+	memset(& m_directoryAddress, 0, sizeof(m_directoryAddress));
+	m_directoryAddress.sin_family = AF_INET;
+	m_directoryAddress.sin_port = htons(directoryPort);
+	m_directoryAddress.sin_addr.S_un.S_addr = inet_addr(directoryAddress);
+	if(m_directoryAddress.sin_addr.S_un.S_addr == INADDR_NONE) {
+		printf("Invalid Directory Address %s!\n", directoryAddress);
+		return false;
+	}
+
+	m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(m_socket == INVALID_SOCKET) {
+		printf("Directory Agent socket Error!! %d\n", WSAGetLastError());
+		return false;
+	}
+
+	// ջظʱܿס¼ѭ
+	u_long nonBlocking = 1;
+	ioctlsocket(m_socket, FIONBIO, & nonBlocking);
+
+	m_secret = secret;
+	m_self.room = roomName;
+	m_self.host = publicHost;
+	m_self.port = publicPort;
+	if(nodeName != nullptr && *nodeName != '\0') {
+		m_self.name = nodeName;
+	} else {
+		m_self.name = m_self.host + ":" + std::to_string(publicPort);
+	}
+
+	m_nextReportMs = m_pClock->NowMs();
+
+	printf("Node %s Reporting To Directory %s:%d.\n", m_self.name.c_str(), directoryAddress, directoryPort);
+	return true;
+}
+
+void WheatDirectoryAgent::AddToFdSet(fd_set * pReadSet)
+{
+	if(m_socket != INVALID_SOCKET) {
+		FD_SET(m_socket, pReadSet);
+	}
+}
+
+void WheatDirectoryAgent::Poll(fd_set * pReadSet)
+{
+	if(m_socket == INVALID_SOCKET || FD_ISSET(m_socket, pReadSet) == false) {
+		return;
+	}
+	FD_CLR(m_socket, pReadSet);
+
+	char message[WHEATDIRECTORY_MESSAGE_SIZE];
+	int recvRes = 0;
+	while((recvRes = recv(m_socket, message, sizeof(message) - 1, 0)) > 0) {
+		message[recvRes] = '\0';
+
+		WheatCommandProgrammer commandProgrammer;
+		std::vector<std::string> pieces = commandProgrammer.CutMessage(message, '$');
+		if(pieces[0] != "best" || pieces.size() != 5) {
+			continue;
+		}
+
+		m_best.host = pieces[1];
+		m_best.port = atoi(pieces[2].c_str());
+		m_best.connections = atoi(pieces[3].c_str());
+		m_best.maxConnections = atoi(pieces[4].c_str());
+		m_best.lastSeenMs = m_pClock->NowMs();
+		m_bestValid = true;
+	}
+}
+
+void WheatDirectoryAgent::Tick(size_t connections, size_t maxConnections)
+{
+	if(m_socket == INVALID_SOCKET || m_pClock->NowMs() < m_nextReportMs) {
+		return;
+	}
+	m_nextReportMs = m_pClock->NowMs() + WHEATDIRECTORY_REPORT_MS;
+
+	m_self.connections = static_cast<int>(connections);
+	m_self.maxConnections = static_cast<int>(maxConnections);
+
+	// "node$$$ַ$˿$$$"̨ûҲûϵUDP ȥͲ
+	char message[WHEATDIRECTORY_MESSAGE_SIZE];
+	int len = snprintf(message, sizeof(message), "node$%s$%s$%s$%d$%d$%d$%s", m_self.name.c_str(), m_self.room.c_str(), m_self.host.c_str(), m_self.port, m_self.connections, m_self.maxConnections, m_secret.c_str());
+	sendto(m_socket, message, MIN(len, int(sizeof(message)) - 1), 0, (sockaddr *)& m_directoryAddress, sizeof(m_directoryAddress));
+}
+
+const WheatNodeInfo * WheatDirectoryAgent::FindRedirect(size_t connections, size_t maxConnections, bool serverFull)
+{
+	if(m_bestValid == false || m_pClock->NowMs() - m_best.lastSeenMs > WHEATDIRECTORY_NODE_TIMEOUT_MS) {
+		return nullptr;
+	}
+
+	// еľԼ
+	if(m_best.host == m_self.host && m_best.port == m_self.port) {
+		return nullptr;
+	}
+
+	// ǱҲˣȥҲû
+	if(static_cast<long long>(m_best.connections) * 100 >= static_cast<long long>(m_best.maxConnections) * m_redirectPercent) {
+		return nullptr;
+	}
+
+	if(serverFull == false) {
+		// Լæ
+		if(static_cast<long long>(connections) * 100 < static_cast<long long>(maxConnections) * m_redirectPercent) {
+			return nullptr;
+		}
+		// Ǳ߲Լ
+		if(IsLessLoaded(m_best.connections, m_best.maxConnections, connections, maxConnections) == false) {
+			return nullptr;
+		}
+	}
+
+	// Ǳ߼һʣһα֮ǰ˯ȫȥ
+	m_best.connections++;
+	return & m_best;
+}
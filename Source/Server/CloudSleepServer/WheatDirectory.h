@@ -0,0 +1,128 @@
+#pragma once
+
+#include "WheatClock.h"
+#include "WheatBus.h"
+
+#include <winsock.h>
+#include <string>
+#include <vector>
+
+// ̨Ĭϼ UDP ˿
+#define WHEATDIRECTORY_PORT 11460
+
+// ڵÿ̨һΣλ 
+#define WHEATDIRECTORY_REPORT_MS 1000
+
+// ڵû͵Ѿߣλ 룬ڵ "нڵ" ôҲٿ
+#define WHEATDIRECTORY_NODE_TIMEOUT_MS 5000
+
+// һ߻ظֽ
+#define WHEATDIRECTORY_MESSAGE_SIZE 256
+
+// һ̣ڵ㣩Ƭ
+struct WheatNodeInfo {
+	std::string name;			// ڵ֣ͬһ̨²ظ
+	std::string room;			// ڵϿŵķ
+	std::string host;			// ˯ڵҪõĵַ
+	int port = 0;
+	int connections = 0;
+	int maxConnections = 0;
+	long long lastSeenMs = 0;
+};
+
+// ̨ÿ俪Щڵ㣨̣ϣÿڵж
+// ڵÿһ UDP һΣ"node$$$ַ$˿$$$"̨ظĿǰеĽڵ㣺"best$ַ$˿$$"
+// ˯ͻᱻź link_secret Բϵıһɲ˭ܵǼһڵ˯
+// κ˶ "where$" ̨ȥĸڵ㣬ظһ
+// ҲûϵһαͲˣ̨ΪÿڵάһӣӽڵǶ࿪һ
+// ڵ֮Ҫ֪ͨ£ڵ졢˯ȫ棩̨ϵϢ(WheatBusBroker) TCP ·
+class WheatDirectory {
+public:
+	WheatDirectory(WheatClock * pClock = GetSystemClock()) { m_pClock = pClock; }
+
+	//  listenAddress  UDP ˿ port ձ·Ҫϰ secretΪʱֻϼַ
+	// busPort ΪϢߵ TCP ˿ڣ0 ʾߣ߼ busAddress 
+	bool Init(const char * listenAddress, int port, const std::string & secret, int busPort = 0, const char * busAddress = "127.0.0.1");
+	void Close();
+
+	// һֱУձظߵĽڵ
+	void Run();
+
+	// һϢҪظĻд *pReply  true
+	bool HandleMessage(const char * message, std::string * pReply);
+
+	// ĳУռıСĽڵ㣬ûнڵĻ nullptr
+	const WheatNodeInfo * FindBestNode(const std::string & room);
+
+	// ȥ̫ûĽڵ㣬ȥ˼
+	int ExpireNodes();
+
+	void PrintNodes();
+
+	inline const std::vector<WheatNodeInfo> & GetNodes() { return m_nodes; }
+
+private:
+
+	WheatClock * m_pClock = nullptr;
+
+	WSADATA m_WSAData;
+	SOCKET m_socket = INVALID_SOCKET;
+	std::string m_secret;
+
+	// ڵ㲻ܶ࣬һһҾ͹
+	std::vector<WheatNodeInfo> m_nodes;
+
+	WheatBusBroker m_busBroker;
+};
+
+// פԱ̨̺(WheatDirectory)ϵ
+// ÿ WHEATDIRECTORY_REPORT_MS ̨һԼĸأ˳̨ظнڵ
+// Լ˶Ľڵ㻹пλʱ˯ͻڽʱ(redirect$)Ǹڵȥ
+class WheatDirectoryAgent {
+public:
+	WheatDirectoryAgent(WheatClock * pClock = GetSystemClock()) { m_pClock = pClock; }
+	~WheatDirectoryAgent();
+
+	WheatDirectoryAgent(const WheatDirectoryAgent &) = delete;
+	WheatDirectoryAgent & operator=(const WheatDirectoryAgent &) = delete;
+
+	// ʼ̨ϵdirectoryAddress ΪʱУʲô
+	// publicHostpublicPort Ϊ˯ӱڵҪõĵַnodeName Ϊʱ "ַ:˿"secret Ϊ̨Լõİţÿα
+	bool Start(const char * directoryAddress, int directoryPort, const char * nodeName, const char * roomName, const char * publicHost, int publicPort, const std::string & secret);
+
+	// ﵽİٷ֮ʱʼ˯Ľڵ
+	inline void SetRedirectPercent(int redirectPercent) { m_redirectPercent = redirectPercent; }
+
+	inline bool IsEnabled() { return m_socket != INVALID_SOCKET; }
+
+	// Ѻ̨ϵõ socket ӽ select Ҫļ
+	void AddToFdSet(fd_set * pReadSet);
+
+	// select Ժą̃ĻظԼ socket  pReadSet õ
+	void Poll(fd_set * pReadSet);
+
+	// ¼ѭĵδãʱ˾̨
+	void Tick(size_t connections, size_t maxConnections);
+
+	// ˯ҪҪĽڵȥҪĻǸڵ㣬ҪĻ nullptr
+	// serverFull Ϊ true ʾԼѾˣʱֻҪĽڵ㻹пλȥ
+	const WheatNodeInfo * FindRedirect(size_t connections, size_t maxConnections, bool serverFull);
+
+private:
+
+	WheatClock * m_pClock = nullptr;
+
+	SOCKET m_socket = INVALID_SOCKET;
+	sockaddr_in m_directoryAddress;
+
+	WheatNodeInfo m_self;
+	std::string m_secret;
+
+	long long m_nextReportMs = 0;
+
+	// ̨һλظнڵ
+	WheatNodeInfo m_best;
+	bool m_bestValid = false;
+
+	int m_redirectPercent = 80;
+};
@@ -0,0 +1,228 @@
+#include "WheatFrameScanner.h"
+#include "ProjectCommon.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WHEAT_FRAMESCANNER_X86
+#endif
+
+#ifdef WHEAT_FRAMESCANNER_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// MSVC Ҫ⿪ؾʹ AVX2 ָGCC/Clang Ҫϱ
+#if defined(WHEAT_FRAMESCANNER_X86) && defined(__GNUC__)
+#define WHEAT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define WHEAT_TARGET_AVX2
+#endif
+
+// ɨе״̬ɨ跽ʽ
+struct WheatFrameScanState {
+	WheatFrameSpan * spans;
+	size_t maxSpans;
+	size_t spanNum = 0;
+
+	size_t frameStart = 0;		// ǰ֡
+	size_t dollarPos = 0;		// ǰ֡һ '$' λ
+	bool dollarFound = false;
+
+	//  pos һָ'\0'  '$'spans д˷ false
+	inline bool Hit(const char * buf, size_t pos) {
+		if(buf[pos] == '$') {
+			if(dollarFound == false) {
+				dollarPos = pos;
+				dollarFound = true;
+			}
+			return true;
+		}
+
+		WheatFrameSpan & span = spans[spanNum];
+		span.offset = frameStart;
+		span.len = pos - frameStart;
+		span.opcodeLen = dollarFound ? dollarPos - frameStart : span.len;
+		spanNum++;
+
+		frameStart = pos + 1;
+		dollarFound = false;
+
+		return spanNum < maxSpans;
+	}
+};
+
+static inline int CountTrailingZeros(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(& index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static bool CpuSupportsAVX2()
+{
+#if defined(WHEAT_FRAMESCANNER_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] < 7) {
+		return false;
+	}
+
+	//  CPU ֧֣ҪϵͳԸⱣ YMM Ĵ
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if(osxsave == false || avx == false || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(WHEAT_FRAMESCANNER_X86) && defined(__GNUC__)
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+static WheatFrameScanner::Mode DetectMode()
+{
+#ifdef WHEAT_FRAMESCANNER_X86
+	return CpuSupportsAVX2() ? WheatFrameScanner::Mode::AVX2 : WheatFrameScanner::Mode::SSE2;
+#else
+	return WheatFrameScanner::Mode::Scalar;
+#endif
+}
+
+static WheatFrameScanner::Mode s_mode = DetectMode();
+
+void WheatFrameScanner::SetMode(Mode mode)
+{
+	Mode bestMode = DetectMode();
+	if(static_cast<int>(mode) > static_cast<int>(bestMode)) {
+		mode = bestMode;
+	}
+	s_mode = mode;
+}
+
+WheatFrameScanner::Mode WheatFrameScanner::GetMode()
+{
+	return s_mode;
+}
+
+size_t WheatFrameScanner::Scan(const char * buf, size_t len, WheatFrameSpan * spans, size_t maxSpans, size_t * pSpanNum)
+{
+	*pSpanNum = 0;
+	if(maxSpans == 0) {
+		return 0;
+	}
+
+	switch(s_mode) {
+		case Mode::AVX2:
+			return ScanAVX2(buf, len, spans, maxSpans, pSpanNum);
+		case Mode::SSE2:
+			return ScanSSE2(buf, len, spans, maxSpans, pSpanNum);
+	}
+	return ScanScalar(buf, len, spans, maxSpans, pSpanNum);
+}
+
+size_t WheatFrameScanner::ScanScalar(const char * buf, size_t len, WheatFrameSpan * spans, size_t maxSpans, size_t * pSpanNum)
+{
+	WheatFrameScanState state;
+	state.spans = spans;
+	state.maxSpans = maxSpans;
+
+	for(size_t i = 0; i < len; i++) {
+		if(buf[i] == '\0' || buf[i] == '$') {
+			if(state.Hit(buf, i) == false) {
+				break;
+			}
+		}
+	}
+
+	*pSpanNum = state.spanNum;
+	return state.frameStart;
+}
+
+size_t WheatFrameScanner::ScanSSE2(const char * buf, size_t len, WheatFrameSpan * spans, size_t maxSpans, size_t * pSpanNum)
+{
+#ifdef WHEAT_FRAMESCANNER_X86
+	WheatFrameScanState state;
+	state.spans = spans;
+	state.maxSpans = maxSpans;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i dollar = _mm_set1_epi8('$');
+
+	size_t i = 0;
+	for(; i + 16 <= len; i += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + i));
+		unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, zero), _mm_cmpeq_epi8(block, dollar))));
+		while(mask != 0) {
+			if(state.Hit(buf, i + CountTrailingZeros(mask)) == false) {
+				*pSpanNum = state.spanNum;
+				return state.frameStart;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	//  16 ֽڵβһһ
+	for(; i < len; i++) {
+		if(buf[i] == '\0' || buf[i] == '$') {
+			if(state.Hit(buf, i) == false) {
+				break;
+			}
+		}
+	}
+
+	*pSpanNum = state.spanNum;
+	return state.frameStart;
+#else
+	return ScanScalar(buf, len, spans, maxSpans, pSpanNum);
+#endif
+}
+
+WHEAT_TARGET_AVX2
+size_t WheatFrameScanner::ScanAVX2(const char * buf, size_t len, WheatFrameSpan * spans, size_t maxSpans, size_t * pSpanNum)
+{
+#ifdef WHEAT_FRAMESCANNER_X86
+	WheatFrameScanState state;
+	state.spans = spans;
+	state.maxSpans = maxSpans;
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i dollar = _mm256_set1_epi8('$');
+
+	size_t i = 0;
+	for(; i + 32 <= len; i += 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + i));
+		unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, zero), _mm256_cmpeq_epi8(block, dollar))));
+		while(mask != 0) {
+			if(state.Hit(buf, i + CountTrailingZeros(mask)) == false) {
+				*pSpanNum = state.spanNum;
+				return state.frameStart;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	//  32 ֽڵβһһ
+	for(; i < len; i++) {
+		if(buf[i] == '\0' || buf[i] == '$') {
+			if(state.Hit(buf, i) == false) {
+				break;
+			}
+		}
+	}
+
+	*pSpanNum = state.spanNum;
+	return state.frameStart;
+#else
+	return ScanScalar(buf, len, spans, maxSpans, pSpanNum);
+#endif
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+// һϢ֡ڽջλ
+struct WheatFrameSpan {
+	size_t offset = 0;		// ֡ڻ
+	size_t len = 0;			// ֡ȣβ '\0'
+	size_t opcodeLen = 0;	// ָĳȣҲǵһ '$' λãû '$' ʱ len
+};
+
+// ֡Աһ recv յüϢÿϢ '\0' β
+// һɨҳϢıָ߽ '$'ָԱȥ
+//  AVX2  AVX2 һο 32 ֽڣо SSE2 һο 16 ֽڣٲоһһ
+class WheatFrameScanner {
+public:
+
+	enum class Mode {
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	// ɨ buf ǰ len ֽڣҵ֡д spansд maxSpans *pSpanNum Ϊʵдĸ
+	// ֡һռ˶ֽڣÿ֡β '\0'ʣµǻûİ֡Ϊ spans д˶ûɨ֡
+	static size_t Scan(const char * buf, size_t len, WheatFrameSpan * spans, size_t maxSpans, size_t * pSpanNum);
+
+	// ǿʹĳɨ跽ʽڲԺͶԱȣֵ֧ķʽ˻صõķʽ
+	static void SetMode(Mode mode);
+	static Mode GetMode();
+
+private:
+	static size_t ScanScalar(const char * buf, size_t len, WheatFrameSpan * spans, size_t maxSpans, size_t * pSpanNum);
+	static size_t ScanSSE2(const char * buf, size_t len, WheatFrameSpan * spans, size_t maxSpans, size_t * pSpanNum);
+	static size_t ScanAVX2(const char * buf, size_t len, WheatFrameSpan * spans, size_t maxSpans, size_t * pSpanNum);
+};
@@ -0,0 +1,544 @@
+#include "WheatGateway.h"
+#include "ProjectCommon.h"
+
+#include <iostream>
+#include <cstring>
+
+// ÿÿһļûбĹλ 
+#define WHEATGATEWAY_CONFIG_CHECK_MS 1000
+
+// һɨ¶Ϣı߽
+#define WHEATGATEWAY_MAX_FRAMES 64
+
+WheatGateway::WheatGateway(WheatConfig * pConfig, WheatClock * pClock)
+	: m_admission(pClock, FD_SETSIZE - 1 - WHEATGATEWAY_MAX_LINKS)
+{
+	m_pConfig = pConfig;
+	m_pClock = pClock;
+}
+
+bool WheatGateway::Init()
+{
+	if(WSAStartup(MAKEWORD(2, 2), &m_WSAData) != 0) {
+		printf("WSAStartup Failed!\n");
+		return false;
+	}
+
+	if(ParseBackends() == false) {
+		return false;
+	}
+
+	m_recvBufferSize = static_cast<size_t>(m_pConfig->recvBufferSize);
+	m_bufferSlab.SetBlockSize(m_recvBufferSize);
+	m_bufferSlab.Reserve(MIN(static_cast<size_t>(m_pConfig->sessionPoolSize), static_cast<size_t>(FD_SETSIZE)));
+
+	m_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(m_listenSocket == INVALID_SOCKET) {
+		printf("socket Error!! %d\n", WSAGetLastError());
+		return false;
+	}
+
+	sockaddr_in address;
+	memset(& address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(m_pConfig->port);
+	address.sin_addr.S_un.S_addr = inet_addr(m_pConfig->listenAddress.c_str());
+	if(address.sin_addr.S_un.S_addr == INADDR_NONE) {
+		address.sin_addr.S_un.S_addr = htonl(INADDR_ANY);
+	}
+
+	if(bind(m_listenSocket, (sockaddr *)& address, sizeof(address)) == SOCKET_ERROR || listen(m_listenSocket, SOMAXCONN) == SOCKET_ERROR) {
+		printf("Gateway bind/listen Error!! %d\n", WSAGetLastError());
+		return false;
+	}
+
+	printf("Gateway Listening On Port %d, %d Links.\n", m_pConfig->port, m_linkNum);
+	return true;
+}
+
+void WheatGateway::Close()
+{
+	while(m_clients.empty() == false) {
+		CloseClient(m_clients.begin()->first, false);
+	}
+	for(int i = 0; i < m_linkNum; i++) {
+		CloseLink(i);
+	}
+	m_linkNum = 0;
+
+	if(m_listenSocket != INVALID_SOCKET) {
+		closesocket(m_listenSocket);
+		m_listenSocket = INVALID_SOCKET;
+		WSACleanup();
+	}
+}
+
+void WheatGateway::Run()
+{
+	printf("Gateway Start to Run.\n");
+
+	ApplyConfig();
+	m_pConfig->Print();
+
+	long long nextConfigCheckMs = m_pClock->NowMs() + WHEATGATEWAY_CONFIG_CHECK_MS;
+
+	while(1) {
+		long long nowMs = m_pClock->NowMs();
+
+		fd_set fdRead;
+		fd_set fdWrite;
+		fd_set fdExcept;
+		FD_ZERO(&fdRead);
+		FD_ZERO(&fdWrite);
+		FD_ZERO(&fdExcept);
+
+		FD_SET(m_listenSocket, &fdRead);
+		for(auto & pair : m_clients) {
+			FD_SET(pair.first, &fdRead);
+			if(pair.second.pendingSent < pair.second.pending.size()) {
+				FD_SET(pair.first, &fdWrite);
+			}
+		}
+
+		// ˵· connect ˻ɿдϻ쳣
+		for(int i = 0; i < m_linkNum; i++) {
+			GatewayLink & link = m_links[i];
+			if(link.mux.IsOpen()) {
+				FD_SET(link.mux.GetSocket(), &fdRead);
+				if(link.mux.GetQueuedBytes() > 0) {
+					FD_SET(link.mux.GetSocket(), &fdWrite);
+				}
+				continue;
+			}
+			if(link.connectingSocket == INVALID_SOCKET && nowMs >= link.nextConnectMs) {
+				StartConnect(link);
+			}
+			if(link.connectingSocket != INVALID_SOCKET) {
+				FD_SET(link.connectingSocket, &fdWrite);
+				FD_SET(link.connectingSocket, &fdExcept);
+			}
+		}
+
+		// tv_usec Сһ룬tick_ms 䵽 1000ĲַŽ tv_sec
+		timeval tm;
+		tm.tv_sec = static_cast<long>(m_pConfig->tickMs / 1000);
+		tm.tv_usec = static_cast<long>((m_pConfig->tickMs % 1000) * 1000);
+
+		// Windows  select һ
+		int selectRes = select(0, &fdRead, &fdWrite, &fdExcept, &tm);
+
+		if(m_pClock->NowMs() >= nextConfigCheckMs) {
+			if(m_pConfig->ReloadIfChanged()) {
+				ApplyConfig();
+			}
+			nextConfigCheckMs = m_pClock->NowMs() + WHEATGATEWAY_CONFIG_CHECK_MS;
+		}
+
+		if(selectRes <= 0) {
+			continue;
+		}
+
+		for(int i = 0; i < m_linkNum; i++) {
+			GatewayLink & link = m_links[i];
+			if(link.connectingSocket == INVALID_SOCKET) {
+				continue;
+			}
+			if(FD_ISSET(link.connectingSocket, &fdExcept)) {
+				printf("Gateway Link %d Connect To %s Failed.\n", i, link.name.c_str());
+				closesocket(link.connectingSocket);
+				link.connectingSocket = INVALID_SOCKET;
+				link.nextConnectMs = m_pClock->NowMs() + WHEATGATEWAY_RECONNECT_MS;
+			} else if(FD_ISSET(link.connectingSocket, &fdWrite)) {
+				OnConnected(link);
+				printf("Gateway Link %d Connected To %s.\n", i, link.name.c_str());
+			}
+		}
+
+		if(FD_ISSET(m_listenSocket, &fdRead)) {
+			AcceptClient();
+		}
+
+		// Ϣԭת˯
+		for(int i = 0; i < m_linkNum; i++) {
+			WheatMuxLink & mux = m_links[i].mux;
+			if(mux.IsOpen() == false || FD_ISSET(mux.GetSocket(), &fdRead) == false) {
+				continue;
+			}
+			if(mux.Receive() == false) {
+				printf("Gateway Link %d To %s Closed.\n", i, m_links[i].name.c_str());
+				CloseLink(i);
+				continue;
+			}
+
+			WheatMuxHeader header;
+			const char * payload = nullptr;
+			while(mux.PeekFrame(& header, & payload)) {
+				HandleFrame(header, payload);
+				mux.PopFrame();
+			}
+			if(mux.IsBroken()) {
+				CloseLink(i);
+			}
+		}
+
+		// ˯͵Ϣװ֡ܵ·ϣյ˯ͽŷŵݣϿӵһֿٹأڱʱı
+		std::vector<SOCKET> closedSockets;
+		for(auto & pair : m_clients) {
+			if(FD_ISSET(pair.first, &fdWrite) && FlushClient(pair.first, pair.second) == false) {
+				closedSockets.push_back(pair.first);
+				continue;
+			}
+			if(FD_ISSET(pair.first, &fdRead) && ReceiveFromClient(pair.first, pair.second) == false) {
+				closedSockets.push_back(pair.first);
+			}
+		}
+		for(SOCKET sock : closedSockets) {
+			CloseClient(sock, true);
+		}
+
+		// һȦµ֡һηȥһȦ
+		for(int i = 0; i < m_linkNum; i++) {
+			WheatMuxLink & mux = m_links[i].mux;
+			if(mux.IsOpen() == false) {
+				continue;
+			}
+			if(mux.Flush() == false) {
+				CloseLink(i);
+			} else if(mux.GetQueuedBytes() > WHEATGATEWAY_MAX_LINK_QUEUED_BYTES) {
+				printf("Gateway Link %d To %s Stuck, %zu Bytes Queued! Closing.\n", i, m_links[i].name.c_str(), mux.GetQueuedBytes());
+				CloseLink(i);
+			}
+		}
+	}
+}
+
+bool WheatGateway::ParseBackends()
+{
+	std::string backends = m_pConfig->gatewayBackends;
+	size_t start = 0;
+	while(start < backends.size()) {
+		size_t end = backends.find(',', start);
+		if(end == std::string::npos) {
+			end = backends.size();
+		}
+
+		std::string backend = backends.substr(start, end - start);
+		start = end + 1;
+
+		size_t colon = backend.rfind(':');
+		if(colon == std::string::npos) {
+			printf("Invalid Gateway Backend: %s\n", backend.c_str());
+			continue;
+		}
+
+		sockaddr_in address;
+		memset(& address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(atoi(backend.c_str() + colon + 1));
+		address.sin_addr.S_un.S_addr = inet_addr(backend.substr(0, colon).c_str());
+		if(address.sin_addr.S_un.S_addr == INADDR_NONE) {
+			printf("Invalid Gateway Backend: %s\n", backend.c_str());
+			continue;
+		}
+
+		for(int i = 0; i < m_pConfig->gatewayLinksPerBackend && m_linkNum < WHEATGATEWAY_MAX_LINKS; i++) {
+			m_links[m_linkNum].address = address;
+			m_links[m_linkNum].name = backend;
+			m_linkNum++;
+		}
+	}
+
+	if(m_linkNum == 0) {
+		printf("No Gateway Backend!\n");
+		return false;
+	}
+	return true;
+}
+
+void WheatGateway::StartConnect(GatewayLink & link)
+{
+	SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(sock == INVALID_SOCKET) {
+		link.nextConnectMs = m_pClock->NowMs() + WHEATGATEWAY_RECONNECT_MS;
+		return;
+	}
+
+	u_long nonBlocking = 1;
+	ioctlsocket(sock, FIONBIO, & nonBlocking);
+
+	if(connect(sock, (sockaddr *)& link.address, sizeof(link.address)) == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) {
+		closesocket(sock);
+		link.nextConnectMs = m_pClock->NowMs() + WHEATGATEWAY_RECONNECT_MS;
+		return;
+	}
+
+	link.connectingSocket = sock;
+}
+
+void WheatGateway::OnConnected(GatewayLink & link)
+{
+	// ԺǷģյʱ send ܿס˯ͣ֡·һȦٷ
+	BOOL noDelay = TRUE;
+	setsockopt(link.connectingSocket, IPPROTO_TCP, TCP_NODELAY, (const char *)& noDelay, sizeof(noDelay));
+
+	link.mux.Attach(link.connectingSocket);
+	link.connectingSocket = INVALID_SOCKET;
+	link.clientNum = 0;
+
+	// ԹŲ·
+	link.mux.QueueHello(m_pConfig->linkSecret);
+}
+
+void WheatGateway::CloseLink(int linkIndex)
+{
+	GatewayLink & link = m_links[linkIndex];
+	link.mux.Close();
+	if(link.connectingSocket != INVALID_SOCKET) {
+		closesocket(link.connectingSocket);
+		link.connectingSocket = INVALID_SOCKET;
+	}
+	link.nextConnectMs = m_pClock->NowMs() + WHEATGATEWAY_RECONNECT_MS;
+
+	// ǱѾûЩ˯ˣҲûã
+	std::vector<SOCKET> closedSockets;
+	for(auto & pair : m_clients) {
+		if(pair.second.linkIndex == linkIndex) {
+			closedSockets.push_back(pair.first);
+		}
+	}
+	for(SOCKET sock : closedSockets) {
+		CloseClient(sock, false);
+	}
+}
+
+void WheatGateway::AcceptClient()
+{
+	sockaddr_in clientAddr;
+	int len = sizeof(sockaddr_in);
+	SOCKET sock = accept(m_listenSocket, (sockaddr *)& clientAddr, & len);
+	if(sock == INVALID_SOCKET) {
+		printf("accept Error!! %d\n", WSAGetLastError());
+		return;
+	}
+
+	WheatAdmission::Result admission = m_admission.TryAdmit(sock, clientAddr.sin_addr.S_un.S_addr);
+	int linkIndex = PickLink();
+	if(admission == WheatAdmission::Result::Admitted && linkIndex < 0) {
+		// һûϣһԴ
+		m_admission.Release(sock);
+		admission = WheatAdmission::Result::ServerFull;
+	}
+	if(admission != WheatAdmission::Result::Admitted) {
+		printf("Client %lld Rejected  %s:%d\n", static_cast<long long>(sock), inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port));
+		RejectClient(sock, admission);
+		return;
+	}
+
+	BOOL keepAlive = TRUE;
+	setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, (const char *)& keepAlive, sizeof(keepAlive));
+
+	// Էյʱ send ܿסأ GatewayClient::pending 
+	u_long nonBlocking = 1;
+	ioctlsocket(sock, FIONBIO, & nonBlocking);
+
+	GatewayClient & client = m_clients[sock];
+	client.id = m_nextClientId++;
+	client.linkIndex = linkIndex;
+	client.buffer = static_cast<char *>(m_bufferSlab.Acquire());
+	client.len = 0;
+	client.tokensMilli = m_messageBurst * 1000;
+	client.lastRefillMs = m_pClock->NowMs();
+	client.droppedMessages = 0;
+	client.pending.clear();
+	client.pendingSent = 0;
+
+	m_links[linkIndex].clientNum++;
+	m_clientIds[client.id] = sock;
+
+	// Open ֡˯͵ IP˯͵ĵַ
+	const char * ipAddress = inet_ntoa(clientAddr.sin_addr);
+	m_links[linkIndex].mux.Queue(WheatMuxType::Open, client.id, ipAddress, strlen(ipAddress));
+
+	printf("New Client %lld Joined  %s:%d (Link %d)\n", static_cast<long long>(sock), ipAddress, ntohs(clientAddr.sin_port), linkIndex);
+}
+
+bool WheatGateway::ReceiveFromClient(SOCKET sock, GatewayClient & client)
+{
+	int recvRes = recv(sock, client.buffer + client.len, int(m_recvBufferSize - client.len), 0);
+	if(recvRes == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+		return true;
+	}
+	if(recvRes == SOCKET_ERROR || recvRes == 0) {
+		return false;
+	}
+	client.len += recvRes;
+
+	WheatFrameSpan spans[WHEATGATEWAY_MAX_FRAMES];
+	size_t spanNum = 0;
+	size_t consumed = 0;
+	do {
+		size_t scanned = WheatFrameScanner::Scan(client.buffer + consumed, client.len - consumed, spans, WHEATGATEWAY_MAX_FRAMES, & spanNum);
+		for(size_t i = 0; i < spanNum; i++) {
+			ForwardMessage(sock, client, client.buffer + consumed + spans[i].offset, spans[i].len, spans[i].opcodeLen);
+		}
+		consumed += scanned;
+	} while(spanNum == WHEATGATEWAY_MAX_FRAMES);
+
+	// ʣµİϢŲͷ˻һϢĻֻӵ
+	memmove(client.buffer, client.buffer + consumed, client.len - consumed);
+	client.len -= consumed;
+	if(client.len >= m_recvBufferSize) {
+		printf("Client %lld Message Too Long! DROP!\n", static_cast<long long>(sock));
+		client.len = 0;
+	}
+	return true;
+}
+
+void WheatGateway::ForwardMessage(SOCKET sock, GatewayClient & client, const char * buf, size_t len, size_t opcodeLen)
+{
+	// ʶָ鷳
+	if(m_commandProgrammer.GetCommandTypeFromString(buf, opcodeLen) == WheatCommandType::unknown) {
+		client.droppedMessages++;
+		m_droppedMessages++;
+		return;
+	}
+
+	// ÿλ˯һͰ̫Ϣֱӵ
+	long long nowMs = m_pClock->NowMs();
+	client.tokensMilli = MIN(client.tokensMilli + (nowMs - client.lastRefillMs) * m_messagesPerSecond, m_messageBurst * 1000);
+	client.lastRefillMs = nowMs;
+	if(client.tokensMilli < 1000) {
+		if(client.droppedMessages++ == 0) {
+			printf("Client %lld Sending Too Fast, Dropping Messages.\n", static_cast<long long>(sock));
+		}
+		m_droppedMessages++;
+		return;
+	}
+	client.tokensMilli -= 1000;
+
+	// ֡Ͻβ '\0'յԺԭֽ֡
+	m_links[client.linkIndex].mux.Queue(WheatMuxType::Data, client.id, buf, len + 1);
+	m_forwardedMessages++;
+}
+
+void WheatGateway::CloseClient(SOCKET sock, bool bNotifyLink)
+{
+	auto it = m_clients.find(sock);
+	if(it == m_clients.end()) {
+		return;
+	}
+
+	GatewayClient & client = it->second;
+	if(client.linkIndex >= 0) {
+		if(bNotifyLink && m_links[client.linkIndex].mux.IsOpen()) {
+			m_links[client.linkIndex].mux.Queue(WheatMuxType::Close, client.id, nullptr, 0);
+		}
+		m_links[client.linkIndex].clientNum--;
+	}
+
+	m_bufferSlab.Release(client.buffer);
+	m_clientIds.erase(client.id);
+	m_clients.erase(it);
+
+	m_admission.Release(sock);
+	closesocket(sock);
+
+	printf("Client %lld Left.\n", static_cast<long long>(sock));
+}
+
+void WheatGateway::HandleFrame(const WheatMuxHeader & header, const char * payload)
+{
+	auto it = m_clientIds.find(header.clientId);
+	if(it == m_clientIds.end()) {
+		return;
+	}
+	SOCKET sock = it->second;
+
+	if(header.type == WheatMuxType::Close) {
+		CloseClient(sock, false);
+		return;
+	}
+
+	if(header.type == WheatMuxType::Data && WriteClient(sock, m_clients.find(sock)->second, payload, header.payloadLen) == false) {
+		CloseClient(sock, true);
+	}
+}
+
+bool WheatGateway::WriteClient(SOCKET sock, GatewayClient & client, const char * buf, size_t len)
+{
+	// ǰ滹ûľֻں棬ȻԷյֽڻҵ
+	size_t sentLen = 0;
+	if(client.pendingSent == client.pending.size()) {
+		int sendRes = send(sock, buf, int(len), 0);
+		if(sendRes == SOCKET_ERROR) {
+			if(WSAGetLastError() != WSAEWOULDBLOCK) {
+				printf("Client %lld Send Error %d.\n", static_cast<long long>(sock), WSAGetLastError());
+				return false;
+			}
+			sendRes = 0;
+		}
+		sentLen = sendRes;
+		if(sentLen == len) {
+			return true;
+		}
+	}
+
+	size_t pendingLen = client.pending.size() - client.pendingSent;
+	if(pendingLen + len - sentLen > WHEATGATEWAY_MAX_PENDING_BYTES) {
+		// һϢͻ˿ķͲˣֻ
+		printf("Client %lld Too Slow, %zu Bytes Pending.\n", static_cast<long long>(sock), pendingLen);
+		return false;
+	}
+	client.pending.append(buf + sentLen, len - sentLen);
+	return true;
+}
+
+bool WheatGateway::FlushClient(SOCKET sock, GatewayClient & client)
+{
+	while(client.pendingSent < client.pending.size()) {
+		int sendRes = send(sock, client.pending.data() + client.pendingSent, int(client.pending.size() - client.pendingSent), 0);
+		if(sendRes == SOCKET_ERROR) {
+			if(WSAGetLastError() == WSAEWOULDBLOCK) {
+				return true;
+			}
+			printf("Client %lld Send Error %d.\n", static_cast<long long>(sock), WSAGetLastError());
+			return false;
+		}
+		client.pendingSent += sendRes;
+	}
+
+	// ˣյڴһ
+	client.pending.clear();
+	client.pendingSent = 0;
+	return true;
+}
+
+int WheatGateway::PickLink()
+{
+	int best = -1;
+	for(int i = 0; i < m_linkNum; i++) {
+		if(m_links[i].mux.IsOpen() && (best < 0 || m_links[i].clientNum < m_links[best].clientNum)) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+void WheatGateway::RejectClient(SOCKET sock, WheatAdmission::Result reason)
+{
+	WheatCommand command(WheatCommandType::full, "", static_cast<int>(reason), 0);
+
+	char frame[64];
+	size_t frameLen = m_commandProgrammer.WriteFrame(frame, -1, command);
+	send(sock, frame, int(frameLen), 0);
+
+	closesocket(sock);
+}
+
+void WheatGateway::ApplyConfig()
+{
+	m_admission.SetLimits(m_pConfig->maxConnections, m_pConfig->maxConnectionsPerIP, m_pConfig->acceptsPerSecond, m_pConfig->acceptBurst);
+
+	m_messagesPerSecond = m_pConfig->gatewayMessagesPerSecond;
+	m_messageBurst = m_pConfig->gatewayMessageBurst;
+}
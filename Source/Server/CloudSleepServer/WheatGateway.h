@@ -0,0 +1,122 @@
+#pragma once
+
+#define FD_SETSIZE 1024
+
+#include "WheatMux.h"
+#include "WheatAdmission.h"
+#include "WheatConfig.h"
+#include "WheatCommand.h"
+#include "WheatSlab.h"
+#include "WheatFrameScanner.h"
+#include "WheatClock.h"
+
+#include <winsock.h>
+#include <unordered_map>
+#include <string>
+
+// ࿪·
+#define WHEATGATEWAY_MAX_LINKS 32
+
+// ·Ժλ 
+#define WHEATGATEWAY_RECONNECT_MS 3000
+
+// ÿλ˯ֽܶûȥٶ˵Էյ̫Ͽ
+#define WHEATGATEWAY_MAX_PENDING_BYTES (256 * 1024)
+
+// һ·ֽܶûȥٶ˵סˣϿ
+#define WHEATGATEWAY_MAX_LINK_QUEUED_BYTES (4 * 1024 * 1024)
+
+// أһ̣mode = gatewayվ˯ͺͷм
+// ˯͵Ӷϣ֡١ָٰ꣬Ϣװ֡ͨ·תķ(WheatGatewayHub)
+// ֻҪܼ·ʡ CPU ڷ߼
+class WheatGateway {
+public:
+	WheatGateway(WheatConfig * pConfig, WheatClock * pClock = GetSystemClock());
+	~WheatGateway() { Close(); }
+
+	bool Init();
+	void Run();
+	void Close();
+
+private:
+
+	struct GatewayLink {
+		WheatMuxLink mux;
+		sockaddr_in address;
+		std::string name;
+		SOCKET connectingSocket = INVALID_SOCKET;	// е socketԺ󽻸 mux
+		long long nextConnectMs = 0;
+		size_t clientNum = 0;
+	};
+
+	struct GatewayClient {
+		unsigned int id = 0;		// ·ϵı
+		int linkIndex = -1;
+		char * buffer = nullptr;	// ջ m_bufferSlab 
+		size_t len = 0;
+		long long tokensMilli = 0;	// תϢλ ǧ֮һ
+		long long lastRefillMs = 0;
+		unsigned long long droppedMessages = 0;
+
+		// ˯͵ socket Ƿģںһղµ[pendingSent, pending.size()) ǻû
+		std::string pending;
+		size_t pendingSent = 0;
+	};
+
+	//  "ַ:˿,ַ:˿" ׼·
+	bool ParseBackends();
+
+	void StartConnect(GatewayLink & link);
+	void OnConnected(GatewayLink & link);
+	void CloseLink(int linkIndex);
+
+	void AcceptClient();
+	// ˯͵ϢӶ˷ false
+	bool ReceiveFromClient(SOCKET sock, GatewayClient & client);
+	void ForwardMessage(SOCKET sock, GatewayClient & client, const char * buf, size_t len, size_t opcodeLen);
+	// ص˯͵ӣbNotifyLink Ϊ true ʱ߷
+	void CloseClient(SOCKET sock, bool bNotifyLink);
+
+	// ˯ͣĲѾ˻ܹ WHEATGATEWAY_MAX_PENDING_BYTES  falseλ˯ֻܶϿ
+	bool WriteClient(SOCKET sock, GatewayClient & client, const char * buf, size_t len);
+	// socket дˣŵݽŷȥѾ˷ false
+	bool FlushClient(SOCKET sock, GatewayClient & client);
+
+	// ֡
+	void HandleFrame(const WheatMuxHeader & header, const char * payload);
+
+	// һŵġ˯ٵ·ûϷ -1
+	int PickLink();
+
+	void RejectClient(SOCKET sock, WheatAdmission::Result reason);
+
+	void ApplyConfig();
+
+	WheatConfig * m_pConfig = nullptr;
+	WheatClock * m_pClock = nullptr;
+
+	// Ҫλøõ socket ·
+	WheatAdmission m_admission;
+
+	WheatCommandProgrammer m_commandProgrammer;
+
+	WheatSlab m_bufferSlab { 4096 };
+	size_t m_recvBufferSize = 4096;
+
+	GatewayLink m_links[WHEATGATEWAY_MAX_LINKS];
+	int m_linkNum = 0;
+	std::unordered_map<SOCKET, GatewayClient> m_clients;
+
+	// ·ϵı -> socketһֱϼӣ socket ϱãĳٵ֡Ҵ
+	std::unordered_map<unsigned int, SOCKET> m_clientIds;
+	unsigned int m_nextClientId = 1;
+
+	long long m_messagesPerSecond = 20;
+	long long m_messageBurst = 40;
+
+	unsigned long long m_forwardedMessages = 0;
+	unsigned long long m_droppedMessages = 0;
+
+	WSADATA m_WSAData;
+	SOCKET m_listenSocket = INVALID_SOCKET;
+};
@@ -0,0 +1,250 @@
+#include "WheatGatewayHub.h"
+#include "ProjectCommon.h"
+
+#include <iostream>
+#include <string>
+
+bool WheatGatewayHub::Start(const char * listenAddress, int port, const std::string & secret)
+{
+	if(port == 0) {
+		return true;
+	}
+
+	if(secret.empty() && WheatMuxIsLoopback(listenAddress) == false) {
+		printf("Gateway Hub Refuses To Listen On %s Without link_secret!\n", listenAddress);
+		return false;
+	}
+	m_secret = secret;
+
+	m_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(m_listenSocket == INVALID_SOCKET) {
+		printf("Gateway Hub socket Error!! %d\n", WSAGetLastError());
+		return false;
+	}
+
+	sockaddr_in address;
+	memset(& address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.S_un.S_addr = inet_addr(listenAddress);
+	if(address.sin_addr.S_un.S_addr == INADDR_NONE) {
+		printf("Invalid Gateway Link Address %s!\n", listenAddress);
+		closesocket(m_listenSocket);
+		m_listenSocket = INVALID_SOCKET;
+		return false;
+	}
+
+	if(bind(m_listenSocket, (sockaddr *)& address, sizeof(address)) == SOCKET_ERROR || listen(m_listenSocket, WHEATGATEWAYHUB_MAX_LINKS) == SOCKET_ERROR) {
+		printf("Gateway Hub bind/listen Error!! %d\n", WSAGetLastError());
+		closesocket(m_listenSocket);
+		m_listenSocket = INVALID_SOCKET;
+		return false;
+	}
+
+	printf("Gateway Hub Listening On %s:%d.\n", listenAddress, port);
+	return true;
+}
+
+void WheatGatewayHub::Close()
+{
+	for(int i = 0; i < WHEATGATEWAYHUB_MAX_LINKS; i++) {
+		if(m_links[i].IsOpen()) {
+			CloseLink(i);
+		}
+	}
+	if(m_listenSocket != INVALID_SOCKET) {
+		closesocket(m_listenSocket);
+		m_listenSocket = INVALID_SOCKET;
+	}
+}
+
+void WheatGatewayHub::AddToFdSet(fd_set * pReadSet)
+{
+	if(m_listenSocket != INVALID_SOCKET) {
+		FD_SET(m_listenSocket, pReadSet);
+	}
+	for(WheatMuxLink & link : m_links) {
+		if(link.IsOpen()) {
+			FD_SET(link.GetSocket(), pReadSet);
+		}
+	}
+}
+
+void WheatGatewayHub::Poll(fd_set * pReadSet)
+{
+	if(m_listenSocket != INVALID_SOCKET && FD_ISSET(m_listenSocket, pReadSet)) {
+		FD_CLR(m_listenSocket, pReadSet);
+		Accept();
+	}
+
+	for(int i = 0; i < WHEATGATEWAYHUB_MAX_LINKS; i++) {
+		WheatMuxLink & link = m_links[i];
+		if(link.IsOpen() == false) {
+			continue;
+		}
+
+		if(FD_ISSET(link.GetSocket(), pReadSet)) {
+			FD_CLR(link.GetSocket(), pReadSet);
+			if(link.Receive() == false) {
+				printf("Gateway Link %d Closed.\n", i);
+				CloseLink(i);
+				continue;
+			}
+		}
+
+		// һȦû֡ҲŴ
+		WheatMuxHeader header;
+		const char * payload = nullptr;
+		while(link.PeekFrame(& header, & payload)) {
+			// ϰ֮ǰʲô֡ԲϾͶϿ˭һѲܵ˯
+			if(link.IsTrusted() == false) {
+				if(link.AcceptHello(header, payload, m_secret) == false) {
+					printf("Gateway Link %d Refused, Bad Secret.\n", i);
+					CloseLink(i);
+					break;
+				}
+				link.PopFrame();
+				continue;
+			}
+			if(HandleFrame(i, header, payload) == false) {
+				break;
+			}
+			link.PopFrame();
+		}
+
+		if(link.IsBroken()) {
+			CloseLink(i);
+		}
+	}
+}
+
+void WheatGatewayHub::Flush()
+{
+	for(int i = 0; i < WHEATGATEWAYHUB_MAX_LINKS; i++) {
+		if(m_links[i].IsOpen() && m_links[i].Flush() == false) {
+			CloseLink(i);
+		}
+	}
+}
+
+bool WheatGatewayHub::Send(SOCKET sock, const char * buf, size_t len)
+{
+	auto it = m_clients.find(sock);
+	if(it == m_clients.end() || it->second.linkIndex < 0) {
+		return false;
+	}
+
+	m_links[it->second.linkIndex].Queue(WheatMuxType::Data, it->second.clientId, buf, len);
+	return true;
+}
+
+bool WheatGatewayHub::Disconnect(SOCKET sock)
+{
+	auto it = m_clients.find(sock);
+	if(it == m_clients.end()) {
+		return false;
+	}
+
+	// ·ڵĻذҲص
+	GatewayClient client = it->second;
+	if(client.linkIndex >= 0) {
+		m_links[client.linkIndex].Queue(WheatMuxType::Close, client.clientId, nullptr, 0);
+		m_virtualSockets.erase(MakeKey(client.linkIndex, client.clientId));
+	}
+	m_clients.erase(it);
+
+	m_pSessions->Hangup(sock, true);
+
+	printf("Gateway Client %lld Left.\n", static_cast<long long>(sock));
+	return true;
+}
+
+size_t WheatGatewayHub::GetLinkNum()
+{
+	size_t linkNum = 0;
+	for(WheatMuxLink & link : m_links) {
+		if(link.IsOpen()) {
+			linkNum++;
+		}
+	}
+	return linkNum;
+}
+
+void WheatGatewayHub::Accept()
+{
+	sockaddr_in address;
+	int len = sizeof(address);
+	SOCKET sock = accept(m_listenSocket, (sockaddr *)& address, & len);
+	if(sock == INVALID_SOCKET) {
+		return;
+	}
+
+	for(int i = 0; i < WHEATGATEWAYHUB_MAX_LINKS; i++) {
+		if(m_links[i].IsOpen() == false) {
+			// ·ϵܹ֡һȦŷҪ Nagle һ
+			BOOL noDelay = TRUE;
+			setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *)& noDelay, sizeof(noDelay));
+
+			m_links[i].Attach(sock);
+			printf("Gateway Link %d Connected From %s:%d\n", i, inet_ntoa(address.sin_addr), ntohs(address.sin_port));
+			return;
+		}
+	}
+
+	printf("Gateway Link Refused, Too Many Links.\n");
+	closesocket(sock);
+}
+
+void WheatGatewayHub::CloseLink(int linkIndex)
+{
+	m_links[linkIndex].Close();
+
+	// ·ϵ˯ͶϿỰԺ Disconnect()ʱٰǴӱȥ
+	for(auto & pair : m_clients) {
+		if(pair.second.linkIndex == linkIndex) {
+			m_virtualSockets.erase(MakeKey(linkIndex, pair.second.clientId));
+			pair.second.linkIndex = -1;
+			m_pSessions->Hangup(pair.first);
+		}
+	}
+}
+
+bool WheatGatewayHub::HandleFrame(int linkIndex, const WheatMuxHeader & header, const char * payload)
+{
+	unsigned long long key = MakeKey(linkIndex, header.clientId);
+
+	if(header.type == WheatMuxType::Open) {
+		if(m_virtualSockets.count(key) > 0) {
+			return true;
+		}
+
+		std::string ipAddress(payload, header.payloadLen);
+		SOCKET sock = m_nextVirtualSocket++;
+		m_clients[sock] = GatewayClient { linkIndex, header.clientId };
+		m_virtualSockets[key] = sock;
+
+		printf("New Gateway Client %lld Joined  %s (Link %d)\n", static_cast<long long>(sock), ipAddress.c_str(), linkIndex);
+
+		m_pSessions->Start(sock, ipAddress.c_str());
+		return true;
+	}
+
+	auto it = m_virtualSockets.find(key);
+	if(it == m_virtualSockets.end()) {
+		return true;
+	}
+
+	if(header.type == WheatMuxType::Close) {
+		// ǱߵѾˣϾͿܸµ˯ãȰѶӦϵȥỰʱ Disconnect()
+		SOCKET sock = it->second;
+		m_clients[sock].linkIndex = -1;
+		m_virtualSockets.erase(it);
+		m_pSessions->Hangup(sock);
+		return true;
+	}
+
+	if(header.type != WheatMuxType::Data) {
+		return true;
+	}
+	return m_pSessions->Deliver(it->second, payload, header.payloadLen);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "WheatMux.h"
+#include "WheatSession.h"
+
+#include <winsock.h>
+#include <unordered_map>
+#include <string>
+
+// Ӽ·
+#define WHEATGATEWAYHUB_MAX_LINKS 8
+
+// Ǳߵ˯ü socket ʾʼţ socket 
+#define WHEATGATEWAYHUB_VIRTUAL_SOCKET_BASE 0x40000000
+
+// ؽԱڷһ࣬Ӵ(WheatGateway)ļ·
+// Ǳߵÿλ˯ﶼֵһ socketֱ˯һỰԱỰܼҷֲ
+// Щ˯͵Ϣ socketܵӦ·ϣÿһȦʱһη
+class WheatGatewayHub {
+public:
+	WheatGatewayHub(WheatSessionScheduler * pSessions) { m_pSessions = pSessions; }
+	~WheatGatewayHub() { Close(); }
+
+	// ʼ·port Ϊ 0 ʾ
+	// Ǳߵ˯Ͳ(WheatAdmission)·ĵһ֡ŶԵϵİ secretΪʱֻϼַ
+	bool Start(const char * listenAddress, int port, const std::string & secret);
+	void Close();
+
+	// ͹˿һ TCPԱ  select 
+	void AddToFdSet(fd_set * pReadSet);
+	// Ӵ··ϵ֡˯͵ϢỰõ socket  pReadSet 
+	// ĳλ˯͵ĻʱŲµĻ·֡ȲһȦ
+	void Poll(fd_set * pReadSet);
+	// һȦµ֡ȥ
+	void Flush();
+
+	// ǲǱߵ˯
+	inline bool Owns(SOCKET sock) { return sock >= WHEATGATEWAYHUB_VIRTUAL_SOCKET_BASE && m_clients.count(sock) > 0; }
+
+	bool Send(SOCKET sock, const char * buf, size_t len);
+	// ϿǱߵһλ˯֪ͣͨعص
+	bool Disconnect(SOCKET sock);
+
+	inline size_t GetClientNum() { return m_clients.size(); }
+	size_t GetLinkNum();
+
+private:
+
+	struct GatewayClient {
+		int linkIndex;			// ·ԺΪ -1
+		unsigned int clientId;	// Ǳߵı
+	};
+
+	void Accept();
+	void CloseLink(int linkIndex);
+
+	// ·յ֡˯͵ĻŲʱ false
+	bool HandleFrame(int linkIndex, const WheatMuxHeader & header, const char * payload);
+
+	static inline unsigned long long MakeKey(int linkIndex, unsigned int clientId) { return (static_cast<unsigned long long>(linkIndex) << 32) | clientId; }
+
+	WheatSessionScheduler * m_pSessions = nullptr;
+
+	SOCKET m_listenSocket = INVALID_SOCKET;
+	WheatMuxLink m_links[WHEATGATEWAYHUB_MAX_LINKS];
+	std::string m_secret;
+
+	//  socket -> ˯ͣ(·, Ǳߵı) ->  socket
+	std::unordered_map<SOCKET, GatewayClient> m_clients;
+	std::unordered_map<unsigned long long, SOCKET> m_virtualSockets;
+	SOCKET m_nextVirtualSocket = WHEATGATEWAYHUB_VIRTUAL_SOCKET_BASE;
+};
@@ -0,0 +1,93 @@
+#include "WheatGovernor.h"
+#include "ProjectCommon.h"
+#include "WheatMetrics.h"
+
+#include <iostream>
+
+void WheatGovernor::SetBudget(long long budgetMs)
+{
+	m_budgetMs = budgetMs;
+	if(m_budgetMs == 0) {
+		m_level = 0;
+		m_calmWindows = 0;
+	}
+}
+
+void WheatGovernor::RecordIteration(long long waitNs, long long busyNs, size_t readyNum)
+{
+	m_waitNs += waitNs;
+	m_busyNs += busyNs;
+	m_worstBusyNs = MAX(m_worstBusyNs, busyNs);
+	m_worstReadyNum = MAX(m_worstReadyNum, readyNum);
+}
+
+void WheatGovernor::RecordTickLag(long long lagMs)
+{
+	m_worstTickLagMs = MAX(m_worstTickLagMs, lagMs);
+}
+
+bool WheatGovernor::Update()
+{
+	long long nowMs = m_pClock->NowMs();
+	if(nowMs < m_windowEndMs) {
+		return false;
+	}
+	m_windowEndMs = nowMs + WHEATGOVERNOR_WINDOW_MS;
+
+	long long totalNs = m_waitNs + m_busyNs;
+	m_lastBusyPercent = totalNs > 0 ? static_cast<int>(m_busyNs * 100 / totalNs) : 0;
+	m_lastWorstBusyNs = m_worstBusyNs;
+	m_lastWorstTickLagMs = m_worstTickLagMs;
+	m_lastWorstReadyNum = m_worstReadyNum;
+
+	m_waitNs = 0;
+	m_busyNs = 0;
+	m_worstBusyNs = 0;
+	m_worstTickLagMs = 0;
+	m_worstReadyNum = 0;
+
+	if(m_budgetMs == 0) {
+		return false;
+	}
+
+	// һȦæóԤ㣬ߵδ˳Ԥ㣬̫æһһֱɲȥ
+	long long budgetNs = m_budgetMs * 1000000;
+	bool overloaded = m_lastBusyPercent >= WHEATGOVERNOR_BUSY_HIGH_PERCENT || m_lastWorstBusyNs > budgetNs || m_lastWorstTickLagMs > m_budgetMs;
+	bool calm = m_lastBusyPercent < WHEATGOVERNOR_BUSY_LOW_PERCENT && m_lastWorstBusyNs <= budgetNs / 2 && m_lastWorstTickLagMs <= m_budgetMs / 2;
+
+	int oldLevel = m_level;
+	if(overloaded) {
+		m_calmWindows = 0;
+		if(m_level < WHEATGOVERNOR_MAX_LEVEL) {
+			m_level++;
+			m_raises++;
+		}
+	} else if(calm && m_level > 0) {
+		if(++m_calmWindows >= WHEATGOVERNOR_CALM_WINDOWS) {
+			m_calmWindows = 0;
+			m_level--;
+			m_lowers++;
+		}
+	} else {
+		m_calmWindows = 0;
+	}
+
+	if(m_level == oldLevel) {
+		return false;
+	}
+
+	printf("Load Level %d -> %d, Busy %d%%, Worst Loop %lld ms, Worst Tick Lag %lld ms, Ready %zu.\n", oldLevel, m_level, m_lastBusyPercent, m_lastWorstBusyNs / 1000000, m_lastWorstTickLagMs, m_lastWorstReadyNum);
+	return true;
+}
+
+void WheatGovernor::PrintStats(std::string * pOut)
+{
+	WheatPrintf(pOut, "----------- Load Stats ----------\n");
+	WheatPrintf(pOut, "load level        : %d%s\n", m_level, m_budgetMs == 0 ? " (off)" : "");
+	WheatPrintf(pOut, "loop budget       : %lld ms\n", m_budgetMs);
+	WheatPrintf(pOut, "busy              : %d%%\n", m_lastBusyPercent);
+	WheatPrintf(pOut, "worst loop        : %.3f ms\n", m_lastWorstBusyNs / 1000000.0);
+	WheatPrintf(pOut, "worst tick lag    : %lld ms\n", m_lastWorstTickLagMs);
+	WheatPrintf(pOut, "worst ready queue : %zu\n", m_lastWorstReadyNum);
+	WheatPrintf(pOut, "level changes     : %llu up, %llu down\n", m_raises, m_lowers);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "WheatClock.h"
+
+#include <string>
+
+// ¼ѭһȦæã˾Ҫλ 룬0 ʾ
+#define WHEATGOVERNOR_BUDGET_MS 50
+
+// жһҪҪλ 
+#define WHEATGOVERNOR_WINDOW_MS 500
+
+// һж¼ѭæʱռ˰ٷ֮Ͼأٷ֮²
+#define WHEATGOVERNOR_BUSY_HIGH_PERCENT 85
+#define WHEATGOVERNOR_BUSY_LOW_PERCENT 50
+
+// ɶٸжڲŽһñذڶ
+#define WHEATGOVERNOR_CALM_WINDOWS 4
+
+// ߼
+#define WHEATGOVERNOR_MAX_LEVEL 3
+
+// Ա¼ѭÿһȦæ˶áδ˶áжٻỰŶӵУæʱļ
+// Լֻּ TCPԱ żķƵʡϲĴڡͣҪĻ־ʱͳƣ
+//	0 
+//	1 ںȺſļӱӡȥϢͳָʱ
+//	2 ı
+//	3 ɰ˱Ⱥģʽ˵ĻٶȺģʽֻ˯
+class WheatGovernor {
+public:
+	WheatGovernor(WheatClock * pClock = GetSystemClock()) { m_pClock = pClock; }
+
+	// ¼ѭһȦæã0 ʾܣһֱ 0
+	void SetBudget(long long budgetMs);
+
+	// ¼ѭתһȦwaitNs Ϊ select ȴʱ䣬busyNs Ϊɻʱ䣬readyNum ΪһȦѵĻỰ
+	void RecordIteration(long long waitNs, long long busyNs, size_t readyNum);
+	// ĵδԤʱ˶
+	void RecordTickLag(long long lagMs);
+
+	// жϵʱжһΣ˷ true
+	bool Update();
+
+	inline int GetLevel() { return m_level; }
+
+	// ӡԱͳƣpOut ˼ͬ WheatPrintf()
+	void PrintStats(std::string * pOut = nullptr);
+
+private:
+
+	WheatClock * m_pClock = nullptr;
+
+	long long m_budgetMs = WHEATGOVERNOR_BUDGET_MS;
+	int m_level = 0;
+	int m_calmWindows = 0;
+	long long m_windowEndMs = 0;
+
+	// ж
+	long long m_waitNs = 0;
+	long long m_busyNs = 0;
+	long long m_worstBusyNs = 0;
+	long long m_worstTickLagMs = 0;
+	size_t m_worstReadyNum = 0;
+
+	// һжڵݣԱ
+	int m_lastBusyPercent = 0;
+	long long m_lastWorstBusyNs = 0;
+	long long m_lastWorstTickLagMs = 0;
+	size_t m_lastWorstReadyNum = 0;
+
+	unsigned long long m_raises = 0;
+	unsigned long long m_lowers = 0;
+};
@@ -0,0 +1,146 @@
+#include "WheatLoopbackTransport.h"
+#include "ProjectCommon.h"
+
+#include <cstring>
+
+void WheatLoopbackTransport::Attach(WheatRoom * pRoom)
+{
+	m_pRoom = pRoom;
+
+	//  TCPԱ һܹڵ
+	m_sessions.SetSessionBody([this](WheatSession & session) {
+		if(m_spectatorSockets.count(session.GetSocket()) != 0) {
+			return m_pRoom->RunSpectatorSession(session);
+		}
+		return m_pRoom->RunSession(session);
+	});
+}
+
+void WheatLoopbackTransport::Reserve(size_t connectionNum, size_t sessionNum)
+{
+	m_connections.reserve(connectionNum);
+	m_sessions.Reserve(sessionNum);
+}
+
+SOCKET WheatLoopbackTransport::Connect(const char * ipAddress)
+{
+	//  socket ã֤ͬһģÿӵ socket ͬ
+	SOCKET sock = firstSocket + static_cast<SOCKET>(m_connections.size());
+	m_connections.push_back(LoopbackConnection());
+	m_connections.back().connected = true;
+
+	m_sessions.Start(sock, ipAddress);
+	RunLoopIteration();
+
+	return sock;
+}
+
+SOCKET WheatLoopbackTransport::ConnectSpectator()
+{
+	SOCKET sock = firstSocket + static_cast<SOCKET>(m_connections.size());
+	m_connections.push_back(LoopbackConnection());
+	m_connections.back().connected = true;
+
+	m_spectatorSockets.insert(sock);
+	m_sessions.Start(sock, "127.0.0.1");
+	RunLoopIteration();
+
+	return sock;
+}
+
+void WheatLoopbackTransport::Inject(SOCKET sock, const char * str)
+{
+	Inject(sock, str, strlen(str));
+}
+
+void WheatLoopbackTransport::Inject(SOCKET sock, const char * buf, size_t len)
+{
+	if(IsConnected(sock) == false) {
+		return;
+	}
+
+	//  TCPԱ һỰϢһ '\0' β
+	m_injectBuffer.resize(len + 1);
+	memcpy(m_injectBuffer.data(), buf, len);
+	m_injectBuffer[len] = '\0';
+
+	// ÷֡ԱгһһģһһŽỰĽջ
+	size_t scanLen = (len > 0 && buf[len - 1] == '\0') ? len : len + 1;
+	m_injectFrames.resize(scanLen);
+
+	size_t frameNum = 0;
+	WheatFrameScanner::Scan(m_injectBuffer.data(), scanLen, m_injectFrames.data(), m_injectFrames.size(), & frameNum);
+
+	for(size_t i = 0; i < frameNum; i++) {
+		WheatFrameSpan & frame = m_injectFrames[i];
+		// Ų˾ûỰϢ socket һʣµ"ں"
+		if(m_sessions.Deliver(sock, m_injectBuffer.data() + frame.offset, frame.len + 1) == false) {
+			m_sessions.RunReady();
+			if(m_sessions.Deliver(sock, m_injectBuffer.data() + frame.offset, frame.len + 1) == false) {
+				printf("Loopback Client %zd Receive Buffer Full! DROP!\n", sock);
+			}
+		}
+	}
+
+	// һ Inject ൱¼ѭתһȦ
+	RunLoopIteration();
+}
+
+void WheatLoopbackTransport::Hangup(SOCKET sock)
+{
+	m_sessions.Hangup(sock);
+	RunLoopIteration();
+}
+
+void WheatLoopbackTransport::AdvanceTime(WheatVirtualClock * pClock, long long durationMs, long long tickMs)
+{
+	for(long long passedMs = 0; passedMs < durationMs; passedMs += tickMs) {
+		pClock->AdvanceMs(tickMs);
+		m_pRoom->Tick();
+		m_sessions.Tick();
+		RunLoopIteration();
+	}
+}
+
+void WheatLoopbackTransport::RunLoopIteration()
+{
+	m_sessions.RunReady();
+	m_pRoom->EndLoopIteration();
+}
+
+bool WheatLoopbackTransport::IsConnected(SOCKET sock)
+{
+	if(sock < firstSocket || SocketToIndex(sock) >= m_connections.size()) {
+		return false;
+	}
+	return m_connections[SocketToIndex(sock)].connected;
+}
+
+bool WheatLoopbackTransport::Send(SOCKET destSocket, const char * buf, size_t len)
+{
+	if(IsConnected(destSocket) == false) {
+		return false;
+	}
+
+	m_sentMessages++;
+	m_sentBytes += len;
+
+	if(m_keepOutbound) {
+		m_connections[SocketToIndex(destSocket)].outbound.append(buf, len);
+	}
+	return true;
+}
+
+bool WheatLoopbackTransport::Disconnect(SOCKET sock)
+{
+	if(IsConnected(sock) == false) {
+		return false;
+	}
+
+	m_connections[SocketToIndex(sock)].connected = false;
+	m_spectatorSockets.erase(sock);
+
+	//  TCPԱ һỰһ RunReady() ʱ
+	m_sessions.Hangup(sock, true);
+	return true;
+}
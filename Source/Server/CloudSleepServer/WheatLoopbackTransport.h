@@ -0,0 +1,100 @@
+#pragma once
+
+#include "WheatTransport.h"
+#include "WheatRoom.h"
+#include "WheatClock.h"
+#include "WheatFrameScanner.h"
+#include "WheatSession.h"
+
+#include <vector>
+#include <string>
+#include <unordered_set>
+
+// ڴػԱ磬Ϣͬһ̵ڴ
+// ڵʵȫͬķ߼ȷԵĲԺͻ׼ԣ԰Ѵ߼ں I/O ֿ
+// ÿӺ TCPԱ һɻỰԱһỰܷܼҵ RunSession()гʱЭ֡ͻĸöһ
+// ÷
+//	WheatVirtualClock clock;
+//	WheatLoopbackTransport transport(& clock);
+//	WheatRoom room(& transport, & clock);
+//	transport.Attach(& room);
+//	SOCKET a = transport.Connect("127.0.0.1");
+//	transport.Inject(a, "move$320,300");
+//	transport.AdvanceTime(& clock, 60 * 60 * 1000);
+class WheatLoopbackTransport : public WheatTransport {
+public:
+
+	// pClock ҪͷܼõͬһỰϢĳʱ
+	WheatLoopbackTransport(WheatClock * pClock = GetSystemClock()) : m_sessions(pClock) {}
+
+	void Attach(WheatRoom * pRoom);
+
+	// ģһµĿͻӽ뷿䣬طļ socket
+	SOCKET Connect(const char * ipAddress = "127.0.0.1");
+	// ģһڵĿպ֮ı仯Ҫȷδ𵽵˲Żյ
+	SOCKET ConnectSpectator();
+
+	// ģͻ˷һϢһ '\0' βַ
+	void Inject(SOCKET sock, const char * str);
+	// ģͻһηһֽкü '\0' βϢһû '\0' ĻҲϢ
+	void Inject(SOCKET sock, const char * buf, size_t len);
+
+	// ģͻ˶ϿỰʱɷܼҰ뿪
+	void Hangup(SOCKET sock);
+
+	// ǰ durationMs 룬ÿ tickMs ÷ͻỰԱδһΣ TCPԱ ĵδౣһ
+	// ϢȵʱĻỰﱻѣΪ̫ñ
+	void AdvanceTime(WheatVirtualClock * pClock, long long durationMs, long long tickMs = 10);
+
+	// Ƿÿյݣ׼ʱصʡ¿ֻͳ
+	void SetKeepOutbound(bool bKeep) { m_keepOutbound = bKeep; }
+
+	// ĳӵĿǰΪֹյȫݣϢβʵ socket ϵֽһ
+	const std::string & GetOutbound(SOCKET sock) { return m_connections[SocketToIndex(sock)].outbound; }
+	void ClearOutbound(SOCKET sock) { m_connections[SocketToIndex(sock)].outbound.clear(); }
+
+	bool IsConnected(SOCKET sock);
+
+	// Ԥ׼ connectionNum ӣ socket ãģһжٸӾ׼٣ͬʱߵ sessionNum Ự
+	void Reserve(size_t connectionNum, size_t sessionNum);
+
+	// ỰԱ뿴мỰʱ
+	inline WheatSessionScheduler & GetSessions() { return m_sessions; }
+
+	inline unsigned long long GetSentMessages() { return m_sentMessages; }
+	inline unsigned long long GetSentBytes() { return m_sentBytes; }
+	inline void ResetCounters() { m_sentMessages = 0; m_sentBytes = 0; }
+
+	bool Send(SOCKET destSocket, const char * buf, size_t len) override;
+	bool Disconnect(SOCKET sock) override;
+
+private:
+
+	struct LoopbackConnection {
+		bool connected = false;
+		std::string outbound = "";
+	};
+
+	//  socket  firstSocket ʼţ 0INVALID_SOCKET 
+	static const SOCKET firstSocket = 1000;
+
+	inline size_t SocketToIndex(SOCKET sock) { return static_cast<size_t>(sock - firstSocket); }
+
+	// ѻỰԱµĻ꣬൱¼ѭתһȦ
+	void RunLoopIteration();
+
+	WheatRoom * m_pRoom = nullptr;
+
+	WheatSessionScheduler m_sessions;
+	std::unordered_set<SOCKET> m_spectatorSockets;
+
+	std::vector<LoopbackConnection> m_connections;
+
+	std::vector<char> m_injectBuffer;
+	std::vector<WheatFrameSpan> m_injectFrames;
+
+	bool m_keepOutbound = true;
+
+	unsigned long long m_sentMessages = 0;
+	unsigned long long m_sentBytes = 0;
+};
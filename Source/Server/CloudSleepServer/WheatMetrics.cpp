@@ -0,0 +1,181 @@
+#include "WheatMetrics.h"
+#include "ProjectCommon.h"
+
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <cstdarg>
+
+static std::atomic<unsigned long long> s_heapAllocations { 0 };
+
+#if WHEATMETRICS_COUNT_HEAP
+
+// ȫ operator new 滻汾ֻǶһ´new[]nothrow 汾Ĭ϶ת
+void * operator new(size_t size)
+{
+	s_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	void * p = malloc(size == 0 ? 1 : size);
+	if(p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void * p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void * p, size_t size) noexcept
+{
+	free(p);
+}
+
+#endif // WHEATMETRICS_COUNT_HEAP
+
+void WheatPrintf(std::string * pOut, const char * format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	if(pOut == nullptr) {
+		vprintf(format, args);
+	} else {
+		char line[512];
+		int len = vsnprintf(line, sizeof(line), format, args);
+		if(len > 0) {
+			pOut->append(line, MIN(static_cast<size_t>(len), sizeof(line) - 1));
+		}
+	}
+	va_end(args);
+}
+
+unsigned long long WheatMetrics::GetHeapAllocations()
+{
+	return s_heapAllocations.load(std::memory_order_relaxed);
+}
+
+void WheatMetrics::RecordHandler(WheatCommandType type, long long costNs, unsigned long long heapAllocations)
+{
+	WheatHandlerStats & stats = m_handlerStats[static_cast<int>(type)];
+	stats.calls++;
+	stats.totalNs += costNs;
+	stats.maxNs = MAX(stats.maxNs, costNs);
+	stats.heapAllocations += heapAllocations;
+}
+
+void WheatMetrics::RecordLatency(WheatCommandType type, long long latencyNs)
+{
+	WheatLatencyStats & stats = m_latencyStats[static_cast<int>(type)];
+	stats.samples++;
+	stats.totalNs += latencyNs;
+	stats.maxNs = MAX(stats.maxNs, latencyNs);
+
+	int bucket = 0;
+	for(long long us = latencyNs / 1000; us > 0 && bucket < WHEATMETRICS_LATENCY_BUCKETS - 1; us >>= 1) {
+		bucket++;
+	}
+	stats.buckets[bucket]++;
+}
+
+long long WheatMetrics::GetLatencyPercentileUs(WheatCommandType type, int percent)
+{
+	WheatLatencyStats & stats = m_latencyStats[static_cast<int>(type)];
+	if(stats.samples == 0) {
+		return 0;
+	}
+
+	// ȡٵʱ p99 ҲǸϣͰϽʱ
+	unsigned long long rank = (stats.samples * percent + 99) / 100;
+	unsigned long long seen = 0;
+	for(int i = 0; i < WHEATMETRICS_LATENCY_BUCKETS - 1; i++) {
+		seen += stats.buckets[i];
+		if(seen >= rank) {
+			return MIN(1LL << i, stats.maxNs / 1000);
+		}
+	}
+	return stats.maxNs / 1000;
+}
+
+void WheatMetrics::RecordLoopIteration(size_t arenaUsedBytes, size_t arenaCapacity, size_t arenaChunks)
+{
+	m_loopStats.iterations++;
+	m_loopStats.arenaPeakBytes = MAX(m_loopStats.arenaPeakBytes, arenaUsedBytes);
+	m_loopStats.arenaCapacity = arenaCapacity;
+	m_loopStats.arenaChunks = arenaChunks;
+}
+
+void WheatMetrics::ResetHandlerStats()
+{
+	for(int i = 0; i < static_cast<int>(WheatCommandType::count); i++) {
+		m_handlerStats[i] = WheatHandlerStats();
+	}
+}
+
+void WheatMetrics::ResetLatencyStats()
+{
+	for(int i = 0; i < static_cast<int>(WheatCommandType::count); i++) {
+		m_latencyStats[i] = WheatLatencyStats();
+	}
+}
+
+void WheatMetrics::PrintHandlerStats(std::string * pOut)
+{
+	WheatCommandProgrammer commandProgrammer;
+
+	WheatPrintf(pOut, "--------- Handler Stats ---------\n");
+	WheatPrintf(pOut, "%-10s %12s %12s %12s %12s\n", "command", "calls", "avg(ns)", "max(ns)", "heap");
+	for(int i = 0; i < static_cast<int>(WheatCommandType::count); i++) {
+		WheatHandlerStats & stats = m_handlerStats[i];
+		if(stats.calls == 0) {
+			continue;
+		}
+		WheatPrintf(pOut, "%-10s %12llu %12lld %12lld %12llu\n", commandProgrammer.GetCommandTypeName(static_cast<WheatCommandType>(i)), stats.calls, stats.totalNs / static_cast<long long>(stats.calls), stats.maxNs, stats.heapAllocations);
+	}
+	WheatPrintf(pOut, "---------------------------------\n");
+}
+
+void WheatMetrics::PrintLatencyStats(std::string * pOut)
+{
+	WheatCommandProgrammer commandProgrammer;
+
+	WheatPrintf(pOut, "--------- Latency Stats ---------\n");
+	WheatPrintf(pOut, "%-10s %10s %10s %10s %10s %10s %10s\n", "command", "samples", "avg(us)", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+	for(int i = 0; i < static_cast<int>(WheatCommandType::count); i++) {
+		WheatLatencyStats & stats = m_latencyStats[i];
+		if(stats.samples == 0) {
+			continue;
+		}
+		WheatCommandType type = static_cast<WheatCommandType>(i);
+		WheatPrintf(pOut, "%-10s %10llu %10lld %10lld %10lld %10lld %10lld\n", commandProgrammer.GetCommandTypeName(type), stats.samples,
+			stats.totalNs / static_cast<long long>(stats.samples) / 1000, GetLatencyPercentileUs(type, 50), GetLatencyPercentileUs(type, 90), GetLatencyPercentileUs(type, 99), stats.maxNs / 1000);
+	}
+	WheatPrintf(pOut, "---------------------------------\n");
+}
+
+void WheatMetrics::PrintAllocationStats(std::string * pOut)
+{
+	WheatPrintf(pOut, "------- Allocation Stats --------\n");
+	WheatPrintf(pOut, "loop iterations   : %llu\n", m_loopStats.iterations);
+	WheatPrintf(pOut, "arena peak bytes  : %zu\n", m_loopStats.arenaPeakBytes);
+	WheatPrintf(pOut, "arena capacity    : %zu (%zu chunks)\n", m_loopStats.arenaCapacity, m_loopStats.arenaChunks);
+#if WHEATMETRICS_COUNT_HEAP
+	WheatPrintf(pOut, "heap allocations  : %llu\n", GetHeapAllocations());
+#else
+	WheatPrintf(pOut, "heap allocations  : (not counted)\n");
+#endif
+	WheatPrintf(pOut, "---------------------------------\n");
+}
+
+void WheatMetrics::PrintConnectionStats(std::string * pOut)
+{
+	WheatPrintf(pOut, "------- Connection Stats --------\n");
+	WheatPrintf(pOut, "joins             : %llu\n", m_connectionStats.joins);
+	WheatPrintf(pOut, "leaves            : %llu\n", m_connectionStats.leaves);
+	WheatPrintf(pOut, "pings sent        : %llu\n", m_connectionStats.pingsSent);
+	WheatPrintf(pOut, "idle timeouts     : %llu\n", m_connectionStats.idleTimeouts);
+	WheatPrintf(pOut, "slow clients      : %llu\n", m_connectionStats.slowClients);
+	WheatPrintf(pOut, "handshake timeouts: %llu\n", m_connectionStats.handshakeTimeouts);
+	WheatPrintf(pOut, "---------------------------------\n");
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "WheatCommand.h"
+
+#include <string>
+
+// Ƿ滻ȫֵ operator new ͳȫֶҪڴĴÿһԭӼӷߡءTLS ЩطҲһҪ
+// Ĭֻ Debug 򿪣ʽڴĻʱ WHEATMETRICS_COUNT_HEAP=1
+// صԺ GetHeapAllocations() һֱ 0
+#ifndef WHEATMETRICS_COUNT_HEAP
+#ifdef _DEBUG
+#define WHEATMETRICS_COUNT_HEAP 1
+#else
+#define WHEATMETRICS_COUNT_HEAP 0
+#endif
+#endif
+
+// ʽһ֣pOut Ϊ nullptr ʱֱӴӡ̨ *pOut 棨Ҫ˿ϵĹԱ
+void WheatPrintf(std::string * pOut, const char * format, ...);
+
+// ÿһָĴʱͳƣʱָͰָת˯
+struct WheatHandlerStats {
+	unsigned long long calls = 0;
+	long long totalNs = 0;
+	long long maxNs = 0;
+	unsigned long long heapAllocations = 0;	// ڼȫֶҪڴĴȶʱӦһֱ 0
+};
+
+// ӳٷֲֳɶٸͰ 0 Ͱװ 1 ΢ģ i Ͱװ [2^(i-1), 2^i) ΢ģһͰװи
+#define WHEATMETRICS_LATENCY_BUCKETS 24
+
+// ÿһָյһλ˯յĺʱֲֻͳ׷Ա(WheatTracer) еЩ
+struct WheatLatencyStats {
+	unsigned long long samples = 0;
+	long long totalNs = 0;
+	long long maxNs = 0;
+	unsigned long long buckets[WHEATMETRICS_LATENCY_BUCKETS] = {};
+};
+
+// ¼ѭÿһȦڴͳƣÿһȦʱݶڷʱֿһȦһ
+struct WheatLoopStats {
+	unsigned long long iterations = 0;
+	size_t arenaPeakBytes = 0;		// һȦʱֿùֽ
+	size_t arenaCapacity = 0;		// ʱֿһжֽ
+	size_t arenaChunks = 0;			// ʱֿȫֶҪڴ
+};
+
+// ӵĽͳ
+struct WheatConnectionStats {
+	unsigned long long joins = 0;
+	unsigned long long leaves = 0;
+	unsigned long long pingsSent = 0;		// ȥ
+	unsigned long long idleTimeouts = 0;	// ̫ûϢϿӣǶԷѾߵİ뿪ӣ
+	unsigned long long slowClients = 0;		// յ̫ûȥܹ޶Ͽ
+	unsigned long long handshakeTimeouts = 0;	// WebSocket ̫ûֶϿ
+};
+
+// ͳԱ¼ʱĸݣҳ
+class WheatMetrics {
+public:
+
+	void RecordHandler(WheatCommandType type, long long costNs, unsigned long long heapAllocations = 0);
+
+	inline const WheatHandlerStats & GetHandlerStats(WheatCommandType type) { return m_handlerStats[static_cast<int>(type)]; }
+
+	void ResetHandlerStats();
+
+	// ӡбùָĴƽʱʱpOut ˼ͬ WheatPrintf()
+	void PrintHandlerStats(std::string * pOut = nullptr);
+
+	void RecordLatency(WheatCommandType type, long long latencyNs);
+
+	inline const WheatLatencyStats & GetLatencyStats(WheatCommandType type) { return m_latencyStats[static_cast<int>(type)]; }
+
+	//  percent% ΢루ͰϽ㣬һ
+	long long GetLatencyPercentileUs(WheatCommandType type, int percent);
+
+	void ResetLatencyStats();
+
+	// ӡ׷ٹָƽp50/p90/p99 ʱpOut ˼ͬ WheatPrintf()
+	void PrintLatencyStats(std::string * pOut = nullptr);
+
+	// ¼ѭתһȦarenaUsedBytes ΪһȦõʱֽֿ
+	void RecordLoopIteration(size_t arenaUsedBytes, size_t arenaCapacity, size_t arenaChunks);
+
+	inline const WheatLoopStats & GetLoopStats() { return m_loopStats; }
+
+	// ӡ¼ѭڴͳ
+	void PrintAllocationStats(std::string * pOut = nullptr);
+
+	// ӡӵĽͳ
+	void PrintConnectionStats(std::string * pOut = nullptr);
+
+	WheatConnectionStats m_connectionStats;
+
+	// һȫֶҪڴ棨̼߳
+	static unsigned long long GetHeapAllocations();
+
+	// ǷͳָʱÿָҪ࿴αԼʮ룩
+	bool m_handlerTiming = true;
+
+private:
+	WheatHandlerStats m_handlerStats[static_cast<int>(WheatCommandType::count)];
+
+	WheatLatencyStats m_latencyStats[static_cast<int>(WheatCommandType::count)];
+
+	WheatLoopStats m_loopStats;
+};
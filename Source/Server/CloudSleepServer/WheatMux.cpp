@@ -0,0 +1,156 @@
+#include "WheatMux.h"
+#include "ProjectCommon.h"
+
+#include <iostream>
+#include <cstring>
+
+void WheatMuxLink::Attach(SOCKET sock)
+{
+	Close();
+
+	m_sock = sock;
+	m_recvBuffer.resize(WHEATMUX_RECV_BUFFER_SIZE);
+	m_sendBuffer.clear();
+	m_recvStart = 0;
+	m_recvLen = 0;
+	m_broken = false;
+	m_trusted = false;
+}
+
+bool WheatMuxLink::AcceptHello(const WheatMuxHeader & header, const char * payload, const std::string & secret)
+{
+	if(header.type != WheatMuxType::Hello) {
+		return false;
+	}
+
+	m_trusted = WheatMuxSecretMatch(payload, header.payloadLen, secret);
+	return m_trusted;
+}
+
+bool WheatMuxSecretMatch(const char * given, size_t len, const std::string & secret)
+{
+	if(len != secret.size()) {
+		return false;
+	}
+
+	// ڵһԲϵֽھͷ
+	unsigned char diff = 0;
+	for(size_t i = 0; i < secret.size(); i++) {
+		diff |= static_cast<unsigned char>(given[i] ^ secret[i]);
+	}
+	return diff == 0;
+}
+
+bool WheatMuxIsLoopback(const char * address)
+{
+	unsigned long addr = inet_addr(address);
+	return addr != INADDR_NONE && (ntohl(addr) >> 24) == 127;
+}
+
+void WheatMuxLink::Close()
+{
+	if(m_sock != INVALID_SOCKET) {
+		closesocket(m_sock);
+		m_sock = INVALID_SOCKET;
+	}
+	m_sendBuffer.clear();
+	m_recvStart = 0;
+	m_recvLen = 0;
+}
+
+void WheatMuxLink::Queue(WheatMuxType type, unsigned int clientId, const char * payload, size_t len)
+{
+	WheatMuxHeader header;
+	header.payloadLen = static_cast<unsigned int>(len);
+	header.clientId = clientId;
+	header.type = type;
+	memset(header.reserved, 0, sizeof(header.reserved));
+
+	// ͻֻȶԺ֡ȫֶҪڴ
+	size_t offset = m_sendBuffer.size();
+	m_sendBuffer.resize(offset + sizeof(header) + len);
+	memcpy(& m_sendBuffer[offset], & header, sizeof(header));
+	if(len > 0) {
+		memcpy(& m_sendBuffer[offset + sizeof(header)], payload, len);
+	}
+}
+
+bool WheatMuxLink::Flush()
+{
+	if(m_sock == INVALID_SOCKET || m_sendBuffer.empty()) {
+		return true;
+	}
+
+	size_t sentLen = 0;
+	while(sentLen < m_sendBuffer.size()) {
+		int sendRes = send(m_sock, & m_sendBuffer[sentLen], int(m_sendBuffer.size() - sentLen), 0);
+		if(sendRes == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+			// ԷյȥĲõʣµĵһ
+			m_sendBuffer.erase(m_sendBuffer.begin(), m_sendBuffer.begin() + sentLen);
+			return true;
+		}
+		if(sendRes == SOCKET_ERROR) {
+			printf("Mux Link %lld Send Error %d.\n", static_cast<long long>(m_sock), WSAGetLastError());
+			m_sendBuffer.clear();
+			return false;
+		}
+		sentLen += sendRes;
+	}
+
+	m_sendBuffer.clear();
+	return true;
+}
+
+bool WheatMuxLink::Receive()
+{
+	// ֽŲߣڵط
+	if(m_recvStart > 0) {
+		memmove(& m_recvBuffer[0], & m_recvBuffer[m_recvStart], m_recvLen - m_recvStart);
+		m_recvLen -= m_recvStart;
+		m_recvStart = 0;
+	}
+
+	// ˵ǰ֡û꣬ȴգں
+	if(m_recvLen == m_recvBuffer.size()) {
+		return true;
+	}
+
+	int recvRes = recv(m_sock, & m_recvBuffer[m_recvLen], int(m_recvBuffer.size() - m_recvLen), 0);
+	if(recvRes == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+		return true;
+	}
+	if(recvRes == SOCKET_ERROR || recvRes == 0) {
+		return false;
+	}
+	m_recvLen += recvRes;
+	return true;
+}
+
+bool WheatMuxLink::PeekFrame(WheatMuxHeader * pHeader, const char ** pPayload)
+{
+	size_t available = m_recvLen - m_recvStart;
+	if(available < sizeof(WheatMuxHeader)) {
+		return false;
+	}
+
+	memcpy(pHeader, & m_recvBuffer[m_recvStart], sizeof(WheatMuxHeader));
+	if(pHeader->payloadLen > WHEATMUX_MAX_PAYLOAD_SIZE || pHeader->type < WheatMuxType::Open || pHeader->type >= WheatMuxType::Max) {
+		printf("Mux Link %lld Bad Frame! Closing.\n", static_cast<long long>(m_sock));
+		m_broken = true;
+		return false;
+	}
+
+	if(available < sizeof(WheatMuxHeader) + pHeader->payloadLen) {
+		return false;
+	}
+
+	*pPayload = & m_recvBuffer[m_recvStart + sizeof(WheatMuxHeader)];
+	return true;
+}
+
+void WheatMuxLink::PopFrame()
+{
+	WheatMuxHeader header;
+	memcpy(& header, & m_recvBuffer[m_recvStart], sizeof(header));
+	m_recvStart += sizeof(header) + header.payloadLen;
+}
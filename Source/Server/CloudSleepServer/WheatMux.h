@@ -0,0 +1,96 @@
+#pragma once
+
+#include <winsock.h>
+#include <vector>
+#include <string>
+
+// һ·ĽջС
+#define WHEATMUX_RECV_BUFFER_SIZE (256 * 1024)
+
+// һ֡ֽڣ⻹֡·
+#define WHEATMUX_MAX_PAYLOAD_SIZE (16 * 1024)
+
+// ֮ĳ·źܶϢÿϢװһ֡֡ͷ + 
+// · Open/Data/Closeһ·źܶ˯͵ϢϢ Subscribe/Unsubscribe/Publish
+// ·ĵһ֡ HelloӴһԹŲŴ֡
+enum class WheatMuxType : unsigned char {
+	Open = 1,	//  -> 䣺µ˯أΪ˯͵ IP
+	Data,		// ˫һϢ ->  ˯ͷ "ָ$\0" ->  Ҫ˯͵ "˯id\0Ϣ\0"
+	Close,		// ˫λ˯͵ӶϿˣҪϿ
+
+	Subscribe,		// ڵ -> ̨һ⣬Ϊ '*' βĻͷĻ
+	Unsubscribe,	// ڵ -> ̨ȡ
+	Publish,		// ˫򣺷һϢΪ [ 1 ֽ][][Ϣ]
+
+	Hello,			// ϵһ -> Ӵһ·ϵĵһ֡Ϊ˫ link_secretΪգ
+
+	Max				// ֡µ֡ͼǰ棬յ >= Max ֡·
+};
+
+// ַǲֻбϣ127.x.x.xǱĵַû䰵ŵĻ·Ϣߺ̨ܾ
+bool WheatMuxIsLoopback(const char * address);
+
+// Էİź secret Ƿһÿֽڶ½ۣôӻӦĿ³
+bool WheatMuxSecretMatch(const char * given, size_t len, const std::string & secret);
+
+// ֡ͷͷ x86ֱӰС memcpy
+struct WheatMuxHeader {
+	unsigned int payloadLen;
+	unsigned int clientId;		// һ˯͵ıţϢ߲
+	WheatMuxType type;
+	unsigned char reserved[3];
+};
+
+static_assert(sizeof(WheatMuxHeader) == 12, "WheatMuxHeader must stay 12 bytes on the wire");
+
+// ·Ա·һͷһȦҪ֡һ send ȥҲյֽһ֡һ֡г
+class WheatMuxLink {
+public:
+	WheatMuxLink() {}
+	~WheatMuxLink() { Close(); }
+
+	WheatMuxLink(const WheatMuxLink &) = delete;
+	WheatMuxLink & operator=(const WheatMuxLink &) = delete;
+
+	// һѾõ socketǰµ
+	void Attach(SOCKET sock);
+	// Ͽ·û֡ӵ
+	void Close();
+
+	inline bool IsOpen() { return m_sock != INVALID_SOCKET; }
+
+	// ϵһһ֡ Hello Attach() һ
+	inline void QueueHello(const std::string & secret) { Queue(WheatMuxType::Hello, 0, secret.data(), secret.size()); }
+	// Ӵһһ֡ Hello ҰŶԵϵĻ·Ӵ˿ţ trueԲϵ·ֻܶϿ
+	bool AcceptHello(const WheatMuxHeader & header, const char * payload, const std::string & secret);
+	inline bool IsTrusted() { return m_trusted; }
+	inline SOCKET GetSocket() { return m_sock; }
+
+	// һ֡ Flush() ʱһ𷢳ȥ
+	void Queue(WheatMuxType type, unsigned int clientId, const char * payload, size_t len);
+	// ŵ֡һηȥʧܷ false
+	//  socket һηĻʣµڷͻһ Flush()GetQueuedBytes() Ϊ 0
+	bool Flush();
+	inline size_t GetQueuedBytes() { return m_sendBuffer.size(); }
+
+	//  socket һΣԷϿ false socket ʱûʱ true
+	bool Receive();
+	// һ֡û false*pPayload  PopFrame() ֮ǰЧ
+	// Է֡ͷϷʱ IsBroken() Ϊ true·ֻܶϿ
+	bool PeekFrame(WheatMuxHeader * pHeader, const char ** pPayload);
+	void PopFrame();
+	inline bool IsBroken() { return m_broken; }
+
+private:
+	SOCKET m_sock = INVALID_SOCKET;
+
+	std::vector<char> m_sendBuffer;
+
+	// ջ[m_recvStart, m_recvLen) Ϊûֽ
+	std::vector<char> m_recvBuffer;
+	size_t m_recvStart = 0;
+	size_t m_recvLen = 0;
+
+	bool m_broken = false;
+	bool m_trusted = false;
+};
@@ -0,0 +1,914 @@
+#include "WheatRoom.h"
+#include "ProjectCommon.h"
+
+#include <iostream>
+#include <algorithm>
+
+// m_spectatorMoved ı
+#define WHEATROOM_SPECTATOR_POS 1
+#define WHEATROOM_SPECTATOR_MOVE 2
+
+WheatSessionTask WheatRoom::RunSession(WheatSession & session)
+{
+	SOCKET sock = session.GetSocket();
+
+	int sleeperId = OnJoin(sock, session.GetIPAddress());
+	long long lastHeardMs = m_pClock->NowMs();
+
+	while(true) {
+		WheatSessionMessage message = co_await session.ReadMessage(m_heartbeatMs);
+		if(message.closed) {
+			break;
+		}
+
+		if(message.timedOut) {
+			// ԷֻڷҲ͵ˣ뿪ӣȷһ£̫ûûлӦͿ
+			if(m_pClock->NowMs() - lastHeardMs >= m_idleTimeoutMs) {
+				printf("Client %zd Idle Timeout.\n", sock);
+				m_metrics.m_connectionStats.idleTimeouts++;
+				break;
+			}
+			SendCommand(sock, sleeperId, WheatCommand(WheatCommandType::ping, "", 0, 0));
+			m_metrics.m_connectionStats.pingsSent++;
+			continue;
+		}
+
+		lastHeardMs = m_pClock->NowMs();
+		OnMessage(sock, message.buf, message.len, message.opcodeLen, message.recvNs);
+	}
+
+	// ߡԱϿʱ socket ѾˣҲˣ˵Ѿ˯͵
+	if(session.IsSocketClosed() == false) {
+		CloseClient(sock);
+	}
+}
+
+int WheatRoom::OnJoin(SOCKET sock, const char * ipAddress)
+{
+	// Ǽǵͬʱ¼IPַ
+	int newSleeperId = m_bedManager.RegisterNewSleeper(sock, ipAddress);
+
+	SendCommand(sock, newSleeperId, WheatCommand(WheatCommandType::yourid, "", newSleeperId, 0));
+	SendCommandToAll(newSleeperId, WheatCommand(WheatCommandType::sleeper, "", newSleeperId, 0), sock);
+
+	int * originalSleepersIds = nullptr;
+	WheatCommand * originalSleepersCommands = nullptr;
+	size_t commandNum = 0;
+	MakeSnapshot(newSleeperId, & originalSleepersIds, & originalSleepersCommands, & commandNum);
+
+	// ڿպ棬һη
+	size_t historyLen = m_chatHistory.GetByteNum();
+	size_t bufLen = 0;
+	char * buf = MakeMultiFrame(originalSleepersIds, originalSleepersCommands, commandNum, & bufLen, historyLen);
+	bufLen += m_chatHistory.CopyTo(buf + bufLen);
+	if(bufLen > 0) {
+		m_pTransport->Send(sock, buf, bufLen);
+	}
+
+	m_metrics.m_connectionStats.joins++;
+
+	return newSleeperId;
+}
+
+WheatSessionTask WheatRoom::RunSpectatorSession(WheatSession & session)
+{
+	SOCKET sock = session.GetSocket();
+
+	OnSpectatorJoin(sock);
+	long long lastHeardMs = m_pClock->NowMs();
+
+	while(true) {
+		WheatSessionMessage message = co_await session.ReadMessage(m_heartbeatMs);
+		if(message.closed) {
+			break;
+		}
+
+		if(message.timedOut) {
+			if(m_pClock->NowMs() - lastHeardMs >= m_idleTimeoutMs) {
+				printf("Spectator %zd Idle Timeout.\n", sock);
+				m_metrics.m_connectionStats.idleTimeouts++;
+				break;
+			}
+			SendCommand(sock, -1, WheatCommand(WheatCommandType::ping, "", 0, 0));
+			m_metrics.m_connectionStats.pingsSent++;
+			continue;
+		}
+
+		lastHeardMs = m_pClock->NowMs();
+	}
+
+	if(session.IsSocketClosed() == false) {
+		CloseClient(sock);
+	}
+}
+
+void WheatRoom::OnSpectatorJoin(SOCKET sock)
+{
+	m_newSpectators.push_back(sock);
+	m_metrics.m_connectionStats.joins++;
+}
+
+void WheatRoom::OnMessage(SOCKET sock, const char * buf, size_t len)
+{
+	const char * pDollar = static_cast<const char *>(memchr(buf, '$', len));
+
+	OnMessage(sock, buf, len, pDollar == nullptr ? len : static_cast<size_t>(pDollar - buf));
+}
+
+void WheatRoom::OnMessage(SOCKET sock, const char * buf, size_t len, size_t opcodeLen, long long recvNs)
+{
+	m_tracer.BeginMessage(recvNs);
+
+	long long startNs = m_metrics.m_handlerTiming ? GetSystemClock()->NowNs() : 0;
+	unsigned long long startHeapAllocations = m_metrics.m_handlerTiming ? WheatMetrics::GetHeapAllocations() : 0;
+
+	WheatCommand command = m_pCommandProgrammer->Parse(buf, len, opcodeLen, & m_arena);
+
+	int whoSleeperId = m_bedManager.FindSleeperId(sock);
+
+	if(whoSleeperId < 0 || whoSleeperId >= m_bedManager.m_sleepers.size()) {
+		command.type = WheatCommandType::unknown;
+	} else {
+		Sleeper & sleeper = m_bedManager.m_sleepers[whoSleeperId];
+		sleeper.messagesIn++;
+		sleeper.bytesIn += len + 1;
+	}
+
+	m_tracer.MarkParsed(command.type, whoSleeperId);
+
+	if(m_trace) {
+		printf("Client %zd (%d) : %.*s\n", sock, whoSleeperId, static_cast<int>(len), buf);
+	}
+
+	// ֱָӲҵˣ˷ true ʾҪָת˯
+	CommandContext context = { sock, whoSleeperId, buf };
+	bool broadcast = (this->*s_commandHandlers[static_cast<int>(command.type)])(context, command);
+	m_tracer.MarkHandled();
+	if(broadcast) {
+		// m_pCommandProgrammer->PrintWheatCommand(command);
+
+		// ˶ʱ·ֻ߸ˣԶ˿ÿһεȺſ͹
+		if(m_crowded && (command.type == WheatCommandType::move || command.type == WheatCommandType::pos)) {
+			SendCommandToNearby(whoSleeperId, command, m_crowdRadius);
+		} else if(m_chatRadius > 0 && command.type == WheatCommandType::chat) {
+			SendCommandToNearby(whoSleeperId, command, m_chatRadius);
+		} else {
+			SendCommandToAll(whoSleeperId, command);
+		}
+	}
+	m_tracer.EndMessage();
+
+	// ʱͳһɿʵӣⱨʱԱģʱҲܲʵĿ
+	if(m_metrics.m_handlerTiming) {
+		m_metrics.RecordHandler(command.type, GetSystemClock()->NowNs() - startNs, WheatMetrics::GetHeapAllocations() - startHeapAllocations);
+	}
+}
+
+#pragma region Commands Double Check
+
+constexpr std::array<WheatRoom::CommandHandler, static_cast<int>(WheatCommandType::count)> WheatRoom::MakeCommandHandlers()
+{
+	std::array<CommandHandler, static_cast<int>(WheatCommandType::count)> handlers {};
+
+	// ֻɷ˷͵ָԼûеǼǴ˵ָͳͳ
+	for(int i = 0; i < static_cast<int>(WheatCommandType::count); i++) {
+		handlers[i] = & WheatRoom::HandleRefused;
+	}
+
+	handlers[static_cast<int>(WheatCommandType::unknown)] = & WheatRoom::HandleUnknown;
+
+	handlers[static_cast<int>(WheatCommandType::name)] = & WheatRoom::HandleName;
+	handlers[static_cast<int>(WheatCommandType::type)] = & WheatRoom::HandleType;
+
+	handlers[static_cast<int>(WheatCommandType::sleep)] = & WheatRoom::HandleSleep;
+	handlers[static_cast<int>(WheatCommandType::getup)] = & WheatRoom::HandleGetup;
+
+	handlers[static_cast<int>(WheatCommandType::chat)] = & WheatRoom::HandleChat;
+	handlers[static_cast<int>(WheatCommandType::whisper)] = & WheatRoom::HandleWhisper;
+
+	handlers[static_cast<int>(WheatCommandType::move)] = & WheatRoom::HandleMove;
+	handlers[static_cast<int>(WheatCommandType::pos)] = & WheatRoom::HandlePos;
+
+	handlers[static_cast<int>(WheatCommandType::kick)] = & WheatRoom::HandleKick;
+	handlers[static_cast<int>(WheatCommandType::agree)] = & WheatRoom::HandleAgree;
+	handlers[static_cast<int>(WheatCommandType::refuse)] = & WheatRoom::HandleRefuse;
+
+	handlers[static_cast<int>(WheatCommandType::pong)] = & WheatRoom::HandlePong;
+	handlers[static_cast<int>(WheatCommandType::time)] = & WheatRoom::HandleTime;
+
+	return handlers;
+}
+
+const std::array<WheatRoom::CommandHandler, static_cast<int>(WheatCommandType::count)> WheatRoom::s_commandHandlers = WheatRoom::MakeCommandHandlers();
+
+bool WheatRoom::HandleUnknown(const CommandContext & context, WheatCommand & command)
+{
+	printf("Client %zd : %s\n", context.sock, context.buf);
+	printf("%zd Unknown Command! SKIP!\n", context.sock);
+	return false;
+}
+
+bool WheatRoom::HandleRefused(const CommandContext & context, WheatCommand & command)
+{
+	return false;
+}
+
+bool WheatRoom::HandleName(const CommandContext & context, WheatCommand & command)
+{
+	Sleeper & who = m_bedManager.m_sleepers[context.whoSleeperId];
+
+	who.name.assign(command.GetText());
+	printf("Client %zd : %s\n", context.sock, context.buf);
+	m_chatRecorder.Record(who.IPADDRESS, who.name);
+
+	return true;
+}
+
+bool WheatRoom::HandleType(const CommandContext & context, WheatCommand & command)
+{
+	m_bedManager.m_sleepers[context.whoSleeperId].type = m_bedManager.GetSleeperType(command.nParam[0]);
+	return true;
+}
+
+bool WheatRoom::HandleSleep(const CommandContext & context, WheatCommand & command)
+{
+	// ж˯û˯У
+	Sleeper * whoSleep = m_bedManager.GetSleeper(context.whoSleeperId);
+	if(whoSleep->sleepingBedId != -1) {
+		printf("Sleeper %d Is Sleeping!\n", whoSleep->sleepingBedId);
+		return false;
+	}
+
+	// Խ λid
+	if(command.nParam[0] >= BED_NUM || command.nParam[0] < 0) {
+		printf("Wrong Bed Id!! %d\n", command.nParam[0]);
+		return false;
+	}
+
+	// жϴλǷΪ
+	Bed * pBedTemp = m_bedManager.GetBed(command.nParam[0]);
+	if(!pBedTemp->Empty()) {
+		printf("Bed Is Not Empty. %zd Can Not Sleep.\n", context.sock);
+		return false;
+	}
+
+	printf("%zd Sleep On Bed Which Is BedSleepId = %d\n", context.sock, command.nParam[0]);
+	pBedTemp->Set(false, context.whoSleeperId);
+	whoSleep->sleepingBedId = command.nParam[0];
+
+	return true;
+}
+
+bool WheatRoom::HandleGetup(const CommandContext & context, WheatCommand & command)
+{
+	Sleeper & who = m_bedManager.m_sleepers[context.whoSleeperId];
+
+	// Ƿ˯Уżִ
+	if(who.sleepingBedId != -1) {
+		m_bedManager.GetupBed(who.sleepingBedId);
+		who.sleepingBedId = -1;
+	}
+	return true;
+}
+
+bool WheatRoom::HandleChat(const CommandContext & context, WheatCommand & command)
+{
+	Sleeper & who = m_bedManager.m_sleepers[context.whoSleeperId];
+
+	printf("Client %zd : %s\n", context.sock, context.buf);
+
+	// ¼̧ͷ "IP_}:=>" ʱֿƴ
+	size_t headLen = who.IPADDRESS.length() + 1 + who.name.length() + 4;
+	char * head = static_cast<char *>(m_arena.Allocate(headLen, 1));
+	memcpy(head, who.IPADDRESS.c_str(), who.IPADDRESS.length());
+	head[who.IPADDRESS.length()] = '_';
+	memcpy(head + who.IPADDRESS.length() + 1, who.name.c_str(), who.name.length());
+	memcpy(head + headLen - 4, "}:=>", 4);
+	m_chatRecorder.Record(std::string_view(head, headLen), command.GetText());
+
+	// ֻڸ˵ĻĽڵϵ˯Ͳڸ
+	if(m_onChat && m_chatRadius == 0) {
+		m_onChat(who, command.GetText());
+	}
+
+	return true;
+}
+
+bool WheatRoom::HandleWhisper(const CommandContext & context, WheatCommand & command)
+{
+	int targetSleeperId = command.nParam[0];
+	if(targetSleeperId < 0 || targetSleeperId >= m_bedManager.m_sleepers.size() || m_bedManager.m_sleepers[targetSleeperId].empty || targetSleeperId == context.whoSleeperId) {
+		printf("%zd Whisper To Nobody! %d\n", context.sock, targetSleeperId);
+		return false;
+	}
+
+	Sleeper & who = m_bedManager.m_sleepers[context.whoSleeperId];
+	Sleeper & target = m_bedManager.m_sleepers[targetSleeperId];
+
+	// Ļ̧ͷ "IP_}->˯id:=>"
+	char headTail[24];
+	int headTailLen = snprintf(headTail, sizeof(headTail), "}->%d:=>", targetSleeperId);
+	size_t headLen = who.IPADDRESS.length() + 1 + who.name.length() + headTailLen;
+	char * head = static_cast<char *>(m_arena.Allocate(headLen, 1));
+	memcpy(head, who.IPADDRESS.c_str(), who.IPADDRESS.length());
+	head[who.IPADDRESS.length()] = '_';
+	memcpy(head + who.IPADDRESS.length() + 1, who.name.c_str(), who.name.length());
+	memcpy(head + headLen - headTailLen, headTail, headTailLen);
+	m_chatRecorder.Record(std::string_view(head, headLen), command.GetText());
+
+	// ֻԷԼͬһڴ棻Ļ
+	size_t frameLen = 0;
+	char * frame = MakeFrame(context.whoSleeperId, command, & frameLen);
+	m_pTransport->Send(target.sock, frame, frameLen);
+	m_pTransport->Send(who.sock, frame, frameLen);
+
+	return false;
+}
+
+bool WheatRoom::HandleMove(const CommandContext & context, WheatCommand & command)
+{
+	Sleeper & who = m_bedManager.m_sleepers[context.whoSleeperId];
+
+	who.moveLastData = Vec2<int>(command.nParam[0], command.nParam[1]);
+	who.firstMoved = true;
+
+	return true;
+}
+
+bool WheatRoom::HandlePos(const CommandContext & context, WheatCommand & command)
+{
+	m_bedManager.m_sleepers[context.whoSleeperId].posLastData = Vec2<int>(command.nParam[0], command.nParam[1]);
+	return true;
+}
+
+bool WheatRoom::HandleKick(const CommandContext & context, WheatCommand & command)
+{
+	if(m_voteKick.IsVoting()) {
+		return false;
+	}
+
+	// ֻͶƱ߷е˯
+	int kickSleeperId = command.nParam[0];
+	if(kickSleeperId < 0 || kickSleeperId >= static_cast<int>(m_bedManager.m_sleepers.size()) || m_bedManager.m_sleepers[kickSleeperId].empty) {
+		printf("Wrong Kick Sleeper Id!! %d\n", kickSleeperId);
+		return false;
+	}
+
+	m_voteKick.Init(static_cast<int>(m_bedManager.m_sleepers.size()), command.nParam[0]);
+	m_voteKick.SetIsVoting(true);
+
+	return true;
+}
+
+bool WheatRoom::HandleAgree(const CommandContext & context, WheatCommand & command)
+{
+	if(m_voteKick.AddAgree(context.whoSleeperId) == false) {
+		return false;
+	}
+	m_voteKick.GetVoteAnswer(&command.nParam[0], &command.nParam[1]);
+	return true;
+}
+
+bool WheatRoom::HandleRefuse(const CommandContext & context, WheatCommand & command)
+{
+	if(m_voteKick.AddRefuse(context.whoSleeperId) == false) {
+		return false;
+	}
+	m_voteKick.GetVoteAnswer(&command.nParam[0], &command.nParam[1]);
+	return true;
+}
+
+bool WheatRoom::HandlePong(const CommandContext & context, WheatCommand & command)
+{
+	// յϢ˵ӻţҪģҲת
+	return false;
+}
+
+bool WheatRoom::HandleTime(const CommandContext & context, WheatCommand & command)
+{
+	// ʱͻ˷Լʱ䣬ԭȥ油Ϸʱ䣬ͻʱһ߲˶
+	command.nParam[1] = GetServerMs();
+	SendCommand(context.sock, context.whoSleeperId, command);
+	return false;
+}
+
+#pragma endregion
+
+void WheatRoom::CloseClient(SOCKET sock)
+{
+	if(m_pTransport->Disconnect(sock) == false) {
+		return;
+	}
+
+	// ˭Ҳø
+	if(RemoveSpectator(sock)) {
+		return;
+	}
+
+	int leaveSleeperId = m_bedManager.FindSleeperId(sock);
+
+	if(leaveSleeperId < 0 || leaveSleeperId >= m_bedManager.m_sleepers.size()) {
+		printf("%d I Don't Know Who Left! SKIP!\n", leaveSleeperId);
+	} else {
+		// עٹ㲥뿪˯ѾղϢ
+		m_bedManager.CancelSleeper(leaveSleeperId);
+		m_chatHistory.Forget(leaveSleeperId);
+		m_metrics.m_connectionStats.leaves++;
+		SendCommandToAll(leaveSleeperId, WheatCommand(WheatCommandType::leave, "", leaveSleeperId, 0));
+
+		// ͶƱ˯ԼˣͶƱʹգ ˯id ָһλ˯Ժ˼
+		if(m_voteKick.IsVoting() && m_voteKick.m_voteKickSleeperId == leaveSleeperId) {
+			m_voteKick.SetIsVoting(false);
+			SendCommandToAll(leaveSleeperId, WheatCommand(WheatCommandType::kickover, "", 0, 0));
+			printf("Vote Over, %d Left.\n", leaveSleeperId);
+		}
+	}
+}
+
+void WheatRoom::Tick()
+{
+	m_tickNum++;
+
+	CheckVoteKick();
+	FlushSpectators();
+	UpdateCrowd();
+}
+
+void WheatRoom::SetCrowd(int threshold, int radius, int cellSize, long long intervalMs)
+{
+	// ӴСˣԭĸӶԲ
+	if(cellSize != m_crowdCellSize) {
+		m_crowdCells.clear();
+		m_crowdCellNum = 0;
+	}
+
+	m_crowdThreshold = threshold;
+	m_crowdRadius = radius;
+	m_crowdCellSize = cellSize;
+	m_crowdIntervalMs = intervalMs;
+}
+
+void WheatRoom::SendNotice(const char * text, size_t len)
+{
+	WheatCommand command;
+	command.type = WheatCommandType::notice;
+	command.SetText(text, len, & m_arena);
+
+	// ֪ͨλ˯ͷģͷ ˯id д -1
+	SendCommandToAll(-1, command);
+}
+
+int WheatRoom::GetSleeperNum()
+{
+	int sleeperNum = 0;
+	for(Sleeper & sleeper : m_bedManager.m_sleepers) {
+		if(sleeper.empty == false) {
+			sleeperNum++;
+		}
+	}
+	return sleeperNum;
+}
+
+void WheatRoom::SetRemoteSleeperNum(const std::string & nodeName, int sleeperNum)
+{
+	m_remoteSleepers[nodeName] = std::make_pair(sleeperNum, m_pClock->NowMs());
+}
+
+int WheatRoom::GetRemoteSleeperNum()
+{
+	long long nowMs = m_pClock->NowMs();
+	int sleeperNum = 0;
+	for(auto it = m_remoteSleepers.begin(); it != m_remoteSleepers.end(); ) {
+		if(nowMs - it->second.second > WHEATROOM_REMOTE_TIMEOUT_MS) {
+			it = m_remoteSleepers.erase(it);
+		} else {
+			sleeperNum += it->second.first;
+			++it;
+		}
+	}
+	return sleeperNum;
+}
+
+void WheatRoom::EndLoopIteration()
+{
+	m_metrics.RecordLoopIteration(m_arena.GetUsedBytes(), m_arena.GetCapacity(), m_arena.GetChunkNum());
+	m_arena.Reset();
+
+	// Ա֮ǰѾһȦŶӵϢȥˣһȦ׷ٵϢ͵һλ˯
+	m_tracer.EndLoopIteration(m_metrics);
+}
+
+void WheatRoom::CheckVoteKick()
+{
+	if(m_voteKick.IsVoting() == false) {
+		return;
+	}
+
+	// printf("VotingTime %d\n", m_voteKick.GetPastTime());
+	// жͶƱʱǷѾ
+	if(m_voteKick.GetPastTime() >= m_voteSeconds) {
+		int voteAgreeTemp, voteRefuseTemp;
+		m_voteKick.GetVoteAnswer(&voteAgreeTemp, &voteRefuseTemp);
+
+		// ȽͶƱ˵ʱ CloseClient() Ͳٵ "ͶƱ˯" ٽһ
+		int kickSleeperId = m_voteKick.m_voteKickSleeperId;
+		m_voteKick.SetIsVoting(false);
+
+		// ͬǷ񵱵ͶƱ˯ͻڷ
+		bool present = kickSleeperId >= 0 && kickSleeperId < static_cast<int>(m_bedManager.m_sleepers.size()) && m_bedManager.m_sleepers[kickSleeperId].empty == false;
+		if(present && voteAgreeTemp >= voteRefuseTemp * 2 && voteAgreeTemp + voteRefuseTemp > 1) {
+			SOCKET kickSocket = m_bedManager.m_sleepers[kickSleeperId].sock;
+
+			// ͶϿ˯͵
+			CloseClient(kickSocket);
+
+			printf("Kicked %zd.\n", kickSocket);
+		}
+
+		SendCommandToAll(kickSleeperId, WheatCommand(WheatCommandType::kickover, "", 0, 0));
+
+		printf("Vote Over.\n");
+	}
+}
+
+void WheatRoom::SendCommand(SOCKET destSocket, int sleeperIdWhoMakeThisCommand, const WheatCommand & command)
+{
+	size_t frameLen = 0;
+	char * frame = MakeFrame(sleeperIdWhoMakeThisCommand, command, & frameLen);
+
+	m_pTransport->Send(destSocket, frame, frameLen);
+
+	if(m_sendLog) {
+		printf("%s %s, Socket = %zd\n", frame, frame + 2, destSocket);
+	}
+}
+
+void WheatRoom::SendCommandToAll(int sleeperIdWhoMakeThisCommand, const WheatCommand & command, SOCKET skipSocket)
+{
+	// ֻһΣյͬһڴ
+	size_t frameLen = 0;
+	char * frame = MakeFrame(sleeperIdWhoMakeThisCommand, command, & frameLen);
+
+	SendBufferToAll(frame, frameLen, skipSocket);
+
+	if(command.type == WheatCommandType::chat || command.type == WheatCommandType::notice) {
+		m_chatHistory.Push(sleeperIdWhoMakeThisCommand, frame, frameLen);
+	}
+
+	if(m_spectators.empty() == false) {
+		RecordForSpectators(sleeperIdWhoMakeThisCommand, command, frame, frameLen);
+	}
+}
+
+void WheatRoom::SendMultiCommand(SOCKET destSocket, const int * sleeperIdWhoMakeTheseCommands, const WheatCommand * commands, size_t commandNum)
+{
+	if(commandNum == 0) {
+		return;
+	}
+
+	size_t bufSendSize = 0;
+	char * bufSend = MakeMultiFrame(sleeperIdWhoMakeTheseCommands, commands, commandNum, & bufSendSize);
+
+	m_pTransport->Send(destSocket, bufSend, bufSendSize);
+}
+
+char * WheatRoom::MakeMultiFrame(const int * sleeperIdWhoMakeTheseCommands, const WheatCommand * commands, size_t commandNum, size_t * pBufLen, size_t extraSize)
+{
+	// ֡೤һҪһ֡һֱ֡дȥ
+	size_t bufMaxSize = 0;
+	for(size_t i = 0; i < commandNum; i++) {
+		bufMaxSize += m_pCommandProgrammer->GetFrameMaxSize(commands[i]);
+	}
+
+	char * buf = static_cast<char *>(m_arena.Allocate(bufMaxSize + extraSize, 1));
+	size_t bufLen = 0;
+	for(size_t i = 0; i < commandNum; i++) {
+		bufLen += m_pCommandProgrammer->WriteFrame(buf + bufLen, sleeperIdWhoMakeTheseCommands[i], commands[i]);
+	}
+
+	*pBufLen = bufLen;
+	return buf;
+}
+
+void WheatRoom::MakeSnapshot(int skipSleeperId, int ** pSleeperIds, WheatCommand ** pCommands, size_t * pCommandNum)
+{
+	// ˯͵ҲʱֿһҪ
+	size_t maxCommandNum = m_bedManager.m_sleepers.size() * WHEATCOMMAND_SLEEPER_DATA_MAX;
+	int * sleeperIds = static_cast<int *>(m_arena.Allocate(sizeof(int) * maxCommandNum, alignof(int)));
+	WheatCommand * commands = static_cast<WheatCommand *>(m_arena.Allocate(sizeof(WheatCommand) * maxCommandNum, alignof(WheatCommand)));
+	size_t commandNum = 0;
+	for(int iSleeperId = 0; iSleeperId < m_bedManager.m_sleepers.size(); iSleeperId++) {
+		if(m_bedManager.m_sleepers[iSleeperId].empty == false && iSleeperId != skipSleeperId) {
+			m_pCommandProgrammer->ArrayPushBackOriginalSleepersData(sleeperIds, commands, & commandNum, m_bedManager, iSleeperId, & m_arena);
+		}
+	}
+
+	*pSleeperIds = sleeperIds;
+	*pCommands = commands;
+	*pCommandNum = commandNum;
+}
+
+void WheatRoom::RecordForSpectators(int sleeperIdWhoMakeThisCommand, const WheatCommand & command, const char * frame, size_t frameLen)
+{
+	int sleeperId = sleeperIdWhoMakeThisCommand;
+
+	switch(command.type) {
+		case WheatCommandType::move:
+		case WheatCommandType::pos:
+			if(sleeperId < 0) {
+				return;
+			}
+			if(static_cast<size_t>(sleeperId) >= m_spectatorMoved.size()) {
+				m_spectatorMoved.resize(m_bedManager.m_sleepers.size() > static_cast<size_t>(sleeperId) ? m_bedManager.m_sleepers.size() : sleeperId + 1, 0);
+			}
+			m_spectatorMoved[sleeperId] |= command.type == WheatCommandType::move ? WHEATROOM_SPECTATOR_MOVE : WHEATROOM_SPECTATOR_POS;
+			return;
+
+		case WheatCommandType::kick:
+		case WheatCommandType::agree:
+		case WheatCommandType::refuse:
+		case WheatCommandType::kickover:
+			return;
+
+		case WheatCommandType::sleep:
+		case WheatCommandType::leave:
+			// ˯ˡ뿪ˣ֮ǰߵǼͲٷˣȻϢ
+			if(sleeperId >= 0 && static_cast<size_t>(sleeperId) < m_spectatorMoved.size()) {
+				m_spectatorMoved[sleeperId] = 0;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	m_spectatorEvents.append(frame, frameLen);
+}
+
+void WheatRoom::FlushSpectators()
+{
+	long long nowMs = m_pClock->NowMs();
+	if(nowMs < m_nextSpectatorMs) {
+		return;
+	}
+	m_nextSpectatorMs = nowMs + m_spectatorIntervalMs;
+
+	// ¼϶˯µ꣬Ϲյͬһڴ
+	if(m_spectators.empty() == false) {
+		size_t bufMaxSize = m_spectatorEvents.size();
+		for(size_t i = 0; i < m_spectatorMoved.size(); i++) {
+			if(m_spectatorMoved[i] != 0) {
+				bufMaxSize += 2 * m_pCommandProgrammer->GetFrameMaxSize(WheatCommand(WheatCommandType::move, "", 0, 0));
+			}
+		}
+
+		if(bufMaxSize > 0) {
+			// ǰһĵδͷʱ
+			WheatCommand tick = MakeTickCommand();
+			bufMaxSize += m_pCommandProgrammer->GetFrameMaxSize(tick);
+			char * buf = static_cast<char *>(m_arena.Allocate(bufMaxSize, 1));
+			size_t bufLen = m_pCommandProgrammer->WriteFrame(buf, -1, tick);
+			memcpy(buf + bufLen, m_spectatorEvents.data(), m_spectatorEvents.size());
+			bufLen += m_spectatorEvents.size();
+
+			for(size_t i = 0; i < m_spectatorMoved.size() && i < m_bedManager.m_sleepers.size(); i++) {
+				Sleeper & sleeper = m_bedManager.m_sleepers[i];
+				if(m_spectatorMoved[i] == 0 || sleeper.empty) {
+					continue;
+				}
+				if(m_spectatorMoved[i] & WHEATROOM_SPECTATOR_POS) {
+					bufLen += m_pCommandProgrammer->WriteFrame(buf + bufLen, static_cast<int>(i), WheatCommand(WheatCommandType::pos, "", sleeper.posLastData.x, sleeper.posLastData.y));
+				}
+				if(m_spectatorMoved[i] & WHEATROOM_SPECTATOR_MOVE) {
+					bufLen += m_pCommandProgrammer->WriteFrame(buf + bufLen, static_cast<int>(i), WheatCommand(WheatCommandType::move, "", sleeper.moveLastData.x, sleeper.moveLastData.y));
+				}
+			}
+
+			for(SOCKET sock : m_spectators) {
+				m_pTransport->Send(sock, buf, bufLen);
+			}
+		}
+	}
+	m_spectatorEvents.clear();
+	std::fill(m_spectatorMoved.begin(), m_spectatorMoved.end(), 0);
+
+	// ¹ֻҪһڵĿգǰһ yourid$-1 Լǹڣͬһ¹ڹһ
+	if(m_newSpectators.empty() == false) {
+		int * sleeperIds = nullptr;
+		WheatCommand * commands = nullptr;
+		size_t commandNum = 0;
+		MakeSnapshot(-1, & sleeperIds, & commands, & commandNum);
+
+		int headIds[2] = { -1, -1 };
+		WheatCommand headCommands[2] = { WheatCommand(WheatCommandType::yourid, "", -1, 0), MakeTickCommand() };
+		size_t headLen = 0;
+		char * head = MakeMultiFrame(headIds, headCommands, 2, & headLen);
+		size_t snapshotLen = 0;
+		char * snapshot = commandNum > 0 ? MakeMultiFrame(sleeperIds, commands, commandNum, & snapshotLen) : nullptr;
+
+		// 
+		char * buf = static_cast<char *>(m_arena.Allocate(headLen + snapshotLen + m_chatHistory.GetByteNum(), 1));
+		memcpy(buf, head, headLen);
+		if(snapshotLen > 0) {
+			memcpy(buf + headLen, snapshot, snapshotLen);
+		}
+		size_t bufLen = headLen + snapshotLen + m_chatHistory.CopyTo(buf + headLen + snapshotLen);
+
+		for(SOCKET sock : m_newSpectators) {
+			m_pTransport->Send(sock, buf, bufLen);
+			m_spectators.push_back(sock);
+		}
+		m_newSpectators.clear();
+	}
+}
+
+bool WheatRoom::RemoveSpectator(SOCKET sock)
+{
+	for(std::vector<SOCKET> * pSpectators : { & m_spectators, & m_newSpectators }) {
+		auto it = std::find(pSpectators->begin(), pSpectators->end(), sock);
+		if(it != pSpectators->end()) {
+			*it = pSpectators->back();
+			pSpectators->pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WheatRoom::SendCommandToNearby(int sleeperIdWhoMakeThisCommand, const WheatCommand & command, int radius)
+{
+	Sleeper & who = m_bedManager.m_sleepers[sleeperIdWhoMakeThisCommand];
+
+	size_t frameLen = 0;
+	char * frame = MakeFrame(sleeperIdWhoMakeThisCommand, command, & frameLen);
+
+	// ͻ˿ת move ŻԼһҪյ
+	m_pTransport->Send(who.sock, frame, frameLen);
+	int sentNum = 1;
+
+	// ָ˯ڵ꣬ move Ŀĵز뾶
+	Vec2<int> from = who.posLastData;
+	Vec2<int> to = command.type == WheatCommandType::move ? Vec2<int>(command.nParam[0], command.nParam[1]) : from;
+	long long radiusSquared = static_cast<long long>(radius) * radius;
+
+	auto visitCell = [&](const std::vector<int> & sleeperIds) {
+		for(int sleeperId : sleeperIds) {
+			Sleeper & sleeper = m_bedManager.m_sleepers[sleeperId];
+			if(sleeper.empty || sleeperId == sleeperIdWhoMakeThisCommand) {
+				continue;
+			}
+			long long dx0 = sleeper.posLastData.x - from.x, dy0 = sleeper.posLastData.y - from.y;
+			long long dx1 = sleeper.posLastData.x - to.x, dy1 = sleeper.posLastData.y - to.y;
+			if(dx0 * dx0 + dy0 * dy0 <= radiusSquared || dx1 * dx1 + dy1 * dy1 <= radiusSquared) {
+				m_pTransport->Send(sleeper.sock, frame, frameLen);
+				sentNum++;
+			}
+		}
+	};
+
+	// ֻԲסĸӣߵ̫Զĸӱ˵ĸӻʱɴ˵ĸӶһ
+	int cellX0 = GetCrowdCellIndex(MIN(from.x, to.x) - radius);
+	int cellX1 = GetCrowdCellIndex(MAX(from.x, to.x) + radius);
+	int cellY0 = GetCrowdCellIndex(MIN(from.y, to.y) - radius);
+	int cellY1 = GetCrowdCellIndex(MAX(from.y, to.y) + radius);
+	long long boxCellNum = static_cast<long long>(cellX1 - cellX0 + 1) * (cellY1 - cellY0 + 1);
+
+	if(boxCellNum > static_cast<long long>(m_crowdCells.size())) {
+		for(auto & cell : m_crowdCells) {
+			visitCell(cell.second);
+		}
+	} else {
+		for(int cellX = cellX0; cellX <= cellX1; cellX++) {
+			for(int cellY = cellY0; cellY <= cellY1; cellY++) {
+				auto it = m_crowdCells.find(GetCrowdCellKey(cellX, cellY));
+				if(it != m_crowdCells.end()) {
+					visitCell(it->second);
+				}
+			}
+		}
+	}
+
+	if(m_crowdSleeperNum > sentNum) {
+		m_crowdSkippedSends += m_crowdSleeperNum - sentNum;
+	}
+
+	if(m_spectators.empty() == false) {
+		RecordForSpectators(sleeperIdWhoMakeThisCommand, command, frame, frameLen);
+	}
+}
+
+void WheatRoom::UpdateCrowd()
+{
+	long long nowMs = m_pClock->NowMs();
+	bool summaryDue = nowMs >= m_nextCrowdMs;
+
+	if(summaryDue) {
+		m_nextCrowdMs = nowMs + m_crowdIntervalMs;
+
+		// żľų²˳żл
+		m_crowdSleeperNum = GetSleeperNum();
+		bool crowded = m_crowdThreshold > 0 && (m_crowdForced || (m_crowded ? m_crowdSleeperNum * 10 >= m_crowdThreshold * 9 : m_crowdSleeperNum >= m_crowdThreshold));
+		if(crowded != m_crowded) {
+			printf("Crowd Mode %s, %d Sleepers.\n", crowded ? "On" : "Off", m_crowdSleeperNum);
+			m_crowded = crowded;
+		}
+	}
+
+	if(m_crowded == false && m_chatRadius == 0) {
+		return;
+	}
+
+	// ʱڱ䣬ÿεδ·һӣֻǰ ˯id ŽȥǧҲ˶ʱ
+	for(auto & cell : m_crowdCells) {
+		cell.second.clear();
+	}
+	m_crowdCellNum = 0;
+	for(int iSleeperId = 0; iSleeperId < m_bedManager.m_sleepers.size(); iSleeperId++) {
+		Sleeper & sleeper = m_bedManager.m_sleepers[iSleeperId];
+		if(sleeper.empty) {
+			continue;
+		}
+		std::vector<int> & cell = m_crowdCells[GetCrowdCellKey(GetCrowdCellIndex(sleeper.posLastData.x), GetCrowdCellIndex(sleeper.posLastData.y))];
+		if(cell.empty()) {
+			m_crowdCellNum++;
+		}
+		cell.push_back(iSleeperId);
+	}
+
+	// ſ˯Ͷһֻһ
+	if(m_crowded && summaryDue) {
+		size_t bufLen = 0;
+		char * buf = MakeCrowdSummary(& bufLen);
+		SendBufferToAll(buf, bufLen);
+	}
+}
+
+char * WheatRoom::MakeCrowdSummary(size_t * pBufLen)
+{
+	// crowd$x,y,;x,y,;...  ˯ŵ˯ڴϣ beds$ ʾڸ
+	// һд "-2147483648,-2147483648,2147483647;" 36 ֽڣֲ 0xFFFFдµĸӾͲд
+	size_t textMaxLen = MIN(m_crowdCellNum * 36, static_cast<size_t>(0xFFFF));
+	char * text = static_cast<char *>(m_arena.Allocate(textMaxLen + 1, 1));
+	size_t textLen = 0;
+	for(auto & cell : m_crowdCells) {
+		long long sumX = 0, sumY = 0;
+		int awakeNum = 0;
+		for(int sleeperId : cell.second) {
+			Sleeper & sleeper = m_bedManager.m_sleepers[sleeperId];
+			if(sleeper.sleepingBedId == -1) {
+				sumX += sleeper.posLastData.x;
+				sumY += sleeper.posLastData.y;
+				awakeNum++;
+			}
+		}
+		if(awakeNum == 0) {
+			continue;
+		}
+		if(textLen + 36 > textMaxLen) {
+			break;
+		}
+		textLen += snprintf(text + textLen, textMaxLen + 1 - textLen, "%s%lld,%lld,%d", textLen > 0 ? ";" : "", sumX / awakeNum, sumY / awakeNum, awakeNum);
+	}
+
+	// beds$  BED_NUM / 4 ʮַ i ַĵ k λλΪ 0 λʾ λid Ϊ 4i+k Ĵû
+	char bits[BED_NUM / 4];
+	for(int i = 0; i < BED_NUM / 4; i++) {
+		int nibble = 0;
+		for(int k = 0; k < 4; k++) {
+			if(m_bedManager.GetBed(i * 4 + k)->Empty() == false) {
+				nibble |= 1 << k;
+			}
+		}
+		bits[i] = "0123456789abcdef"[nibble];
+	}
+
+	// ſλ˯ͷģͷ ˯id д -1ǰһĵδͷʱ
+	int sleeperIds[3] = { -1, -1, -1 };
+	WheatCommand commands[3];
+	commands[0] = MakeTickCommand();
+	commands[1].type = WheatCommandType::crowd;
+	commands[1].SetText(text, textLen, & m_arena);
+	commands[2].type = WheatCommandType::beds;
+	commands[2].SetText(bits, sizeof(bits), & m_arena);
+
+	return MakeMultiFrame(sleeperIds, commands, 3, pBufLen);
+}
+
+char * WheatRoom::MakeFrame(int sleeperIdWhoMakeThisCommand, const WheatCommand & command, size_t * pFrameLen)
+{
+	char * frame = static_cast<char *>(m_arena.Allocate(m_pCommandProgrammer->GetFrameMaxSize(command), 1));
+	*pFrameLen = m_pCommandProgrammer->WriteFrame(frame, sleeperIdWhoMakeThisCommand, command);
+	m_tracer.MarkEncoded();
+	return frame;
+}
+
+void WheatRoom::SendBufferToAll(const char * str, size_t len, SOCKET skipSocket)
+{
+	for(int i = 0; i < m_bedManager.m_sleepers.size(); i++) {
+		Sleeper & sleeper = m_bedManager.m_sleepers[i];
+		if(sleeper.empty || sleeper.sock == skipSocket) {
+			continue;
+		}
+		m_pTransport->Send(sleeper.sock, str, len);
+	}
+}
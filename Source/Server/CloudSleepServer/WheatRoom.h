@@ -0,0 +1,283 @@
+#pragma once
+
+#include "WheatCommand.h"
+#include "WheatBedManager.h"
+#include "WheatVote.h"
+#include "WheatChatRecorder.h"
+#include "WheatChatHistory.h"
+#include "WheatTransport.h"
+#include "WheatClock.h"
+#include "WheatMetrics.h"
+#include "WheatTracer.h"
+#include "WheatSession.h"
+#include "WheatArena.h"
+
+#include <vector>
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <functional>
+
+// ûյĳӵϢͷһ(ping$)λ 
+#define WHEATROOM_HEARTBEAT_MS 15000
+
+// ûյĳӵκϢΪԷѾߣϿӣλ 
+// ͻڷÿ 5 ͬһ꣬ټ϶ĻӦ(pong$)ӲôûϢ
+#define WHEATROOM_IDLE_TIMEOUT_MS 45000
+
+// ͶƱ˳ãλ 
+#define WHEATROOM_VOTE_SECONDS 10
+
+// ĽڵûͲ˯ͣλ 
+#define WHEATROOM_REMOTE_TIMEOUT_MS 5000
+
+// ڶһηı仯λ 
+#define WHEATROOM_SPECTATOR_INTERVAL_MS 250
+
+// ˯ʹﵽʱȺģʽ0 ʾȺģʽ
+// ڵĿͻ˻ʶ crowd$  beds$ȺģʽԶ˯ͻͣԭءλҲٸ£Ĭϲãȿͻ˸ٴ
+#define WHEATROOM_CROWD_THRESHOLD 0
+// Ⱥģʽ£ö˯ͲŻյ˴˵ move  posλ 
+#define WHEATROOM_CROWD_RADIUS 800
+// Ⱥģʽ»ֵͼĸӱ߳λ 
+#define WHEATROOM_CROWD_CELL_SIZE 400
+// Ⱥģʽ¶÷һȺſ(crowd$beds$)λ 
+#define WHEATROOM_CROWD_INTERVAL_MS 1000
+
+// ܼң𷿼һ񣺵Ǽ˯͡˯ǵָϢת˯֯͡ͶƱ
+//  socketҪŵʱͽԱ(WheatTransport)ʵ绹ڴػһܸɻ
+class WheatRoom {
+public:
+	WheatRoom(WheatTransport * pTransport, WheatClock * pClock = GetSystemClock()) { m_pTransport = pTransport; m_pClock = pClock; m_voteKick.SetClock(pClock); m_startMs = pClock->NowMs(); }
+
+	// һӴӽŵ뿪ọ̈̄Ǽ˯ͣһһشϢ̫ûϢͷûϢ͵ߣӶϿͿ
+	// ɻỰԱ(WheatSessionScheduler)Ϊÿһ
+	WheatSessionTask RunSession(WheatSession & session);
+
+	// µӽ뷿䣬ΪǼ˯Ͳͷ
+	// Ϊע ˯id
+	int OnJoin(SOCKET sock, const char * ipAddress);
+
+	// ڵӴӽŵ뿪ọ̈̄Ǽ˯ͣ˯ͿڣڷϢһɲֻжӻţ
+	// ڲÿ¼յϢÿһʱյһʱı仯ͬһ˯˺üֻ
+	WheatSessionTask RunSpectatorSession(WheatSession & session);
+
+	// µĹڽյȵһηڵʱһ𷢣ͬһĹڹһ
+	void OnSpectatorJoin(SOCKET sock);
+
+	// յĳһӵһϢbuf  '\0' βlen β '\0'
+	// opcodeLen Ϊָĳȣһ '$' λã֡ԱѾҺ˵ĻֱӴʡһ
+	// recvNs Ϊ socket յϢʱ䣨ʵӣ׷ӳٵʱã֪ʹ 0
+	void OnMessage(SOCKET sock, const char * buf, size_t len);
+	void OnMessage(SOCKET sock, const char * buf, size_t len, size_t opcodeLen, long long recvNs = 0);
+
+	// Ͽĳһӣ˯뿪
+	// ѾϿԱʶˣĻʲô
+	void CloseClient(SOCKET sock);
+
+	// ʱӵδɴԱڵãĬÿ 10 һΣкʱйص
+	// ģʱⱨʱԱһӵһΣܰѼСʱĻѹ
+	void Tick();
+
+	// ͶƱǷѾ˾ͽ
+	void CheckVoteKick();
+
+	// ¼ѭÿתһȦһΣһһȦʱݣĳ֡õϢյȣ
+	// ͬһȦﴦϢһʱֿ⣬ȶʱϢȫֶҪڴ
+	void EndLoopIteration();
+
+	inline WheatClock * GetClock() { return m_pClock; }
+
+	// δ˶ٴΣԼ俪Ժ˶ٺ루ÿ 24 һһΣд tick$  time$ ﷢ͻ
+	inline int GetTickNum() { return static_cast<int>(m_tickNum & 0x7FFFFFFF); }
+	inline int GetServerMs() { return static_cast<int>((m_pClock->NowMs() - m_startMs) & 0x7FFFFFFF); }
+
+	// ͿгʱԺÿӵͷһͰµ
+	inline void SetHeartbeat(long long heartbeatMs, long long idleTimeoutMs) { m_heartbeatMs = heartbeatMs; m_idleTimeoutMs = idleTimeoutMs; }
+	// ͶƱ˳ãڽеͶƱҲµʱ
+	inline void SetVoteSeconds(int voteSeconds) { m_voteSeconds = voteSeconds; }
+	// ڶһηı仯
+	inline void SetSpectatorInterval(long long intervalMs) { m_spectatorIntervalMs = intervalMs; }
+
+	// Ⱥģʽ˯ʹﵽ threshold ˣ0 ʾãԺmove  pos ֻ radius ڵ˯ͣԶ˯ÿ intervalMs յһΰ cellSize صĸӻܵĸſ
+	void SetCrowd(int threshold, int radius, int cellSize, long long intervalMs);
+	// forced Ϊ true ʱٶȺģʽæʱķȺģʽû򿪣threshold Ϊ 0ʱ
+	inline void SetCrowdForced(bool forced) { m_crowdForced = forced; }
+	inline bool IsCrowded() { return m_crowded; }
+	// ˵ĸԼȺģʽٷ˶Ϣ
+	inline size_t GetCrowdCellNum() { return m_crowdCellNum; }
+	inline unsigned long long GetCrowdSkippedSends() { return m_crowdSkippedSends; }
+	// ֻ radius ڵ˯ͣ0 ʾ˯ֻͣڸ˵ĻҲתĽڵ
+	inline void SetChatRadius(int radius) { m_chatRadius = radius; }
+
+	// 첾Ƕ죬0 ʾ
+	inline void SetChatHistorySize(size_t frameNum) { m_chatHistory.SetCapacity(frameNum); }
+	inline WheatChatHistory & GetChatHistory() { return m_chatHistory; }
+	// Ƿ͸ǽ records.txt
+	inline void SetChatRecording(bool recording) { m_chatRecorder.SetEnabled(recording); }
+
+	// һȦʱֿ⣬Ķ EndLoopIteration() ֮ǰһֱЧ
+	inline WheatArena & GetArena() { return m_arena; }
+
+	// ˯ͷһ֪ͨ(notice$)Ľڵϵ졢ȫ
+	void SendNotice(const char * text, size_t len);
+
+	// ж˯
+	int GetSleeperNum();
+	// жٹڣڵȿյ
+	inline size_t GetSpectatorNum() { return m_spectators.size() + m_newSpectators.size(); }
+
+	// ͬһ俪ڱĽڵϵĲָж˯ͣϢϵϢ
+	void SetRemoteSleeperNum(const std::string & nodeName, int sleeperNum);
+	// Ľڵһж˯̫ͣûĽڵ㲻㣨˳ǣ
+	int GetRemoteSleeperNum();
+	inline const std::map<std::string, std::pair<int, long long>> & GetRemoteSleepers() { return m_remoteSleepers; }
+
+	// ˯ʱ֪ͨ棨췢ϢϣתĽڵ㣩ûþͲ֪ͨ
+	std::function<void(const Sleeper & who, std::string_view text)> m_onChat;
+
+	WheatMetrics m_metrics;
+
+	// ÿϢһ׷ٴյͳŵĺʱǽ m_metrics
+	WheatTracer m_tracer;
+
+	// ǷյÿϢӡԱʱ򿪡
+	bool m_trace = false;
+
+	// ǷӡӵÿһϢæʱԱ TCPԱ ص
+	bool m_sendLog = true;
+
+	WheatBedManager m_bedManager;
+
+	WheatVote m_voteKick;
+
+private:
+
+	// Ҫ֪ģָϢ
+	struct CommandContext {
+		SOCKET sock;
+		int whoSleeperId;
+		const char * buf;
+	};
+
+	// ָˣ true ʾҪѣܱ޸Ĺģָת˯
+	using CommandHandler = bool (WheatRoom::*)(const CommandContext & context, WheatCommand & command);
+
+	//  WheatCommandType Ϊ±Ĵᣬھźˣָòұ
+	static constexpr std::array<CommandHandler, static_cast<int>(WheatCommandType::count)> MakeCommandHandlers();
+	static const std::array<CommandHandler, static_cast<int>(WheatCommandType::count)> s_commandHandlers;
+
+	bool HandleUnknown(const CommandContext & context, WheatCommand & command);
+	bool HandleRefused(const CommandContext & context, WheatCommand & command);
+
+	bool HandleName(const CommandContext & context, WheatCommand & command);
+	bool HandleType(const CommandContext & context, WheatCommand & command);
+
+	bool HandleSleep(const CommandContext & context, WheatCommand & command);
+	bool HandleGetup(const CommandContext & context, WheatCommand & command);
+
+	bool HandleChat(const CommandContext & context, WheatCommand & command);
+	bool HandleWhisper(const CommandContext & context, WheatCommand & command);
+
+	bool HandleMove(const CommandContext & context, WheatCommand & command);
+	bool HandlePos(const CommandContext & context, WheatCommand & command);
+
+	bool HandleKick(const CommandContext & context, WheatCommand & command);
+	bool HandleAgree(const CommandContext & context, WheatCommand & command);
+	bool HandleRefuse(const CommandContext & context, WheatCommand & command);
+
+	bool HandlePong(const CommandContext & context, WheatCommand & command);
+	bool HandleTime(const CommandContext & context, WheatCommand & command);
+
+	// ָ
+	// destSocket				Ŀͻ˵ Socket
+	// sleeperIdWhoMakeThisCommand	дָ˯͵ ˯Id
+	void SendCommand(SOCKET destSocket, int sleeperIdWhoMakeThisCommand, const WheatCommand & command);
+
+	// ָ˯ͣskipSocket յ
+	void SendCommandToAll(int sleeperIdWhoMakeThisCommand, const WheatCommand & command, SOCKET skipSocket = INVALID_SOCKET);
+
+	// ָϰһη
+	void SendMultiCommand(SOCKET destSocket, const int * sleeperIdWhoMakeTheseCommands, const WheatCommand * commands, size_t commandNum);
+
+	// һ tick$δ,ʱ䣬ڳ͵ǰ棬ͻ˿ֵ֮
+	inline WheatCommand MakeTickCommand() { return WheatCommand(WheatCommandType::tick, "", GetTickNum(), GetServerMs()); }
+
+	// ʱֿһ֡ "˯id\0Ϣ\0"*pFrameLen Ϊֽ֡
+	char * MakeFrame(int sleeperIdWhoMakeThisCommand, const WheatCommand & command, size_t * pFrameLen);
+	// ʱֿѶָһ֡һ֡дһ*pBufLen Ϊֽٶ extraSize ֽڸ߽д
+	char * MakeMultiFrame(const int * sleeperIdWhoMakeTheseCommands, const WheatCommand * commands, size_t commandNum, size_t * pBufLen, size_t extraSize = 0);
+	// ʱֿɷ˯͵ȫݣ skipSleeperId*pCommandNum Ϊָ
+	void MakeSnapshot(int skipSleeperId, int ** pSleeperIds, WheatCommand ** pCommands, size_t * pCommandNum);
+
+	// ˯͵ָҲһݸڣֻ˭¼ԭţͶƱ͹޹أ
+	void RecordForSpectators(int sleeperIdWhoMakeThisCommand, const WheatCommand & command, const char * frame, size_t frameLen);
+	// ˾Ͱı仯Ϲڣѿշ¹
+	void FlushSpectators();
+	// ǹڵĻӹȥ true
+	bool RemoveSpectator(SOCKET sock);
+
+	void SendBufferToAll(const char * str, size_t len, SOCKET skipSocket = INVALID_SOCKET);
+
+	// ָֻ radius ڵ˯ָͣ˯Լһյõһ
+	// Ⱥģʽµ movepos ͸춼
+	void SendCommandToNearby(int sleeperIdWhoMakeThisCommand, const WheatCommand & command, int radius);
+	// Ⱥģʽ߸ʱÿεδ˯͵·ָӣжҪҪȺģʽȺģʽ¸˯ͷһθſ
+	void UpdateCrowd();
+	// ʱֿȺſδŵĸӣƽʹλռõλͼָһ֡һ֡*pBufLen Ϊֽ
+	char * MakeCrowdSummary(size_t * pBufLen);
+	inline long long GetCrowdCellKey(int cellX, int cellY) { return (static_cast<long long>(cellX) << 32) | static_cast<unsigned int>(cellY); }
+	inline int GetCrowdCellIndex(int coord) { return coord >= 0 ? coord / m_crowdCellSize : (coord + 1) / m_crowdCellSize - 1; }
+
+	WheatTransport * m_pTransport = nullptr;
+
+	WheatClock * m_pClock = nullptr;
+
+	unsigned long long m_tickNum = 0;
+	long long m_startMs = 0;
+
+	WheatCommandProgrammer * m_pCommandProgrammer = nullptr;
+
+	WheatChatRecorder m_chatRecorder;
+
+	// 죬˯ͺ¹ڽʱſһ
+	WheatChatHistory m_chatHistory;
+
+	long long m_heartbeatMs = WHEATROOM_HEARTBEAT_MS;
+	long long m_idleTimeoutMs = WHEATROOM_IDLE_TIMEOUT_MS;
+	int m_voteSeconds = WHEATROOM_VOTE_SECONDS;
+
+	// ¼ѭһȦʱֿ⣬Ųָĳ֡õϢÿתһȦһ
+	WheatArena m_arena;
+
+	// ڵ -> (˯, һαʱ)
+	std::map<std::string, std::pair<int, long long>> m_remoteSleepers;
+
+	// ڣѾյյģ͵һտյ
+	std::vector<SOCKET> m_spectators;
+	std::vector<SOCKET> m_newSpectators;
+	long long m_spectatorIntervalMs = WHEATROOM_SPECTATOR_INTERVAL_MS;
+	long long m_nextSpectatorMs = 0;
+
+	// ϴηԺ¼һ֡һ֡ ˯id Ϊ± "û"
+	std::string m_spectatorEvents;
+	std::vector<unsigned char> m_spectatorMoved;
+
+	int m_crowdThreshold = WHEATROOM_CROWD_THRESHOLD;
+	int m_crowdRadius = WHEATROOM_CROWD_RADIUS;
+	int m_crowdCellSize = WHEATROOM_CROWD_CELL_SIZE;
+	long long m_crowdIntervalMs = WHEATROOM_CROWD_INTERVAL_MS;
+	long long m_nextCrowdMs = 0;
+	bool m_crowded = false;
+	bool m_crowdForced = false;
+	int m_crowdSleeperNum = 0;
+
+	//  ->  ˯idӿҲţ vector ֻղͷţδ֮䲻ȫֶҪڴ
+	std::unordered_map<long long, std::vector<int>> m_crowdCells;
+	size_t m_crowdCellNum = 0;
+	unsigned long long m_crowdSkippedSends = 0;
+
+	int m_chatRadius = 0;
+};
@@ -0,0 +1,368 @@
+#include "WheatSession.h"
+#include "ProjectCommon.h"
+
+#include <iostream>
+#include <cstring>
+#include <new>
+
+// Э֡ڴأЭ֡¼ѭ߳ﴴ٣Ҫ
+// ĿֻӸ߷Ŀ֮Ӽ
+// ӹⲻͷţ˳ʱܻЭ֡û
+static WheatSlab & GetFramePool()
+{
+	static WheatSlab * s_pFramePool = new WheatSlab(WHEATSESSION_FRAME_SIZE);
+	return *s_pFramePool;
+}
+
+void * WheatSessionTask::promise_type::operator new(size_t size)
+{
+	if(size > WHEATSESSION_FRAME_SIZE) {
+		return ::operator new(size);
+	}
+	return GetFramePool().Acquire();
+}
+
+void WheatSessionTask::promise_type::operator delete(void * p, size_t size)
+{
+	if(size > WHEATSESSION_FRAME_SIZE) {
+		::operator delete(p);
+		return;
+	}
+	GetFramePool().Release(p);
+}
+
+void WheatSessionTask::ReserveFrames(size_t frameNum, bool bLargePages)
+{
+	GetFramePool().SetLargePages(bLargePages);
+	GetFramePool().Reserve(frameNum);
+}
+
+WheatSessionTask & WheatSessionTask::operator=(WheatSessionTask && another) noexcept
+{
+	if(this != & another) {
+		if(m_handle != nullptr) {
+			m_handle.destroy();
+		}
+		m_handle = another.m_handle;
+		another.m_handle = nullptr;
+	}
+	return *this;
+}
+
+WheatSessionTask::~WheatSessionTask()
+{
+	if(m_handle != nullptr) {
+		m_handle.destroy();
+	}
+}
+
+WheatSessionMessage WheatSession::ReadAwaiter::await_resume()
+{
+	WheatSessionMessage message;
+	if(session.m_frameNext >= session.m_frameNum) {
+		// ûϢҪôӶϿˣҪôǵȵʱ
+		if(session.m_closed) {
+			message.closed = true;
+		} else {
+			message.timedOut = true;
+		}
+		return message;
+	}
+
+	// buf ҪһֱЧһ ReadMessage()ֻ HasFrame() Ų HasFrame() ֻ ReadMessage() 
+	WheatFrameSpan & frame = session.m_frames[session.m_frameNext++];
+	message.buf = session.m_recvBuffer + frame.offset;
+	message.len = frame.len;
+	message.opcodeLen = frame.opcodeLen;
+	message.recvNs = session.m_recvNs;
+	return message;
+}
+
+bool WheatSession::HasFrame()
+{
+	if(m_frameNext < m_frameNum) {
+		return true;
+	}
+
+	// ɨĲӵʣµİϢϴ m_frames ûװµϢŲͷ
+	if(m_scannedLen > 0) {
+		memmove(m_recvBuffer, m_recvBuffer + m_scannedLen, m_recvLen - m_scannedLen);
+		m_recvLen -= m_scannedLen;
+		m_scannedLen = 0;
+	}
+
+	m_frameNext = 0;
+	m_scannedLen = WheatFrameScanner::Scan(m_recvBuffer, m_recvLen, m_frames, WHEATSESSION_MAX_FRAMES, & m_frameNum);
+
+	return m_frameNum > 0;
+}
+
+WheatSessionScheduler::~WheatSessionScheduler()
+{
+	for(WheatSession * pSession : m_sessions) {
+		pSession->~WheatSession();
+	}
+}
+
+void WheatSessionScheduler::Reserve(size_t sessionNum, bool bLargePages)
+{
+	m_sessionSlab.SetLargePages(bLargePages);
+	m_bufferSlab.SetLargePages(bLargePages);
+
+	m_sessionSlab.Reserve(sessionNum);
+	m_bufferSlab.Reserve(sessionNum);
+	WheatSessionTask::ReserveFrames(sessionNum, bLargePages);
+
+	m_sessions.reserve(m_sessions.size() + sessionNum);
+	m_readyQueue.reserve(m_sessions.size() + sessionNum);
+	IndexResize(m_sessions.size() + sessionNum);
+}
+
+bool WheatSessionScheduler::SetRecvBufferSize(size_t size)
+{
+	if(m_bufferSlab.SetBlockSize(size) == false) {
+		return false;
+	}
+	m_recvBufferSize = size;
+	return true;
+}
+
+void WheatSessionScheduler::Start(SOCKET sock, const char * ipAddress)
+{
+	// Ựÿһһӵ״̬ڴǴӲֿ
+	WheatSession * pSession = new (m_sessionSlab.Acquire()) WheatSession();
+	pSession->m_recvBuffer = static_cast<char *>(m_bufferSlab.Acquire());
+
+	m_sessions.push_back(pSession);
+	m_readyQueue.reserve(m_sessions.size());
+
+	pSession->m_sock = sock;
+	IndexInsert(pSession);
+	strncpy(pSession->m_ipAddress, ipAddress, sizeof(pSession->m_ipAddress) - 1);
+	pSession->m_ipAddress[sizeof(pSession->m_ipAddress) - 1] = '\0';
+	pSession->m_pClock = m_pClock;
+	pSession->m_task = m_sessionBody(*pSession);
+
+	MakeReady(pSession);
+}
+
+char * WheatSessionScheduler::GetRecvBuffer(SOCKET sock, size_t * pFreeLen)
+{
+	if(WantsRead(sock) == false) {
+		*pFreeLen = 0;
+		return nullptr;
+	}
+
+	WheatSession * pSession = FindSession(sock);
+	*pFreeLen = m_recvBufferSize - pSession->m_recvLen;
+	return pSession->m_recvBuffer + pSession->m_recvLen;
+}
+
+void WheatSessionScheduler::CommitRecv(SOCKET sock, size_t len)
+{
+	WheatSession * pSession = FindSession(sock);
+	if(pSession == nullptr || pSession->m_closed) {
+		return;
+	}
+
+	pSession->m_recvLen += len;
+	if(m_recvStamping) {
+		pSession->m_recvNs = GetSystemClock()->NowNs();
+	}
+
+	if(pSession->HasFrame()) {
+		if(pSession->m_state == WheatSession::State::WaitRead) {
+			MakeReady(pSession);
+		}
+	} else if(pSession->m_recvLen >= m_recvBufferSize) {
+		// ˻ûһϢϢ̫ˣֻӵ
+		printf("Client %zd Message Too Long! DROP!\n", sock);
+		pSession->m_recvLen = 0;
+	}
+}
+
+bool WheatSessionScheduler::Deliver(SOCKET sock, const char * buf, size_t len)
+{
+	WheatSession * pSession = FindSession(sock);
+	if(pSession == nullptr || pSession->m_closed) {
+		return true;
+	}
+	if(len > m_recvBufferSize) {
+		printf("Client %zd Message Too Long! DROP!\n", sock);
+		return true;
+	}
+	if(m_recvBufferSize - pSession->m_recvLen < len) {
+		return false;
+	}
+
+	// ֻβ׷ӣǰݣỰﻹŵϢӰ
+	memcpy(pSession->m_recvBuffer + pSession->m_recvLen, buf, len);
+
+	// ỰڵϢɨһ飬һ ReadMessage() ʱԼɨ
+	if(pSession->m_state == WheatSession::State::WaitRead) {
+		CommitRecv(sock, len);
+	} else {
+		pSession->m_recvLen += len;
+	}
+	return true;
+}
+
+void WheatSessionScheduler::Hangup(SOCKET sock, bool socketClosed)
+{
+	WheatSession * pSession = FindSession(sock);
+	if(pSession == nullptr) {
+		return;
+	}
+	if(socketClosed) {
+		pSession->m_socketClosed = true;
+		IndexErase(pSession);
+	}
+	if(pSession->m_closed) {
+		return;
+	}
+
+	pSession->m_closed = true;
+
+	// лѾڵȴѵĻỰԼῴ m_closedٻһ
+	switch(pSession->m_state) {
+		case WheatSession::State::WaitRead:
+			MakeReady(pSession);
+			break;
+	}
+}
+
+void WheatSessionScheduler::Tick()
+{
+	long long nowMs = m_pClock->NowMs();
+	for(WheatSession * pSession : m_sessions) {
+		if(pSession->m_state == WheatSession::State::WaitRead && pSession->m_wakeMs > 0 && pSession->m_wakeMs <= nowMs) {
+			MakeReady(pSession);
+		}
+	}
+}
+
+void WheatSessionScheduler::RunReady()
+{
+	// еĻỰܻỽѱĻỰߵĳˣһһ߿ûб䳤
+	for(size_t i = 0; i < m_readyQueue.size(); i++) {
+		WheatSession * pSession = m_readyQueue[i];
+
+		pSession->m_state = WheatSession::State::Running;
+		pSession->m_task.Resume();
+
+		if(pSession->m_task.Done()) {
+			pSession->m_state = WheatSession::State::Done;
+		}
+	}
+	m_readyQueue.clear();
+
+	// ĻỰͬջһ𻹸ֿ⣬һỰϿλ
+	for(size_t i = 0; i < m_sessions.size(); ) {
+		WheatSession * pSession = m_sessions[i];
+		if(pSession->m_state != WheatSession::State::Done) {
+			i++;
+			continue;
+		}
+
+		// ѾӵĻǵ»Ựܶ
+		IndexErase(pSession);
+
+		m_bufferSlab.Release(pSession->m_recvBuffer);
+		pSession->~WheatSession();
+		m_sessionSlab.Release(pSession);
+
+		m_sessions[i] = m_sessions.back();
+		m_sessions.pop_back();
+	}
+}
+
+bool WheatSessionScheduler::WantsRead(SOCKET sock)
+{
+	WheatSession * pSession = FindSession(sock);
+	return pSession != nullptr && pSession->m_state == WheatSession::State::WaitRead && pSession->m_closed == false;
+}
+
+WheatSession * WheatSessionScheduler::FindSession(SOCKET sock)
+{
+	// socket صԺſϱµϣɻỰûҲѾ
+	if(m_indexedNum == 0) {
+		return nullptr;
+	}
+	size_t mask = m_sessionIndex.size() - 1;
+	for(size_t i = IndexHome(sock); m_sessionIndex[i] != nullptr; i = (i + 1) & mask) {
+		if(m_sessionIndex[i]->m_sock == sock) {
+			return m_sessionIndex[i];
+		}
+	}
+	return nullptr;
+}
+
+void WheatSessionScheduler::IndexInsert(WheatSession * pSession)
+{
+	if((m_indexedNum + 1) * 2 > m_sessionIndex.size()) {
+		IndexResize(m_indexedNum + 1);
+	}
+
+	size_t mask = m_sessionIndex.size() - 1;
+	size_t i = IndexHome(pSession->m_sock);
+	while(m_sessionIndex[i] != nullptr) {
+		i = (i + 1) & mask;
+	}
+	m_sessionIndex[i] = pSession;
+	m_indexedNum++;
+}
+
+void WheatSessionScheduler::IndexErase(WheatSession * pSession)
+{
+	if(m_indexedNum == 0) {
+		return;
+	}
+
+	size_t mask = m_sessionIndex.size() - 1;
+	size_t i = IndexHome(pSession->m_sock);
+	while(m_sessionIndex[i] != pSession) {
+		if(m_sessionIndex[i] == nullptr) {
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+
+	// ŵġ÷ڿλ֮ǰĻỰǰŲҵʱλͣм䲻ܶϿ
+	for(size_t j = (i + 1) & mask; m_sessionIndex[j] != nullptr; j = (j + 1) & mask) {
+		size_t home = IndexHome(m_sessionIndex[j]->m_sock);
+		bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+		if(stays == false) {
+			m_sessionIndex[i] = m_sessionIndex[j];
+			i = j;
+		}
+	}
+	m_sessionIndex[i] = nullptr;
+	m_indexedNum--;
+}
+
+void WheatSessionScheduler::IndexResize(size_t sessionNum)
+{
+	// õһĲλ̽·̶
+	size_t slotNum = 64;
+	while(slotNum < sessionNum * 2) {
+		slotNum *= 2;
+	}
+	if(slotNum <= m_sessionIndex.size()) {
+		return;
+	}
+
+	std::vector<WheatSession *> oldIndex(slotNum, nullptr);
+	oldIndex.swap(m_sessionIndex);
+	m_indexedNum = 0;
+	for(WheatSession * pSession : oldIndex) {
+		if(pSession != nullptr) {
+			IndexInsert(pSession);
+		}
+	}
+}
+
+void WheatSessionScheduler::MakeReady(WheatSession * pSession)
+{
+	pSession->m_state = WheatSession::State::Ready;
+	m_readyQueue.push_back(pSession);
+}
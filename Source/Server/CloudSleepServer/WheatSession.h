@@ -0,0 +1,230 @@
+#pragma once
+
+#include "WheatClock.h"
+#include "WheatFrameScanner.h"
+#include "WheatSlab.h"
+
+#include <winsock.h>
+#include <coroutine>
+#include <functional>
+#include <vector>
+
+// ÿӵĽջĬϴСһϢβ '\0'ܱ
+#define WHEATSESSION_RECV_BUFFER_SIZE 4096
+
+// һɨ¶Ϣı߽磬ĵЩɨ
+#define WHEATSESSION_MAX_FRAMES 64
+
+// Э֡ڴÿһĴСЭ֡ĻֻȥȫֶҪڴ
+#define WHEATSESSION_FRAME_SIZE 1024
+
+class WheatSession;
+
+// ỰһӴӽŵ뿪ȫдһ C++20 Э
+// Э֡ڴ(WheatSlab)䣬ŻسȶԺ󲻻ȫֶҪڴ
+class WheatSessionTask {
+public:
+	struct promise_type {
+		WheatSessionTask get_return_object() { return WheatSessionTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+		// ԺͣɵԱʲôʱʼ
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		// ԺҲͣɵԱ
+		std::suspend_always final_suspend() noexcept { return {}; }
+
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		static void * operator new(size_t size);
+		static void operator delete(void * p, size_t size);
+	};
+
+	// ֤ڴ frameNum еЭ֡
+	static void ReserveFrames(size_t frameNum, bool bLargePages = false);
+
+	WheatSessionTask() {}
+	explicit WheatSessionTask(std::coroutine_handle<promise_type> handle) { m_handle = handle; }
+	WheatSessionTask(WheatSessionTask && another) noexcept { m_handle = another.m_handle; another.m_handle = nullptr; }
+	WheatSessionTask & operator=(WheatSessionTask && another) noexcept;
+	WheatSessionTask(const WheatSessionTask &) = delete;
+	WheatSessionTask & operator=(const WheatSessionTask &) = delete;
+	~WheatSessionTask();
+
+	inline bool Valid() { return m_handle != nullptr; }
+	inline bool Done() { return m_handle.done(); }
+	inline void Resume() { m_handle.resume(); }
+
+private:
+	std::coroutine_handle<promise_type> m_handle = nullptr;
+};
+
+// ỰյһϢbuf  '\0' βһ co_await ReadMessage() ֮ǰһֱЧ
+// opcodeLen Ϊָĳȣһ '$' λãrecvNs Ϊһݵʱ䣨ʵӣԱûռʱʱΪ 0
+// closed Ϊ true ʱʾѾϿtimedOut Ϊ true ʱʾȵʱҲûϢ buf û
+struct WheatSessionMessage {
+	bool closed = false;
+	bool timedOut = false;
+	const char * buf = nullptr;
+	size_t len = 0;
+	size_t opcodeLen = 0;
+	long long recvNs = 0;
+};
+
+// Ựһ¼ѭĻ
+// Эͨ co_await ReadMessage() ȴһϢԴʱϢɵԱ
+// ỰֻգɴԱsocket ǷģԷյʱûڴԱûỰȴд
+class WheatSession {
+public:
+
+	enum class State {
+		Free,		// Уû
+		Ready,		// ű
+		Running,	// 
+		WaitRead,	// ȴһϢ
+		Done		// ЭѾŻ
+	};
+
+	struct ReadAwaiter {
+		WheatSession & session;
+		long long timeoutMs;
+		bool await_ready() { return session.HasFrame() || session.m_closed; }
+		void await_suspend(std::coroutine_handle<>) { session.m_wakeMs = timeoutMs > 0 ? session.m_pClock->NowMs() + timeoutMs : 0; session.m_state = State::WaitRead; }
+		WheatSessionMessage await_resume();
+	};
+
+	// ȴһϢtimeoutMs ڶûϢĻһ timedOut Ϊ true ϢtimeoutMs <= 0 ʱһֱȥ
+	inline ReadAwaiter ReadMessage(long long timeoutMs = 0) { return ReadAwaiter { *this, timeoutMs }; }
+
+	inline SOCKET GetSocket() { return m_sock; }
+	inline const char * GetIPAddress() { return m_ipAddress; }
+	inline bool IsClosed() { return m_closed; }
+	// socket ѾصˣˡԱϿ뿪ҲѾ꣬ỰʱҪȥһ
+	// ʱ socket ıſѾָµӣȥؾͻ˯͸
+	inline bool IsSocketClosed() { return m_socketClosed; }
+	inline State GetState() { return m_state; }
+
+	// ջѹ˶ֽڣмɨ˻ûȡߵϢ
+	inline size_t GetBufferedBytes() { return m_recvLen; }
+	inline size_t GetPendingFrameNum() { return m_frameNum - m_frameNext; }
+
+private:
+	friend class WheatSessionScheduler;
+
+	SOCKET m_sock = INVALID_SOCKET;
+	char m_ipAddress[64] = "";
+
+	State m_state = State::Free;
+	bool m_closed = false;
+	bool m_socketClosed = false;
+
+	WheatClock * m_pClock = nullptr;
+	long long m_wakeMs = 0;		// Ϣȵʱʱ䣬Ϊ 0 ʾᳬʱ
+
+	// ûȡߵϢͷ trueѾɨϢȡ˵ĻȰѰϢŲͷɨһ
+	bool HasFrame();
+
+	// ջСɵԱĬ WHEATSESSION_RECV_BUFFER_SIZEӵԱĻֿrecv ֱյϢ͵ؽٿ
+	// ֻЭڵȴϢѾɨϢȡ˲ż socket ںȻγɱѹ
+	char * m_recvBuffer = nullptr;
+	size_t m_recvLen = 0;		// һжֽ
+	size_t m_scannedLen = 0;	// ѾɨϢֽ
+	long long m_recvNs = 0;		// һݵʱ
+
+	WheatFrameSpan m_frames[WHEATSESSION_MAX_FRAMES];
+	size_t m_frameNum = 0;
+	size_t m_frameNext = 0;
+
+	WheatSessionTask m_task;
+};
+
+// ỰԱ¼ѭлỰ¼˾ͻѶӦЭ
+// лỰ¼ѭڵ߳УͬһʱֻһЭܣҪ
+class WheatSessionScheduler {
+public:
+	using SessionBody = std::function<WheatSessionTask(WheatSession & session)>;
+
+	WheatSessionScheduler(WheatClock * pClock = GetSystemClock()) { m_pClock = pClock; }
+	~WheatSessionScheduler();
+
+	// Ԥ׼ sessionNum ỰỰ󡢽ջЭ֡ôڽȫֶҪڴ
+	// bLargePages Ϊ true ʱǷڴҳ
+	void Reserve(size_t sessionNum, bool bLargePages = false);
+
+	// ÿӵĽջСֻڵһ Reserve()  Start() ֮ǰã֮÷ false
+	bool SetRecvBufferSize(size_t size);
+	inline size_t GetRecvBufferSize() { return m_recvBufferSize; }
+
+	// Ƿÿյʱʱ佻Ự׷Ϣӳٵʱ򿪣ÿ recv ࿴һα
+	inline void SetRecvStamping(bool stamping) { m_recvStamping = stamping; }
+
+	// ÿỰҪеЭ̣лỰͬһ
+	inline void SetSessionBody(SessionBody body) { m_sessionBody = body; }
+
+	// µӣΪ俪һỰỰҪȵһ RunReady() ſʼ
+	void Start(SOCKET sock, const char * ipAddress);
+
+	// ȡӽջĿв֣¼ѭֱ recv *pFreeLen Ϊеֽ
+	// ֻ WantsRead() Ϊ true ʱʹã򷵻 nullptr
+	char * GetRecvBuffer(SOCKET sock, size_t * pFreeLen);
+
+	// ߵԱոջ len ֽڣԱɨϢỰ
+	void CommitRecv(SOCKET sock, size_t len);
+
+	// һպõϢתģ׷ӵӵĽջỰڵȴϢʱҲ׷
+	// ʱŲ· falseԺԣӲڡѾϿϢʱֱӵ true
+	bool Deliver(SOCKET sock, const char * buf, size_t len);
+
+	// ӶϿˣԷϿ߱Ͽ
+	// socketClosed Ϊ true ʾ socket Ѿصˣ֮ͬһŵ socket µӣҵỰ
+	void Hangup(SOCKET sock, bool socketClosed = false);
+
+	// еϢȵʱĻỰ
+	void Tick();
+
+	// бѵĻỰֱûлỰΪֹѾĻỰ
+	void RunReady();
+
+	// ӵĻỰǷڵȴϢ¼ѭֻЩ recv
+	bool WantsRead(SOCKET sock);
+
+	inline size_t GetSessionNum() { return m_sessions.size(); }
+
+	// ʹõĻỰԼűѵĻỰԱ鿴ѹʱ
+	inline const std::vector<WheatSession *> & GetSessions() { return m_sessions; }
+	inline size_t GetReadyNum() { return m_readyQueue.size(); }
+
+	// ֿһ׼˶ٸỰڴ棬жٸڴҳ
+	inline size_t GetPooledSessionNum() { return m_bufferSlab.GetBlockNum(); }
+	inline size_t GetLargePageSessionNum() { return m_bufferSlab.GetLargePageBlockNum(); }
+
+private:
+
+	WheatSession * FindSession(SOCKET sock);
+
+	// ɾһͷ
+	void IndexInsert(WheatSession * pSession);
+	void IndexErase(WheatSession * pSession);
+	void IndexResize(size_t slotNum);
+	inline size_t IndexHome(SOCKET sock) { unsigned long long h = static_cast<unsigned long long>(sock) * 0x9E3779B97F4A7C15ull; return static_cast<size_t>(h ^ (h >> 32)) & (m_sessionIndex.size() - 1); }
+
+	void MakeReady(WheatSession * pSession);
+
+	WheatClock * m_pClock = nullptr;
+
+	SessionBody m_sessionBody;
+
+	// ỰͽջӲֿ裬ỰԺһ𻹻ȥһ
+	WheatSlab m_sessionSlab { sizeof(WheatSession) };
+	WheatSlab m_bufferSlab { WHEATSESSION_RECV_BUFFER_SIZE };
+	size_t m_recvBufferSize = WHEATSESSION_RECV_BUFFER_SIZE;
+	bool m_recvStamping = false;
+
+	// ʹõĻỰ
+	std::vector<WheatSession *> m_sessions;
+	//  socket һỰ¼ѭÿһȦÿ socket ҪҺüΣsocket صĻỰϴߣλ
+	// ѰַɢбλΪ nullptrλ 2 ݣ Reserve() ʱһ׼ãỰȫֶҪڴ
+	std::vector<WheatSession *> m_sessionIndex;
+	size_t m_indexedNum = 0;
+
+	std::vector<WheatSession *> m_readyQueue;
+};
@@ -0,0 +1,499 @@
+#include "WheatSimulation.h"
+#include "ProjectCommon.h"
+#include "WheatLoopbackTransport.h"
+#include "WheatRoom.h"
+#include "WheatAdmission.h"
+#include "WheatMetrics.h"
+#include "WheatClock.h"
+#include "WheatSession.h"
+#include "WheatGatewayHub.h"
+#include "WheatBus.h"
+#include "WheatMux.h"
+
+#include <winsock.h>
+#include <iostream>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ϰõķ䲻 records.txt дҲӡȥÿһϢ
+static void QuietRoom(WheatRoom & room)
+{
+	room.SetChatRecording(false);
+	room.m_sendLog = false;
+}
+
+// ѻỰյÿһϢϰ·ʱ淿ܼ
+static WheatSessionTask RecordMessages(WheatSession & session, std::vector<std::string> * pReceived)
+{
+	while(true) {
+		WheatSessionMessage message = co_await session.ReadMessage();
+		if(message.closed) {
+			break;
+		}
+		pReceived->push_back(message.buf);
+	}
+}
+
+// ϱĶ˿ڣϷ INVALID_SOCKET
+static SOCKET ConnectLocal(int port)
+{
+	SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(sock == INVALID_SOCKET) {
+		return INVALID_SOCKET;
+	}
+
+	sockaddr_in address;
+	memset(& address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.S_un.S_addr = inet_addr("127.0.0.1");
+	if(connect(sock, (sockaddr *)& address, sizeof(address)) == SOCKET_ERROR) {
+		closesocket(sock);
+		return INVALID_SOCKET;
+	}
+	return sock;
+}
+
+// ԷѾӹص˷ trueȴ
+static bool IsHungUp(SOCKET sock)
+{
+	fd_set fdRead;
+	FD_ZERO(&fdRead);
+	FD_SET(sock, &fdRead);
+	timeval tm = { 0, 0 };
+
+	char c;
+	return select(0, &fdRead, nullptr, nullptr, &tm) > 0 && recv(sock, & c, 1, MSG_PEEK) <= 0;
+}
+
+// һֱת¼ѭֱ done() Ϊ true ߵ WHEATSIMULATION_SOCKET_WAIT_MSdone() Ϊ true  true
+// pollOnce һȦ¼ѭ£timeoutMs һȦ select ȶ
+static bool PollUntil(std::function<void(long timeoutMs)> pollOnce, std::function<bool()> done)
+{
+	long long deadlineMs = GetSystemClock()->NowMs() + WHEATSIMULATION_SOCKET_WAIT_MS;
+	while(done() == false) {
+		if(GetSystemClock()->NowMs() >= deadlineMs) {
+			return false;
+		}
+		pollOnce(10);
+	}
+	return true;
+}
+
+bool WheatSimulation::Run()
+{
+	m_checkNum = 0;
+	m_failedNum = 0;
+
+	WSADATA wsaData;
+	if(WSAStartup(MAKEWORD(2, 2), & wsaData) != 0) {
+		printf("WSAStartup Failed!\n");
+		return false;
+	}
+
+	RunHeartbeat();
+	RunMessages();
+	RunSessionChurn();
+	RunAdmission();
+	RunVoteKick();
+	RunGatewayLink();
+	RunBus();
+
+	WSACleanup();
+
+	printf("Simulation Finished, %d Checks, %d Failed.\n", m_checkNum, m_failedNum);
+	return m_failedNum == 0;
+}
+
+bool WheatSimulation::Check(bool passed, const char * what)
+{
+	m_checkNum++;
+	if(passed == false) {
+		m_failedNum++;
+	}
+	printf("[%s] %s\n", passed ? "PASS" : "FAIL", what);
+	return passed;
+}
+
+bool WheatSimulation::RunHeartbeat()
+{
+	printf("------- Heartbeat -------\n");
+
+	WheatVirtualClock clock;
+	WheatLoopbackTransport transport(& clock);
+	WheatRoom room(& transport, & clock);
+	transport.Attach(& room);
+	QuietRoom(room);
+
+	// һûϢͷûϢͿ
+	room.SetHeartbeat(1000, 3000);
+
+	SOCKET talker = transport.Connect();
+	SOCKET silent = transport.Connect();
+	SOCKET spectator = transport.ConnectSpectator();
+
+	// ˵˯ÿ 900 ˵һ䣬һҲȲ
+	for(int i = 0; i < 5; i++) {
+		transport.AdvanceTime(& clock, 900);
+		transport.Inject(talker, "pong$");
+	}
+
+	bool passed = true;
+	passed &= Check(transport.IsConnected(talker), "talking sleeper stays");
+	passed &= Check(transport.GetOutbound(talker).find("ping$") == std::string::npos, "talking sleeper is never pinged");
+	passed &= Check(transport.GetOutbound(silent).find("ping$") != std::string::npos, "silent sleeper is pinged");
+	passed &= Check(transport.IsConnected(silent) == false, "silent sleeper is dropped after the idle timeout");
+	passed &= Check(transport.IsConnected(spectator) == false, "silent spectator is dropped after the idle timeout");
+	passed &= Check(room.m_metrics.m_connectionStats.idleTimeouts == 2, "two idle timeouts counted");
+	passed &= Check(room.GetSleeperNum() == 1 && transport.GetSessions().GetSessionNum() == 1, "dropped sessions are reaped");
+
+	// ˵ԺһСʱһ˯Ҳͱ
+	transport.AdvanceTime(& clock, 60 * 60 * 1000);
+	passed &= Check(transport.IsConnected(talker) == false && room.GetSleeperNum() == 0, "room is empty after an idle hour");
+	passed &= Check(transport.GetSessions().GetSessionNum() == 0, "no session left after an idle hour");
+
+	return passed;
+}
+
+bool WheatSimulation::RunMessages()
+{
+	printf("------- Messages -------\n");
+
+	WheatVirtualClock clock;
+	WheatLoopbackTransport transport(& clock);
+	WheatRoom room(& transport, & clock);
+	transport.Attach(& room);
+	QuietRoom(room);
+
+	SOCKET sleepers[3];
+	for(SOCKET & sock : sleepers) {
+		sock = transport.Connect();
+	}
+	transport.Inject(sleepers[0], "name$alice");
+	transport.Inject(sleepers[1], "name$bob");
+	transport.SetKeepOutbound(false);
+
+	// һյϢ socket һһ recv պü
+	static const char messages[] = "move$1,2\0pos$3,4\0chat$hi";
+	const int rounds = WHEATSIMULATION_MESSAGES / 3;
+
+	// ʱֿ⡢첾ЩȶĴС
+	for(int i = 0; i < rounds / 10; i++) {
+		transport.Inject(sleepers[i % 2], messages, sizeof(messages));
+	}
+
+	room.m_metrics.ResetHandlerStats();
+	transport.ResetCounters();
+	unsigned long long heapStart = WheatMetrics::GetHeapAllocations();
+	long long startNs = GetSystemClock()->NowNs();
+
+	for(int i = 0; i < rounds; i++) {
+		transport.Inject(sleepers[i % 2], messages, sizeof(messages));
+	}
+
+	long long elapsedNs = GetSystemClock()->NowNs() - startNs;
+	unsigned long long heapAllocations = WheatMetrics::GetHeapAllocations() - heapStart;
+
+	room.m_metrics.PrintHandlerStats();
+	printf("%d Messages In %.3f ms, %.2f M msg/s, %llu Messages (%llu Bytes) Sent, %llu Heap Allocations%s\n",
+		rounds * 3, elapsedNs / 1e6, elapsedNs > 0 ? rounds * 3 * 1e3 / elapsedNs : 0.0,
+		transport.GetSentMessages(), transport.GetSentBytes(), heapAllocations, WHEATMETRICS_COUNT_HEAP ? "" : " (Not Counted)");
+
+	bool passed = true;
+	passed &= Check(transport.GetSentMessages() > 0, "messages are broadcast");
+	passed &= Check(heapAllocations == 0, "no heap allocation on the message path");
+	passed &= Check(transport.GetSessions().GetSessionNum() == 3, "every sleeper keeps its session");
+
+	return passed;
+}
+
+bool WheatSimulation::RunSessionChurn()
+{
+	printf("------- Session Churn -------\n");
+
+	WheatVirtualClock clock;
+	WheatLoopbackTransport transport(& clock);
+	WheatRoom room(& transport, & clock);
+	transport.Attach(& room);
+	QuietRoom(room);
+	transport.SetKeepOutbound(false);
+
+	//  TCPԱ һǰѻỰ׼ã socket ãÿһֶµ
+	transport.Reserve(WHEATSIMULATION_CHURN_SESSIONS * WHEATSIMULATION_CHURN_ROUNDS, WHEATSIMULATION_CHURN_SESSIONS);
+	std::vector<SOCKET> sockets(WHEATSIMULATION_CHURN_SESSIONS);
+
+	bool passed = true;
+	for(int round = 0; round < WHEATSIMULATION_CHURN_ROUNDS; round++) {
+		unsigned long long heapStart = WheatMetrics::GetHeapAllocations();
+
+		for(SOCKET & sock : sockets) {
+			sock = transport.Connect();
+		}
+		for(SOCKET sock : sockets) {
+			transport.Inject(sock, "name$somebody_with_a_long_name");
+		}
+		int sleeperNum = room.GetSleeperNum();
+		for(SOCKET sock : sockets) {
+			transport.Hangup(sock);
+		}
+
+		unsigned long long heapAllocations = WheatMetrics::GetHeapAllocations() - heapStart;
+		printf("Round %d: %d Sleepers, %llu Heap Allocations%s\n", round, sleeperNum, heapAllocations, WHEATMETRICS_COUNT_HEAP ? "" : " (Not Counted)");
+
+		passed &= Check(sleeperNum == WHEATSIMULATION_CHURN_SESSIONS, "every sleeper is in the room at once");
+		passed &= Check(room.GetSleeperNum() == 0 && transport.GetSessions().GetSessionNum() == 0, "room is empty after everyone leaves");
+		// һﴲλЩһγô󣬲
+		if(round > 0) {
+			passed &= Check(heapAllocations == 0, "no heap allocation after the first round");
+		}
+	}
+
+	return passed;
+}
+
+bool WheatSimulation::RunAdmission()
+{
+	printf("------- Admission -------\n");
+
+	WheatVirtualClock clock;
+	WheatAdmission admission(& clock);
+
+	//  4 ӣÿ IP  2 ÿ 10 һ 3 
+	admission.SetLimits(4, 2, 10, 3);
+
+	using Result = WheatAdmission::Result;
+	bool passed = true;
+	passed &= Check(admission.TryAdmit(1, 1) == Result::Admitted && admission.TryAdmit(2, 1) == Result::Admitted, "first two from one ip admitted");
+	passed &= Check(admission.TryAdmit(3, 1) == Result::TooManyFromIP, "third from the same ip refused");
+	passed &= Check(admission.TryAdmit(4, 2) == Result::Admitted, "another ip admitted");
+	passed &= Check(admission.TryAdmit(5, 3) == Result::TooFast, "burst used up");
+
+	clock.AdvanceMs(100);
+	passed &= Check(admission.TryAdmit(5, 3) == Result::Admitted, "one token refilled after 100 ms");
+
+	clock.AdvanceMs(1000);
+	passed &= Check(admission.TryAdmit(6, 4) == Result::ServerFull, "server full at 4 connections");
+
+	admission.Release(1);
+	passed &= Check(admission.TryAdmit(6, 4) == Result::Admitted, "admitted again after a release");
+
+	admission.Ban(5);
+	passed &= Check(admission.TryAdmit(7, 5) == Result::Banned, "banned ip refused");
+	passed &= Check(admission.GetConnectionNum() == 4, "4 connections admitted");
+
+	admission.PrintStats();
+	return passed;
+}
+
+bool WheatSimulation::RunVoteKick()
+{
+	printf("------- Vote Kick -------\n");
+
+	WheatVirtualClock clock;
+	WheatLoopbackTransport transport(& clock);
+	WheatRoom room(& transport, & clock);
+	transport.Attach(& room);
+	QuietRoom(room);
+	room.SetVoteSeconds(1);
+
+	// ŵ˳õ ˯id 012
+	SOCKET alice = transport.Connect();
+	SOCKET bob = transport.Connect();
+	SOCKET carol = transport.Connect();
+
+	bool passed = true;
+	transport.Inject(alice, "kick$99");
+	passed &= Check(room.m_voteKick.IsVoting() == false, "no vote against a sleeper who is not here");
+
+	// ͶƱĿԼˣĴ ˯idͶƱʱҲܰѴ
+	transport.Inject(alice, "kick$2");
+	transport.Inject(alice, "agree$");
+	transport.Inject(bob, "agree$");
+	transport.Hangup(carol);
+	passed &= Check(room.m_voteKick.IsVoting() == false, "vote is called off when the target leaves");
+	passed &= Check(transport.GetOutbound(bob).find("kickover$") != std::string::npos, "others are told the vote is over");
+
+	SOCKET dave = transport.Connect();
+	transport.Inject(alice, "agree$");
+	transport.Inject(bob, "agree$");
+	transport.AdvanceTime(& clock, 1100);
+	passed &= Check(transport.IsConnected(dave), "newcomer reusing the id is not kicked");
+
+	// ͶƱ
+	transport.Inject(alice, "kick$1");
+	transport.Inject(alice, "agree$");
+	transport.Inject(dave, "agree$");
+	transport.AdvanceTime(& clock, 1100);
+	passed &= Check(transport.IsConnected(bob) == false && room.m_voteKick.IsVoting() == false, "target is kicked when the vote passes");
+
+	return passed;
+}
+
+bool WheatSimulation::RunGatewayLink()
+{
+	printf("------- Gateway Link -------\n");
+
+	const std::string secret = "simulation";
+
+	std::vector<std::string> received;
+	WheatSessionScheduler sessions;
+	sessions.SetSessionBody([& received](WheatSession & session) { return RecordMessages(session, & received); });
+
+	WheatGatewayHub hub(& sessions);
+	if(Check(hub.Start("127.0.0.1", WHEATSIMULATION_LINK_PORT, secret), "gateway hub listens on 127.0.0.1") == false) {
+		return false;
+	}
+
+	// һһȦ¼ѭ
+	auto pollHub = [&](long timeoutMs) {
+		fd_set fdRead;
+		FD_ZERO(&fdRead);
+		hub.AddToFdSet(&fdRead);
+		timeval tm = { 0, timeoutMs * 1000 };
+		if(select(0, &fdRead, nullptr, nullptr, &tm) > 0) {
+			hub.Poll(&fdRead);
+		}
+		sessions.RunReady();
+		hub.Flush();
+	};
+
+	// һࣺϰţһλ˯ͣһϢϢһŽβ '\0'
+	WheatMuxLink gateway;
+	gateway.Attach(ConnectLocal(WHEATSIMULATION_LINK_PORT));
+	static const char ipAddress[] = "10.0.0.1";
+	static const char message[] = "chat$hello";
+	gateway.QueueHello(secret);
+	gateway.Queue(WheatMuxType::Open, 1, ipAddress, sizeof(ipAddress) - 1);
+	gateway.Queue(WheatMuxType::Data, 1, message, sizeof(message));
+
+	// ŲԵ·֡Ӧñ
+	WheatMuxLink intruder;
+	intruder.Attach(ConnectLocal(WHEATSIMULATION_LINK_PORT));
+	intruder.QueueHello("guess");
+	intruder.Queue(WheatMuxType::Open, 1, ipAddress, sizeof(ipAddress) - 1);
+
+	bool passed = true;
+	passed &= Check(gateway.IsOpen() && intruder.IsOpen() && gateway.Flush() && intruder.Flush(), "links connect and send");
+
+	passed &= Check(PollUntil(pollHub, [&]() { return received.empty() == false; }), "message reaches the session");
+	passed &= Check(received.size() == 1 && received[0] == message, "message arrives intact");
+	passed &= Check(PollUntil(pollHub, [&]() { return IsHungUp(intruder.GetSocket()); }), "link with a bad secret is closed");
+	passed &= Check(hub.GetLinkNum() == 1 && hub.GetClientNum() == 1 && sessions.GetSessionNum() == 1, "only the trusted link opens a client");
+
+	// ػ socket Ϣܵ·ϣһȦʱ
+	static const char reply[] = "chat$welcome";
+	if(sessions.GetSessionNum() == 1) {
+		hub.Send(sessions.GetSessions()[0]->GetSocket(), reply, sizeof(reply));
+	}
+
+	WheatMuxHeader header;
+	const char * payload = nullptr;
+	auto pollGateway = [&](long timeoutMs) {
+		pollHub(0);
+		fd_set fdRead;
+		FD_ZERO(&fdRead);
+		FD_SET(gateway.GetSocket(), &fdRead);
+		timeval tm = { 0, timeoutMs * 1000 };
+		if(select(0, &fdRead, nullptr, nullptr, &tm) > 0 && gateway.Receive() == false) {
+			gateway.Close();
+		}
+	};
+	bool replied = PollUntil(pollGateway, [&]() { return gateway.IsOpen() == false || gateway.PeekFrame(& header, & payload); });
+	passed &= Check(replied && gateway.IsOpen() && header.type == WheatMuxType::Data && header.clientId == 1
+		&& header.payloadLen == sizeof(reply) && memcmp(payload, reply, sizeof(reply)) == 0, "reply reaches the gateway");
+
+	gateway.Close();
+	intruder.Close();
+	hub.Close();
+	sessions.RunReady();
+	return passed;
+}
+
+bool WheatSimulation::RunBus()
+{
+	printf("------- Bus -------\n");
+
+	const std::string secret = "simulation";
+
+	WheatBusBroker broker;
+	if(Check(broker.Start("127.0.0.1", WHEATSIMULATION_BUS_PORT, secret), "bus broker listens on 127.0.0.1") == false) {
+		return false;
+	}
+
+	WheatBusClient listener;
+	WheatBusClient publisher;
+	listener.Start("127.0.0.1", WHEATSIMULATION_BUS_PORT, secret);
+	publisher.Start("127.0.0.1", WHEATSIMULATION_BUS_PORT, secret);
+
+	std::vector<std::string> received;
+	listener.Subscribe(WHEATBUS_TOPIC_CHAT_PREFIX "*", [& received](const char * topic, size_t topicLen, const char * payload, size_t len) {
+		received.push_back(std::string(topic, topicLen) + "|" + std::string(payload, len));
+	});
+
+	// ̨ڵתһȦ͸Ե¼ѭһ
+	auto pollBus = [&](long timeoutMs) {
+		fd_set fdRead;
+		fd_set fdWrite;
+		FD_ZERO(&fdRead);
+		FD_ZERO(&fdWrite);
+		broker.AddToFdSet(&fdRead);
+		listener.AddToFdSet(&fdRead, &fdWrite);
+		publisher.AddToFdSet(&fdRead, &fdWrite);
+		timeval tm = { 0, timeoutMs * 1000 };
+		if(select(0, &fdRead, &fdWrite, nullptr, &tm) > 0) {
+			broker.Poll(&fdRead);
+			listener.Poll(&fdRead, &fdWrite);
+			publisher.Poll(&fdRead, &fdWrite);
+		}
+		listener.Tick();
+		publisher.Tick();
+		broker.Flush();
+		listener.Flush();
+		publisher.Flush();
+	};
+
+	bool passed = true;
+	passed &= Check(PollUntil(pollBus, [&]() { return listener.IsConnected() && publisher.IsConnected(); }), "nodes connect to the broker");
+
+	// ·ϵ֡˭ȵ̨˵׼ĵ֮ǰϢᱻӵһֱյΪֹ
+	static const char message[] = "node\0somebody\0hello";
+	auto publishAndPoll = [&](long timeoutMs) {
+		publisher.Publish(WHEATBUS_TOPIC_CHAT_PREFIX "lobby", message, sizeof(message) - 1);
+		publisher.Publish(WHEATBUS_TOPIC_ANNOUNCE, "hi", 2);
+		pollBus(timeoutMs);
+	};
+	passed &= Check(PollUntil(publishAndPoll, [&]() { return received.empty() == false; }), "published message reaches the subscriber");
+
+	const std::string expected = std::string(WHEATBUS_TOPIC_CHAT_PREFIX "lobby|") + std::string(message, sizeof(message) - 1);
+	bool intact = received.empty() == false;
+	for(const std::string & one : received) {
+		intact &= one == expected;
+	}
+	passed &= Check(intact, "only the subscribed topic arrives, intact");
+
+	// ŲԵĽڵ㣺ϢӦתκ
+	WheatMuxLink intruder;
+	intruder.Attach(ConnectLocal(WHEATSIMULATION_BUS_PORT));
+	intruder.QueueHello("guess");
+	static const char spoof[] = "\x0a" WHEATBUS_TOPIC_CHAT_PREFIX "lobby" "spoof";
+	intruder.Queue(WheatMuxType::Publish, 0, spoof, sizeof(spoof) - 1);
+	passed &= Check(intruder.IsOpen() && intruder.Flush(), "intruder connects and sends");
+
+	passed &= Check(PollUntil(pollBus, [&]() { return IsHungUp(intruder.GetSocket()); }), "node with a bad secret is closed");
+	// ǰһֱϢܻм·ϣֻûðһ
+	for(int i = 0; i < 10; i++) {
+		pollBus(1);
+	}
+	bool spoofed = false;
+	for(const std::string & one : received) {
+		spoofed |= one.find("spoof") != std::string::npos;
+	}
+	passed &= Check(spoofed == false && listener.IsConnected() && publisher.IsConnected(), "nothing from the bad node is delivered");
+
+	intruder.Close();
+	listener.Close();
+	publisher.Close();
+	broker.Close();
+	return passed;
+}
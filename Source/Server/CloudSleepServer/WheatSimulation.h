@@ -0,0 +1,50 @@
+#pragma once
+
+// ϰʱÿһֽٸ˯ͣ
+#define WHEATSIMULATION_CHURN_SESSIONS 1000
+#define WHEATSIMULATION_CHURN_ROUNDS 3
+
+// ٶȵʱһϢmoveposchat ֮һ
+#define WHEATSIMULATION_MESSAGES 30000
+
+// ϰ·ϢߵʱڱĶ˿ڣʽĶ˿ڴ
+#define WHEATSIMULATION_LINK_PORT 47291
+#define WHEATSIMULATION_BUS_PORT 47292
+
+//  socket ϰʱȶãλ 
+#define WHEATSIMULATION_SOCKET_WAIT_MS 2000
+
+// ϰԱڴػԱ(WheatLoopbackTransport)Ӱѷһ
+// ÿһķͬһ׻ỰܼҺĴ룺ͿгʱϢ˯ͳĸ
+// ֮·ֻڱ 127.0.0.1 Ͽ˿ڣ socket 
+// ÿһ鶼ӡ PASS  FAILһûͨ Run() ͷ falseٶȺȫֶҪ˼ڴҲһӡ
+// ȫֶֻд WHEATMETRICS_COUNT_HEAPDebug Ĭϴ򿪣ʱûʱӦļͨ
+class WheatSimulation {
+public:
+
+	// ÿһһ飬ȫͨ true
+	bool Run();
+
+private:
+
+	// ˵˯һֱţ˵˯ͺ͹յ˿гʱߣһСʱԺ˭ʣ
+	bool RunHeartbeat();
+	// ˯ͷ WHEATSIMULATION_MESSAGES ϢԺϢȫֶҪڴ
+	bool RunMessages();
+	// ÿһ WHEATSIMULATION_CHURN_SESSIONS ˯ͽš뿪һԺȫֶҪڴ棬ÿһ귿䶼ǿյ
+	bool RunSessionChurn();
+	// һӽ̫ࡢͬһ IP ̫ࡢԱܽ
+	bool RunAdmission();
+	// ͶƱˣ߲ڵ˯ͲͶƱͶƱ˯ԼͶƱգ ˯id ˯ͲᱻߣͶƱ
+	bool RunVoteKick();
+	// ·ȷ Hello ٿһλ˯ͷһϢϢҪ͵ỰĻػҪͻأŲԵ·Ͽ
+	bool RunGatewayLink();
+	// ϢߣڵϰţһһϢֻ͵Ľڵ㣻ŲԵĽڵ㷢Ϣ˭Ҳղ
+	bool RunBus();
+
+	// һ飬ûͨĻһ
+	bool Check(bool passed, const char * what);
+
+	int m_checkNum = 0;
+	int m_failedNum = 0;
+};
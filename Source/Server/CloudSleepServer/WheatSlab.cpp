@@ -0,0 +1,153 @@
+#include "WheatSlab.h"
+#include "ProjectCommon.h"
+
+#include <winsock.h>
+#include <iostream>
+#include <new>
+
+// ÿƬڴ濪ͷſͷͷռһ뵥λĵһ鱾Ƕ
+#define WHEATSLAB_REGION_HEADER_SIZE WHEATSLAB_BLOCK_ALIGN
+
+static_assert(sizeof(void *) <= WHEATSLAB_BLOCK_ALIGN, "free list link must fit in a block");
+
+// 򿪵ǰ̵ "ڴҳ" ȨޣҳȨ޲Ҫֻһ
+static bool EnableLockMemoryPrivilege()
+{
+	static int s_enabled = -1;
+	if(s_enabled != -1) {
+		return s_enabled == 1;
+	}
+
+	s_enabled = 0;
+
+	HANDLE hToken = nullptr;
+	if(OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, & hToken) == FALSE) {
+		return false;
+	}
+
+	TOKEN_PRIVILEGES privileges;
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	if(LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", & privileges.Privileges[0].Luid) != FALSE) {
+		// ˻ûȨʱ AdjustTokenPrivileges Ҳ᷵سɹҪٿһ GetLastError()
+		if(AdjustTokenPrivileges(hToken, FALSE, & privileges, 0, nullptr, nullptr) != FALSE && GetLastError() == ERROR_SUCCESS) {
+			s_enabled = 1;
+		}
+	}
+	CloseHandle(hToken);
+
+	if(s_enabled == 0) {
+		printf("SeLockMemoryPrivilege Not Held, Large Pages Disabled.\n");
+	}
+	return s_enabled == 1;
+}
+
+int WheatSlab::s_numaNode = -1;
+
+// ϵͳҪһƬڴ棬ָ NUMA ڵĻǸڵ
+static char * AllocRegion(size_t size, DWORD allocationType)
+{
+	if(WheatSlab::GetNumaNode() >= 0) {
+		return static_cast<char *>(VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, allocationType, PAGE_READWRITE, static_cast<DWORD>(WheatSlab::GetNumaNode())));
+	}
+	return static_cast<char *>(VirtualAlloc(nullptr, size, allocationType, PAGE_READWRITE));
+}
+
+WheatSlab::WheatSlab(size_t blockSize)
+{
+	SetBlockSize(blockSize);
+}
+
+WheatSlab::~WheatSlab()
+{
+	Region * pRegion = m_pRegions;
+	while(pRegion != nullptr) {
+		Region * pNext = pRegion->pNext;
+		VirtualFree(pRegion, 0, MEM_RELEASE);
+		pRegion = pNext;
+	}
+}
+
+bool WheatSlab::SetBlockSize(size_t blockSize)
+{
+	// ѾкõĿûٸĴС
+	if(m_pRegions != nullptr) {
+		return false;
+	}
+
+	// Ҫŵ¿ָ룬Ұж
+	blockSize = MAX(blockSize, sizeof(void *));
+	m_blockSize = (blockSize + WHEATSLAB_BLOCK_ALIGN - 1) & ~static_cast<size_t>(WHEATSLAB_BLOCK_ALIGN - 1);
+	return true;
+}
+
+void WheatSlab::Reserve(size_t blockNum)
+{
+	if(m_freeNum < blockNum) {
+		NewRegion(blockNum - m_freeNum);
+	}
+}
+
+void * WheatSlab::Acquire()
+{
+	if(m_pFreeList == nullptr) {
+		NewRegion(WHEATSLAB_GROW_BLOCK_NUM);
+	}
+
+	void * pBlock = m_pFreeList;
+	m_pFreeList = *static_cast<void **>(pBlock);
+	m_freeNum--;
+	return pBlock;
+}
+
+void WheatSlab::Release(void * p)
+{
+	*static_cast<void **>(p) = m_pFreeList;
+	m_pFreeList = p;
+	m_freeNum++;
+}
+
+void WheatSlab::NewRegion(size_t blockNum)
+{
+	size_t size = WHEATSLAB_REGION_HEADER_SIZE + blockNum * m_blockSize;
+	bool largePages = false;
+	char * base = nullptr;
+
+	if(m_largePages && EnableLockMemoryPrivilege()) {
+		// ҳĴС GetLargePageMinimum() ĲҲгɿ
+		size_t largePageSize = GetLargePageMinimum();
+		if(largePageSize > 0) {
+			size_t largeSize = (size + largePageSize - 1) / largePageSize * largePageSize;
+			base = AllocRegion(largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES);
+			if(base != nullptr) {
+				size = largeSize;
+				largePages = true;
+			}
+		}
+	}
+
+	if(base == nullptr) {
+		base = AllocRegion(size, MEM_RESERVE | MEM_COMMIT);
+	}
+	if(base == nullptr) {
+		printf("WheatSlab VirtualAlloc Failed! %lu\n", GetLastError());
+		throw std::bad_alloc();
+	}
+
+	Region * pRegion = reinterpret_cast<Region *>(base);
+	pRegion->size = size;
+	pRegion->largePages = largePages;
+	pRegion->pNext = m_pRegions;
+	m_pRegions = pRegion;
+
+	// Źҽȥʱӵ͵ַʼ
+	size_t regionBlockNum = (size - WHEATSLAB_REGION_HEADER_SIZE) / m_blockSize;
+	for(size_t i = regionBlockNum; i > 0; i--) {
+		Release(base + WHEATSLAB_REGION_HEADER_SIZE + (i - 1) * m_blockSize);
+	}
+
+	m_blockNum += regionBlockNum;
+	if(largePages) {
+		m_largePageBlockNum += regionBlockNum;
+	}
+}
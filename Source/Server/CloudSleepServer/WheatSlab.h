@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+
+// ÿڴ水ж룬鲻ͬһ
+#define WHEATSLAB_BLOCK_ALIGN 64
+
+// ֿԺÿβٿ
+#define WHEATSLAB_GROW_BLOCK_NUM 64
+
+// ̶Сڴֿ⣬һϵͳҪһƬڴ棬гһһؽȥĿŽһλ
+// ӽֻժ¡ϣȫֶҪڴ棬Ҳڴ滹ϵͳ
+// ôҳWindows Ҫ˻ "ڴҳ" ȨޣװӵĻֻռٵ TLB òҳ˻ͨҳ
+class WheatSlab {
+public:
+	WheatSlab(size_t blockSize);
+	~WheatSlab();
+
+	WheatSlab(const WheatSlab &) = delete;
+	WheatSlab & operator=(const WheatSlab &) = delete;
+
+	// ıĴСֻڵһϵͳҪڴ֮ǰģ֮ٸķ false
+	bool SetBlockSize(size_t blockSize);
+
+	// ֮ҪڴǷôҳ
+	inline void SetLargePages(bool bLargePages) { m_largePages = bLargePages; }
+
+	// ֮вֿҪڴ涼ڵ node  NUMA ڵϣ¼ѭڵĽڵ㣩-1 ʾϵͳ
+	// ҪڵһϵͳҪڴ֮ǰãѾҪڴ治
+	static inline void SetNumaNode(int node) { s_numaNode = node; }
+	static inline int GetNumaNode() { return s_numaNode; }
+
+	// ֿ֤ blockNum еڴ棬һԲ
+	void Reserve(size_t blockNum);
+
+	// һڴ棬ֿ˾Ͳ WHEATSLAB_GROW_BLOCK_NUM 
+	void * Acquire();
+	// һڴ棬Ǵֿȥ
+	void Release(void * p);
+
+	inline size_t GetBlockSize() { return m_blockSize; }
+	inline size_t GetBlockNum() { return m_blockNum; }
+	inline size_t GetFreeNum() { return m_freeNum; }
+	// ôҳװŵĿ
+	inline size_t GetLargePageBlockNum() { return m_largePageBlockNum; }
+
+private:
+	struct Region {
+		Region * pNext;
+		size_t size;
+		bool largePages;
+	};
+
+	// ϵͳҪһƬװ blockNum ڴ棬кùҽ
+	void NewRegion(size_t blockNum);
+
+	size_t m_blockSize;
+	bool m_largePages = false;
+
+	Region * m_pRegions = nullptr;
+	void * m_pFreeList = nullptr;
+
+	size_t m_blockNum = 0;
+	size_t m_freeNum = 0;
+	size_t m_largePageBlockNum = 0;
+
+	static int s_numaNode;
+};
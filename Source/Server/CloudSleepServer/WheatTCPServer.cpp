@@ -1,23 +1,35 @@
 #include "WheatTCPServer.h"
 #include "ProjectCommon.h"
 
-#include "WheatChatRecorder.h"
-
 #include <iostream>
-#include <thread>
+#include <cstring>
+
+// ÿÿһļûбĹλ 
+#define WHEATTCP_CONFIG_CHECK_MS 1000
 
-#define WHEATTCP_BUFFERSIZE 256
+// ÿϢϱһη˯λ 
+#define WHEATTCP_PRESENCE_MS 1000
+
+// һֽܶûȥٶͶϿ˯ͼȿס¼ѭҲԲڴ
+#define WHEATTCP_MAX_PENDING_BYTES (256 * 1024)
 
 #pragma comment(lib, "ws2_32.lib")
 
 bool WheatTCPServer::Init(int port) {
+	m_pConfig->port = port;
+	return Init(m_pConfig);
+}
+
+bool WheatTCPServer::Init(WheatConfig * pConfig) {
+	m_pConfig = pConfig;
+
 	if(WSAStart() == false) {
 		return false;
 	}
 	if(SocketInit() == false) {
 		return false;
 	}
-	SetServerAddress(port);
+	SetServerAddress(m_pConfig->listenAddress.c_str(), m_pConfig->port);
 	if(Bind() == false) {
 		return false;
 	}
@@ -29,6 +41,18 @@ bool WheatTCPServer::Init(int port) {
 
 void WheatTCPServer::CloseServer() {
 	closesocket(m_socket);
+	if(m_wsSocket != INVALID_SOCKET) {
+		closesocket(m_wsSocket);
+		m_wsSocket = INVALID_SOCKET;
+	}
+	if(m_tlsSocket != INVALID_SOCKET) {
+		closesocket(m_tlsSocket);
+		m_tlsSocket = INVALID_SOCKET;
+	}
+	if(m_spectatorSocket != INVALID_SOCKET) {
+		closesocket(m_spectatorSocket);
+		m_spectatorSocket = INVALID_SOCKET;
+	}
 	WSACleanup();
 }
 
@@ -36,374 +60,730 @@ void WheatTCPServer::Run()
 {
 	printf("Server Start to Run.\n");
 
-	WheatChatRecorder wheatChatRecorder;
-
-	fd_set fd;
-	FD_ZERO(&fd);
-	FD_SET(m_socket, &fd);
-
-	int fdMax = static_cast<int>(m_socket);
-
-	// ̸߳ͶƱ
-	std::thread([&]() {
-		while(true) {
-			Sleep(10);
-			if(m_voteKick.IsVoting()) {
-				// printf("VotingTime %d\n", m_voteKick.GetPastTime());
-				// жǷȥʮ߸
-				if(m_voteKick.GetPastTime() >= 10) {
-					int voteAgreeTemp, voteRefuseTemp;
-					m_voteKick.GetVoteAnswer(&voteAgreeTemp, &voteRefuseTemp);
-
-					// ͬǷԵ
-					if(voteAgreeTemp >= voteRefuseTemp * 2 && voteAgreeTemp + voteRefuseTemp > 1) {
-						// ͶϿ˯͵
-						CloseClient(m_bedManager.m_sleepers[m_voteKick.m_voteKickSleeperId].sock, &fd, fdMax);
-					
-						printf("Kicked %lld.\n", m_bedManager.m_sleepers[m_voteKick.m_voteKickSleeperId].sock);
-					}
+	FD_ZERO(&m_fd);
+	FD_SET(m_socket, &m_fd);
 
-					SendCommandToFdSet(fd, fdMax, m_voteKick.m_voteKickSleeperId, WheatCommand(WheatCommandType::kickover, "", 0, 0));
+	m_fdMax = static_cast<int>(m_socket);
 
-					m_voteKick.SetIsVoting(false);
+	m_sessions.SetSessionBody([this](WheatSession & session) {
+		if(m_spectatorSockets.empty() == false && m_spectatorSockets.count(session.GetSocket()) != 0) {
+			return m_room.RunSpectatorSession(session);
+		}
+		return m_room.RunSession(session);
+	});
 
-					printf("Vote Over.\n");
-				}
-			}
+	// ӵĻỰջЭ֡һ׼֮ӽȫֶҪڴ
+	// select Ҳֻܿ FD_SETSIZE  socket׼ٶҲò
+	m_sessions.SetRecvBufferSize(m_pConfig->recvBufferSize);
+	m_sessions.Reserve(MIN(static_cast<size_t>(m_pConfig->sessionPoolSize), static_cast<size_t>(FD_SETSIZE)), m_pConfig->largePages);
+	printf("Session Pool: %zu Sessions, %zu On Large Pages.\n", m_sessions.GetPooledSessionNum(), m_sessions.GetLargePageSessionNum());
+
+	ApplyConfig();
+	m_pConfig->Print();
+
+	m_admin.Start(m_pConfig->adminPort, m_pConfig->stdinCpu);
+
+	m_directoryAgent.Start(m_pConfig->directoryAddress.c_str(), m_pConfig->directoryPort, m_pConfig->nodeName.c_str(), m_pConfig->roomName.c_str(), m_pConfig->publicAddress.c_str(), m_pConfig->port, m_pConfig->linkSecret);
+
+	m_gatewayHub.Start(m_pConfig->gatewayLinkAddress.c_str(), m_pConfig->gatewayLinkPort, m_pConfig->linkSecret);
+
+	// ҪܵĶ˿֤ʧʱ˻
+	bool tlsWanted = m_pConfig->tlsPort != 0 || (m_pConfig->websocketPort != 0 && m_pConfig->websocketTls);
+	if(tlsWanted) {
+		// ܺõݺһ߷ķͣ
+		m_tls.SetSender([this](SOCKET sock, const char * buf, size_t len) { return WriteSocket(sock, buf, len); });
+		m_tls.Init(m_pConfig->tlsCertificate.c_str(), m_pConfig->tlsPassword.c_str(), m_pConfig->tlsSessionMinutes);
+	}
+	if(m_pConfig->websocketPort != 0 && (m_pConfig->websocketTls == false || m_tls.IsEnabled())) {
+		m_wsSocket = OpenListener(m_pConfig->websocketPort, m_pConfig->websocketTls ? "WebSocket (TLS)" : "WebSocket");
+	}
+	if(m_pConfig->tlsPort != 0 && m_tls.IsEnabled()) {
+		m_tlsSocket = OpenListener(m_pConfig->tlsPort, "TLS");
+	}
+	if(m_pConfig->spectatorPort != 0) {
+		m_spectatorSocket = OpenListener(m_pConfig->spectatorPort, "Spectator");
+	}
+	for(SOCKET listenSocket : { m_wsSocket, m_tlsSocket, m_spectatorSocket }) {
+		if(listenSocket != INVALID_SOCKET) {
+			FD_SET(listenSocket, &m_fd);
+			m_fdMax = MAX(m_fdMax, static_cast<int>(listenSocket));
 		}
-	}).detach();
+	}
+	m_admin.SetTls(& m_tls);
+	m_admin.SetGovernor(& m_governor);
+	m_admin.SetServer(this);
+
+	// Ϣ߿̨
+	m_bus.Start(m_pConfig->directoryAddress.c_str(), m_pConfig->busPort, m_pConfig->linkSecret);
+	SetupBus();
+	m_admin.SetBus(& m_bus);
+
+	// ʱӵδշϢһ߳select ȴһδʱ
+	long long nextTickMs = m_pClock->NowMs() + m_tickMs;
+	long long nextConfigCheckMs = m_pClock->NowMs() + WHEATTCP_CONFIG_CHECK_MS;
 
 	while(1) {
-		fd_set fdTemp = fd;
+		fd_set fdTemp = m_fd;
+		fd_set fdWrite;
+		FD_ZERO(&fdWrite);
+
+		// ỰûȡһϢȲںûӲŹĿд¼
+		for(int i = 0; i <= m_fdMax; i++) {
+			if(i == m_socket || i == m_wsSocket || i == m_tlsSocket || i == m_spectatorSocket || FD_ISSET(i, &m_fd) == false) {
+				continue;
+			}
+			// ֵ WebSocket ûлỰҪ
+			auto itWebSocket = m_webSockets.find(i);
+			if(itWebSocket != m_webSockets.end() && itWebSocket->second.handshakeDone == false) {
+				continue;
+			}
+			if(m_sessions.WantsRead(i) == false) {
+				FD_CLR(i, &fdTemp);
+			}
+		}
+		for(auto & pair : m_pendingSends) {
+			if(pair.second.overflowed == false) {
+				FD_SET(pair.first, &fdWrite);
+			}
+		}
+
+		m_admin.AddToFdSet(&fdTemp);
+		m_directoryAgent.AddToFdSet(&fdTemp);
+		m_gatewayHub.AddToFdSet(&fdTemp);
+		m_bus.AddToFdSet(&fdTemp, &fdWrite);
 		
+		// TLS Ͻ⿪ûȡߵ select ѣеĻ select ȴһȦ˵
+		bool tlsPending = false;
+		for(auto & pair : m_tlsConnections) {
+			if(WheatTls::HasPlain(pair.second)) {
+				tlsPending = true;
+				break;
+			}
+		}
+
 		timeval tm;
-		tm.tv_sec = 10;
-		tm.tv_usec = 0;
+		// tv_usec Сһ룬tick_ms 䵽 1000ĲַŽ tv_sec
+		long long waitMs = tlsPending ? 0 : m_tickMs;
+		tm.tv_sec = static_cast<long>(waitMs / 1000);
+		tm.tv_usec = static_cast<long>((waitMs % 1000) * 1000);
 		
-		int selectRes = select(fdMax, &fdTemp, NULL, NULL, &tm);
+		long long waitStartNs = m_pClock->NowNs();
+		int selectRes = select(m_fdMax, &fdTemp, &fdWrite, NULL, &tm);
+		long long busyStartNs = m_pClock->NowNs();
+
+		if(m_pClock->NowMs() >= nextTickMs) {
+			m_governor.RecordTickLag(m_pClock->NowMs() - nextTickMs);
+			m_room.Tick();
+			m_sessions.Tick();
+			ExpireHandshakes();
+			m_directoryAgent.Tick(m_admission.GetConnectionNum(), m_admission.GetMaxConnections());
+			m_bus.Tick();
+			nextTickMs = m_pClock->NowMs() + m_tickMs;
+		}
+
+		// ļĹĻȸµЧ
+		if(m_pClock->NowMs() >= nextConfigCheckMs) {
+			if(m_pConfig->ReloadIfChanged()) {
+				ApplyConfig();
+			}
+			nextConfigCheckMs = m_pClock->NowMs() + WHEATTCP_CONFIG_CHECK_MS;
+		}
+
+		// Աշִ֮Уķģ˿ڵ socket ֵྭԼ
+		if(selectRes <= 0) {
+			FD_ZERO(&fdTemp);
+			FD_ZERO(&fdWrite);
+		}
+		m_admin.Poll(&fdTemp);
+		m_directoryAgent.Poll(&fdTemp);
+		m_gatewayHub.Poll(&fdTemp);
+		m_bus.Poll(&fdTemp, &fdWrite);
 		
 		// printf("selectRes = %d\n", selectRes);
 		// printf("FD_ISSET = %d\n", FD_ISSET(m_socket, &fdTemp));
 		
-		if(selectRes > 0) {
+		if(selectRes > 0 || tlsPending) {
 			if(FD_ISSET(m_socket, &fdTemp)) {
-				sockaddr_in clientAddr;
-				int len = sizeof(sockaddr_in);
-
-				SOCKET clientSocket = accept(m_socket, (sockaddr *)& clientAddr, &len);
-				
-				FD_SET(clientSocket, &fd);
-				fdMax = MAX(fdMax, static_cast<int>(clientSocket));
+				AcceptClient(m_socket, false, false, false);
+			}
+			if(m_wsSocket != INVALID_SOCKET && FD_ISSET(m_wsSocket, &fdTemp)) {
+				AcceptClient(m_wsSocket, true, m_pConfig->websocketTls, false);
+			}
+			if(m_tlsSocket != INVALID_SOCKET && FD_ISSET(m_tlsSocket, &fdTemp)) {
+				AcceptClient(m_tlsSocket, false, true, false);
+			}
+			if(m_spectatorSocket != INVALID_SOCKET && FD_ISSET(m_spectatorSocket, &fdTemp)) {
+				AcceptClient(m_spectatorSocket, false, false, true);
+			}
 
-				printf("New Client %lld Joined  %s:%d\n", clientSocket, inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port));
+			for(int i = 0; i <= m_fdMax; i++) {
+				if(i == m_socket || i == m_wsSocket || i == m_tlsSocket || i == m_spectatorSocket) {
+					continue;
+				}
 
-				int newSleeperId = m_bedManager.RegisterNewSleeper(Sleeper(clientSocket));
+				if(FD_ISSET(i, &fdWrite)) {
+					FlushPending(i);
+				}
 
-				// ¼IPַ
-				m_bedManager.m_sleepers[newSleeperId].IPADDRESS = inet_ntoa(clientAddr.sin_addr);
-				
-				SendCommand(clientSocket, newSleeperId, WheatCommand(WheatCommandType::yourid, "", newSleeperId, 0));
-				SendCommandToFdSet(fd, fdMax, newSleeperId, WheatCommand(WheatCommandType::sleeper, "", newSleeperId, 0), clientSocket);
+				bool readable = FD_ISSET(i, &fdTemp);
+				if(readable == false && tlsPending) {
+					readable = HasTlsPlain(i);
+				}
 
-				std::vector<WheatCommand> originalSleepersCommands;
-				std::vector<int> originalSleepersIds;
-				for(int iSleeperId = 0; iSleeperId < m_bedManager.m_sleepers.size(); iSleeperId++) {
-					if(m_bedManager.m_sleepers[iSleeperId].empty == false && iSleeperId != newSleeperId) {
-						m_pCommandProgrammer->VectorPushBackOriginalSleepersData(& originalSleepersIds, & originalSleepersCommands, m_bedManager, iSleeperId);
+				if(readable && m_webSockets.empty() == false) {
+					auto itWebSocket = m_webSockets.find(i);
+					if(itWebSocket != m_webSockets.end()) {
+						ReceiveWebSocket(i, itWebSocket->second);
+						continue;
 					}
 				}
-				SendMultiCommand(clientSocket, originalSleepersIds, originalSleepersCommands);
-
 
-				if(selectRes <= 1) {
-					continue;
-				}
-			}
-			
-			for(int i = 0; i <= fdMax; i++) {
-				if(i == m_socket) {
-					continue;
-				}
+				if(readable) {
+					// ֱյỰĽջһοյüϢɷ֡Աһҳ
+					size_t freeLen = 0;
+					char * buf = m_sessions.GetRecvBuffer(i, &freeLen);
+					if(buf == nullptr) {
+						continue;
+					}
 
-				if(FD_ISSET(i, &fdTemp)) {
-					char buf[WHEATTCP_BUFFERSIZE];
-					memset(buf, 0, WHEATTCP_BUFFERSIZE);
-					int recvRes = recv(i, buf, sizeof(buf) - 1, 0);
+					int recvRes = ReadSocket(i, buf, freeLen);
+					if(recvRes == WHEATTLS_WOULD_BLOCK) {
+						continue;
+					}
 					if(recvRes == SOCKET_ERROR || recvRes == 0) {
-						CloseClient(i, &fd, fdMax);
+						m_sessions.Hangup(i);
 					} else {
-						// SendMessageToFdSet(fd, fdMax, buf, sizeof(buf));
-
 #ifdef  _DEBUG
-						printf("Client %d : %s\n", i, buf);
+						printf("Client %d : %.*s\n", i, recvRes, buf);
 #endif //  _DEBUG
 
-						WheatCommand command = m_pCommandProgrammer->Parse(buf);
-						
-						int whoSleeperId = m_bedManager.FindSleeperId(i);
-
-						if(whoSleeperId < 0 || whoSleeperId >= m_bedManager.m_sleepers.size()) {
-							command.type = WheatCommandType::unknown;
-						}
-
-#pragma region Commands Double Check
-
-						switch(command.type) {
-							case WheatCommandType::unknown:
-								printf("Client %d : %s\n", i, buf);
-								printf("%d Unknown Command! SKIP!\n", i);
-								continue;
-								break;
-
-							case WheatCommandType::name:
-								m_bedManager.m_sleepers[whoSleeperId].name = command.strParam;
-								printf("Client %d : %s\n", i, buf);
-								wheatChatRecorder.Record(m_bedManager.m_sleepers[whoSleeperId].IPADDRESS, m_bedManager.m_sleepers[whoSleeperId].name);
-
-								break;
-							case WheatCommandType::type:
-								m_bedManager.m_sleepers[whoSleeperId].type = m_bedManager.GetSleeperType(command.nParam[0]);
-								break;
-
-							case WheatCommandType::sleep:
-							{
-								// ж˯û˯У
-								Sleeper * whoSleep = m_bedManager.GetSleeper(m_bedManager.FindSleeperId(i));
-								if(whoSleep->sleepingBedId != -1) {
-									printf("Sleeper %d Is Sleeping!\n", whoSleep->sleepingBedId);
-									continue;
-								}
-
-								// Խ λid
-								if(command.nParam[0] >= BED_NUM || command.nParam[0] < 0) {
-									printf("Wrong Bed Id!! %d\n", command.nParam[0]);
-									continue;
-								}
-
-								// жϴλǷΪ
-								Bed * pBedTemp = m_bedManager.GetBed(command.nParam[0]);
-								if(!pBedTemp->Empty()) {
-									printf("Bed Is Not Empty. %d Can Not Sleep.\n", i);
-									continue;
-								} else {
-									printf("%d Sleep On Bed Which Is BedSleepId = %d\n", i, command.nParam[0]);
-									pBedTemp->Set(false, whoSleep);
-									m_bedManager.m_sleepers[whoSleeperId].sleepingBedId = command.nParam[0];
-								}
-							}
-							break;
-							case WheatCommandType::getup:
-								// Ƿ˯Уżִ
-								if(m_bedManager.m_sleepers[whoSleeperId].sleepingBedId != -1) {
-									m_bedManager.GetupBed(m_bedManager.m_sleepers[whoSleeperId].sleepingBedId);
-									m_bedManager.m_sleepers[whoSleeperId].sleepingBedId = -1;
-								}
-								break;
-
-							case WheatCommandType::chat:
-								printf("Client %d : %s\n", i, buf);
-								wheatChatRecorder.Record((m_bedManager.m_sleepers[whoSleeperId].IPADDRESS + "_" + m_bedManager.m_sleepers[whoSleeperId].name + "}:=>"), command.strParam);
-								break;
-
-							case WheatCommandType::move:
-								m_bedManager.m_sleepers[whoSleeperId].moveLastData = Vec2<int>(command.nParam[0], command.nParam[1]);
-								m_bedManager.m_sleepers[whoSleeperId].firstMoved = true;
-								break;
-							case WheatCommandType::pos:
-								m_bedManager.m_sleepers[whoSleeperId].posLastData = Vec2<int>(command.nParam[0], command.nParam[1]);
-								break;
-
-							case WheatCommandType::kick:
-								if(m_voteKick.IsVoting()) {
-									continue;
-									break;
-								}
-								
-								m_voteKick.Init(static_cast<int>(m_bedManager.m_sleepers.size()), command.nParam[0]);
-								m_voteKick.SetIsVoting(true);
-
-								break;
-							case WheatCommandType::agree:
-								if(m_voteKick.AddAgree(whoSleeperId) == false) {
-									continue;
-									break;
-								}
-								m_voteKick.GetVoteAnswer(&command.nParam[0], &command.nParam[1]);
-								break;
-							case WheatCommandType::refuse:
-								if(m_voteKick.AddRefuse(whoSleeperId) == false) {
-									continue;
-									break;
-								}
-								m_voteKick.GetVoteAnswer(&command.nParam[0], &command.nParam[1]);
-								break;
-							case WheatCommandType::kickover:
-								continue;
-								break;
-						}
-
-#pragma endregion
-
-						// m_pCommandProgrammer->PrintWheatCommand(command);
-
-						SendCommandToFdSet(fd, fdMax, whoSleeperId, command);
-
+						m_sessions.CommitRecv(i, recvRes);
 					}
 				}
 			}
 		}
-	}
-}
 
-void WheatTCPServer::SendCommand(SOCKET destSocket, int sleeperIdWhoMakeThisCommand, const WheatCommand& command)
-{
-	int & sleeperId = sleeperIdWhoMakeThisCommand;
-	std::string strSleeperId = "";
-	std::string strMessage = "";
-	size_t bufSendSize = 0;
-	char * bufSend = nullptr;
+		size_t readyNum = m_sessions.GetReadyNum();
+		m_sessions.RunReady();
+
+		// ˯ڱĽڵ
+		if(m_bus.IsConnected() && m_pClock->NowMs() >= m_nextPresenceMs) {
+			std::string presence = m_nodeName;
+			presence.push_back('\0');
+			presence += std::to_string(m_room.GetSleeperNum());
+			m_bus.Publish(WHEATBUS_TOPIC_PRESENCE_PREFIX + m_pConfig->roomName, presence.data(), presence.size());
+			m_nextPresenceMs = m_pClock->NowMs() + WHEATTCP_PRESENCE_MS;
+		}
 
-	strSleeperId = std::to_string(sleeperId);
-	strMessage = m_pCommandProgrammer->MakeMessage(command);
+		// һȦǱ˯͵ϢϵϢ·ϣһηȥ
+		m_gatewayHub.Flush();
+		m_bus.Flush();
 
-	bufSendSize = strSleeperId.length() + 1 + strMessage.length() + 1;
+		//  TLS ˯͵ϢҲһȦһΣ㲥ʱÿ˯ֻһߺټTLS ¼
+		for(auto & pair : m_tlsConnections) {
+			if(m_tls.Flush(pair.second, pair.first) == false) {
+				m_sessions.Hangup(pair.first);
+			}
+		}
 
-	bufSend = new char[bufSendSize];
+		// һȦõʱȫϣһȦʱֿĵַظʹãӺ WebSocket ֡ͷǷҲ
+		m_room.EndLoopIteration();
+		m_loopIteration++;
 
-	BufferCatenate(bufSend, strSleeperId.c_str(), strSleeperId.length(), strMessage.c_str(), strMessage.length());
+		// һȦæ˶üǸԱŵ
+		m_governor.RecordIteration(busyStartNs - waitStartNs, m_pClock->NowNs() - busyStartNs, readyNum);
+		if(m_governor.Update()) {
+			ApplyLoadLevel();
+		}
+	}
+}
 
-	send(destSocket, bufSend, int(bufSendSize), 0);
+bool WheatTCPServer::Send(SOCKET destSocket, const char * buf, size_t len)
+{
+	if(m_gatewayHub.Owns(destSocket)) {
+		return m_gatewayHub.Send(destSocket, buf, len);
+	}
 
-	printf("%s %s, Socket = %zd\n", bufSend, bufSend + 2, destSocket);
+	if(m_webSockets.empty() == false && m_webSockets.count(destSocket) != 0) {
+		return SendWebSocket(destSocket, buf, len);
+	}
 
-	delete [] bufSend;
-	bufSend = nullptr;
+	return SendRaw(destSocket, buf, len);
 }
 
-void WheatTCPServer::SendCommandToFdSet(fd_set destFdSet, int fdMax, int sleeperIdWhoMakeThisCommand, const WheatCommand& command, SOCKET skipSocket)
+bool WheatTCPServer::SendRaw(SOCKET sock, const char * buf, size_t len)
 {
-	int & sleeperId = sleeperIdWhoMakeThisCommand;
-	std::string strSleeperId = "";
-	std::string strMessage = "";
-	size_t bufSendSize = 0;
-	char * bufSend = nullptr;
+	if(m_tlsConnections.empty() == false) {
+		auto it = m_tlsConnections.find(sock);
+		if(it != m_tlsConnections.end()) {
+			m_tls.Queue(it->second, buf, len);
+			return true;
+		}
+	}
 
-	strSleeperId = std::to_string(sleeperId);
-	strMessage = m_pCommandProgrammer->MakeMessage(command);
+	return WriteSocket(sock, buf, len);
+}
 
-	bufSendSize = strSleeperId.length() + 1 + strMessage.length() + 1;
+bool WheatTCPServer::WriteSocket(SOCKET sock, const char * buf, size_t len)
+{
+	// ǰ滹ûľֻں棬ȻԷյֽڻҵ
+	auto it = m_pendingSends.find(sock);
+	size_t sentLen = 0;
+	if(it == m_pendingSends.end()) {
+		int sendRes = send(sock, buf, int(len), 0);
+		if(sendRes == SOCKET_ERROR) {
+			if(WSAGetLastError() != WSAEWOULDBLOCK) {
+				// ȥ˵Ѿˣ类Էãص recv ֱ֣ûỰʰ뿪
+				printf("Client %lld Send Error %d.\n", sock, WSAGetLastError());
+				m_sessions.Hangup(sock);
+				return false;
+			}
+			sendRes = 0;
+		}
+		sentLen = sendRes;
+		if(sentLen == len) {
+			return true;
+		}
+		it = m_pendingSends.emplace(sock, PendingSend()).first;
+	}
 
-	bufSend = new char[bufSendSize];
+	PendingSend & pending = it->second;
+	if(pending.overflowed) {
+		return false;
+	}
+	if(pending.data.size() - pending.sentLen + len - sentLen > WHEATTCP_MAX_PENDING_BYTES) {
+		// ֻӵһһϢͻ˿ķͲˣֻߣ֮ǰѾŵҲ
+		printf("Client %lld Too Slow, %zu Bytes Pending.\n", sock, pending.data.size() - pending.sentLen);
+		pending.overflowed = true;
+		m_room.m_metrics.m_connectionStats.slowClients++;
+		m_sessions.Hangup(sock);
+		return false;
+	}
+	pending.data.append(buf + sentLen, len - sentLen);
+	return true;
+}
 
-	BufferCatenate(bufSend, strSleeperId.c_str(), strSleeperId.length(), strMessage.c_str(), strMessage.length());
+void WheatTCPServer::FlushPending(SOCKET sock)
+{
+	auto it = m_pendingSends.find(sock);
+	if(it == m_pendingSends.end() || it->second.overflowed) {
+		return;
+	}
 
-	SendBufferToFdSet(destFdSet, fdMax, bufSend, bufSendSize, skipSocket);
+	PendingSend & pending = it->second;
+	while(pending.sentLen < pending.data.size()) {
+		int sendRes = send(sock, pending.data.data() + pending.sentLen, int(pending.data.size() - pending.sentLen), 0);
+		if(sendRes == SOCKET_ERROR) {
+			if(WSAGetLastError() == WSAEWOULDBLOCK) {
+				return;
+			}
+			printf("Client %lld Send Error %d.\n", sock, WSAGetLastError());
+			pending.overflowed = true;
+			m_sessions.Hangup(sock);
+			return;
+		}
+		pending.sentLen += sendRes;
+	}
 
-	delete [] bufSend;
-	bufSend = nullptr;
+	// ˣֱֿ֮ӷ
+	m_pendingSends.erase(it);
 }
 
-void WheatTCPServer::SendMultiCommand(SOCKET destSocket, std::vector<int> & sleeperIdWhoMakeTheseCommands, const std::vector<WheatCommand>& commands)
+int WheatTCPServer::ReadSocket(SOCKET sock, char * buf, size_t len)
 {
-	std::vector<int> & sleeperIds = sleeperIdWhoMakeTheseCommands;
-	std::string strSleeperId = "";
-	std::string strMessage = "";
-	size_t bufSendSize = 0;
-	size_t bufCatenateOffset = 0;
-	size_t strLen = 0;
-	char * bufSend = nullptr; // = new char[20000];
-	char * bufTemp;
-	
-	for(int i = 0; i < commands.size(); i++) {
-		strSleeperId = std::to_string(sleeperIds[i]);
-		strMessage = m_pCommandProgrammer->MakeMessage(commands[i]);
-		strLen = strSleeperId.length() + 1 + strMessage.length() + 1;
-
-		bufCatenateOffset = bufSendSize;
-
-		bufSendSize += strLen;
-
-		// bufTemp 洢ǰ˴һϢstrSleeperId  strMessage
-		bufTemp = new char[strLen];
-
-		// BufferCatenate(bufSend, bufCatenateOffset, strSleeperId.c_str(), strSleeperId.length(), strMessage.c_str(), strMessage.length());
-		BufferCatenate(bufTemp, 0, strSleeperId.c_str(), strSleeperId.length(), strMessage.c_str(), strMessage.length());
-
-		// bufSend
-		char * bufSave = new char[bufCatenateOffset];
-		memcpy(bufSave, bufSend, bufCatenateOffset);
-		
-		// ɾɵbufSendµ
-		if(bufSend != nullptr)
-			delete [] bufSend;
-		bufSend = new char[bufSendSize];
+	if(m_tlsConnections.empty() == false) {
+		auto it = m_tlsConnections.find(sock);
+		if(it != m_tlsConnections.end()) {
+			return m_tls.Read(it->second, sock, buf, len);
+		}
+	}
+	int recvRes = recv(sock, buf, int(len), 0);
+	if(recvRes == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+		return WHEATTLS_WOULD_BLOCK;
+	}
+	return recvRes;
+}
 
-		// ǰ洢ľɵ bufSend 
-		memcpy(bufSend, bufSave, bufCatenateOffset);
+bool WheatTCPServer::HasTlsPlain(SOCKET sock)
+{
+	auto it = m_tlsConnections.find(sock);
+	return it != m_tlsConnections.end() && WheatTls::HasPlain(it->second);
+}
 
-		// ǰƴ϶ɵ bufTemp 
-		memcpy(bufSend + bufCatenateOffset, bufTemp, strLen);
+bool WheatTCPServer::Disconnect(SOCKET sock)
+{
+	if(m_gatewayHub.Owns(sock)) {
+		return m_gatewayHub.Disconnect(sock);
+	}
 
-		//  bufTemp  bufSave
-		delete [] bufSave;
-		delete [] bufTemp;
+	if(FD_ISSET(sock, &m_fd) == false) {
+		return false;
 	}
 
-	if(bufSend != nullptr) {
-		send(destSocket, bufSend, int(bufSendSize), 0);
+	// ֮ǰŵϢ类ߵԭ򣩼ܷȥںղµľˣΪһҪߵӵ
+	auto itTls = m_tlsConnections.find(sock);
+	if(itTls != m_tlsConnections.end()) {
+		m_tls.Flush(itTls->second, sock);
+		m_tls.Release(itTls->second);
+		m_tlsConnections.erase(itTls);
+	}
+	FlushPending(sock);
+	m_pendingSends.erase(sock);
+
+	closesocket(sock);
+	FD_CLR(sock, &m_fd);
 
-		delete [] bufSend;
-		bufSend = nullptr;
+	//  socket ˵Ļһ fd_set ѭٰ
+	if(static_cast<int>(sock) == m_fdMax) {
+		while(m_fdMax > static_cast<int>(m_socket) && FD_ISSET(m_fdMax, &m_fd) == false) {
+			m_fdMax--;
+		}
 	}
+
+	m_admission.Release(sock);
+	m_webSockets.erase(sock);
+	m_spectatorSockets.erase(sock);
+
+	// ֪ͨӵĻỰʰ뿪Ựһ RunReady() ʱsocket Ѿˣʱָܷµ
+	m_sessions.Hangup(sock, true);
+
+	printf("Client %lld Left.\n", sock);
+
+	return true;
 }
 
-void WheatTCPServer::BufferCatenate(char* destBuf, const char* buf1, size_t buf1Size, const char* buf2, size_t buf2Size)
+size_t WheatTCPServer::GetPendingSendBytes(SOCKET sock)
 {
-	memcpy(destBuf, buf1, buf1Size + 1);
-	memcpy(destBuf + buf1Size + 1, buf2, buf2Size + 1);
+	auto it = m_pendingSends.find(sock);
+	if(it == m_pendingSends.end()) {
+		return 0;
+	}
+	return it->second.data.size() - it->second.sentLen;
 }
 
-void WheatTCPServer::BufferCatenate(char * destBuf, size_t offset, const char * buf1, size_t buf1Size, const char * buf2, size_t buf2Size)
+void WheatTCPServer::ApplyConfig()
 {
-	memcpy(destBuf + offset, buf1, buf1Size + 1);
-	memcpy(destBuf + offset + buf1Size + 1, buf2, buf2Size + 1);
+	m_tickMs = m_pConfig->tickMs;
+	m_handshakeTimeoutMs = m_pConfig->handshakeTimeoutMs;
+
+	m_admission.SetLimits(m_pConfig->maxConnections, m_pConfig->maxConnectionsPerIP, m_pConfig->acceptsPerSecond, m_pConfig->acceptBurst);
+
+	m_room.SetHeartbeat(m_pConfig->heartbeatMs, m_pConfig->idleTimeoutMs);
+	m_room.SetVoteSeconds(m_pConfig->voteSeconds);
+	m_room.SetChatRadius(m_pConfig->chatRadius);
+	m_room.SetChatHistorySize(m_pConfig->chatHistorySize);
+
+	// ׷ӳҪ֪ÿϢʲôʱյ
+	m_room.m_tracer.SetSampleEvery(m_pConfig->latencySampleEvery);
+	m_sessions.SetRecvStamping(m_pConfig->latencySampleEvery > 0);
+
+	m_directoryAgent.SetRedirectPercent(m_pConfig->redirectPercent);
+
+	m_governor.SetBudget(m_pConfig->loopBudgetMs);
+	ApplyLoadLevel();
 }
 
-void WheatTCPServer::SendBufferToFdSet(fd_set inputFdSet, int fdMax, const char * str) {
-	SendBufferToFdSet(inputFdSet, fdMax, str, strlen(str));
+void WheatTCPServer::ApplyLoadLevel()
+{
+	int level = m_governor.GetLevel();
+
+	// ÿһںȺſļһͻ˰ tick$ ֵ
+	m_room.SetSpectatorInterval(static_cast<long long>(m_pConfig->spectatorIntervalMs) << level);
+	m_room.SetCrowd(m_pConfig->crowdThreshold, m_pConfig->crowdRadius, m_pConfig->crowdCellSize, static_cast<long long>(m_pConfig->crowdIntervalMs) << level);
+
+	// ҪĻͣ
+	m_room.m_metrics.m_handlerTiming = m_pConfig->handlerTiming && level == 0;
+	m_room.m_sendLog = level == 0;
+
+	// һУ٣ֻ˯ͣͻҪʶȺſȺģʽûʱã
+	m_room.SetCrowdForced(level >= WHEATGOVERNOR_MAX_LEVEL);
 }
 
-void WheatTCPServer::SendBufferToFdSet(fd_set inputFdSet, int fdMax, const char * str, size_t len, SOCKET skipSocket)
+void WheatTCPServer::SetupBus()
 {
-	for(int i = 0; i <= fdMax; i++) {
-		if(i == skipSocket || i == m_socket) {
-			continue;
+	if(m_bus.IsEnabled() == false) {
+		return;
+	}
+
+	m_nodeName = m_pConfig->nodeName.empty() ? m_pConfig->publicAddress + ":" + std::to_string(m_pConfig->port) : m_pConfig->nodeName;
+
+	// 췢ͬһڵ㣺"ڵ\0˯\0"
+	std::string chatTopic = WHEATBUS_TOPIC_CHAT_PREFIX + m_pConfig->roomName;
+	m_room.m_onChat = [this, chatTopic](const Sleeper & who, std::string_view text) {
+		std::string message = m_nodeName;
+		message.push_back('\0');
+		message += who.name;
+		message.push_back('\0');
+		message.append(text.data(), text.size());
+		m_bus.Publish(chatTopic, message.data(), message.size());
+	};
+
+	// Ľڵϵ֪ͨʽ˯ͣ"@ڵ: "
+	m_bus.Subscribe(chatTopic, [this](const char *, size_t, const char * payload, size_t len) {
+		const char * pName = static_cast<const char *>(memchr(payload, '\0', len));
+		const char * pText = pName == nullptr ? nullptr : static_cast<const char *>(memchr(pName + 1, '\0', payload + len - pName - 1));
+		if(pText == nullptr) {
+			return;
 		}
-		if(FD_ISSET(i, &inputFdSet)) {
-			send(i, str, int(len), 0);
+		std::string notice(pName + 1, pText);
+		notice += "@";
+		notice.append(payload, pName);
+		notice += ": ";
+		notice.append(pText + 1, payload + len);
+		m_room.SendNotice(notice.data(), notice.size());
+	});
+
+	m_bus.Subscribe(WHEATBUS_TOPIC_PRESENCE_PREFIX + m_pConfig->roomName, [this](const char *, size_t, const char * payload, size_t len) {
+		const char * pCount = static_cast<const char *>(memchr(payload, '\0', len));
+		if(pCount == nullptr) {
+			return;
+		}
+		m_room.SetRemoteSleeperNum(std::string(payload, pCount), atoi(std::string(pCount + 1, payload + len).c_str()));
+	});
+
+	m_bus.Subscribe(WHEATBUS_TOPIC_ANNOUNCE, [this](const char *, size_t, const char * payload, size_t len) {
+		m_room.SendNotice(payload, len);
+	});
+}
+
+void WheatTCPServer::AcceptClient(SOCKET listenSocket, bool webSocket, bool tls, bool spectator)
+{
+	sockaddr_in clientAddr;
+	int len = sizeof(sockaddr_in);
+
+	SOCKET clientSocket = accept(listenSocket, (sockaddr *)& clientAddr, &len);
+
+	// ܲܽţŵӲǼ˯ͣݣҲŷ˯
+	WheatAdmission::Result admission = WheatAdmission::Result::ServerFull;
+	if(clientSocket != INVALID_SOCKET) {
+		admission = m_admission.TryAdmit(clientSocket, clientAddr.sin_addr.S_un.S_addr);
+	}
+
+	// ԼˣѾˣĽڵ㻹пλĻ˯ȥ
+	// WebSocket  TLS ӻû֣redirect$  full$ ûžֱӶϿĽڵֻ˯͵Ķ˿ڣڲ
+	const WheatNodeInfo * pRedirectNode = nullptr;
+	if(webSocket == false && tls == false && spectator == false && (admission == WheatAdmission::Result::Admitted || admission == WheatAdmission::Result::ServerFull)) {
+		pRedirectNode = m_directoryAgent.FindRedirect(m_admission.GetConnectionNum(), m_admission.GetMaxConnections(), admission == WheatAdmission::Result::ServerFull);
+		if(pRedirectNode != nullptr && admission == WheatAdmission::Result::Admitted) {
+			m_admission.Release(clientSocket);
+		}
+	}
+
+	if(clientSocket == INVALID_SOCKET) {
+		printf("accept Error!! %d\n", WSAGetLastError());
+	} else if(pRedirectNode != nullptr) {
+		printf("Client %lld Redirected To %s:%d  %s:%d\n", clientSocket, pRedirectNode->host.c_str(), pRedirectNode->port, inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port));
+		RedirectClient(clientSocket, *pRedirectNode);
+	} else if(admission != WheatAdmission::Result::Admitted) {
+		printf("Client %lld Rejected  %s:%d\n", clientSocket, inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port));
+		if(webSocket || tls) {
+			closesocket(clientSocket);
+		} else {
+			RejectClient(clientSocket, admission);
+		}
+	} else {
+		//  TCP Էϵ硢ԺںҲܷѾ
+		// ļϵͳĬСʱʱķֿܼҵͿгʱ
+		BOOL keepAlive = TRUE;
+		setsockopt(clientSocket, SOL_SOCKET, SO_KEEPALIVE, (const char *)& keepAlive, sizeof(keepAlive));
+
+		// Էյʱ send ܿס¼ѭ m_pendingSends 
+		// ŵӻģfull$  redirect$ ֻһ϶Ͽ
+		u_long nonBlocking = 1;
+		ioctlsocket(clientSocket, FIONBIO, & nonBlocking);
+
+		FD_SET(clientSocket, &m_fd);
+		m_fdMax = MAX(m_fdMax, static_cast<int>(clientSocket));
+
+		printf("New %s%s%s %lld Joined  %s:%d\n", tls ? "TLS " : "", webSocket ? "WebSocket " : "", spectator ? "Spectator" : "Client", clientSocket, inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port));
+
+		if(spectator) {
+			m_spectatorSockets.insert(clientSocket);
+		}
+
+		// TLS ڵһζʱʼǰ䷢Ϣ
+		if(tls) {
+			m_tlsConnections[clientSocket] = WheatTlsConnection();
+		}
+
+		// WebSocket ֳɹԺſỰ
+		if(webSocket) {
+			WheatWebSocketConnection & connection = m_webSockets[clientSocket];
+			connection.ipAddress = inet_ntoa(clientAddr.sin_addr);
+			connection.acceptMs = m_pClock->NowMs();
+		} else {
+			m_sessions.Start(clientSocket, inet_ntoa(clientAddr.sin_addr));
+		}
+	}
+}
+
+void WheatTCPServer::ExpireHandshakes()
+{
+	if(m_webSockets.empty()) {
+		return;
+	}
+
+	// Disconnect()  m_webSocketsȼٶ
+	long long nowMs = m_pClock->NowMs();
+	std::vector<SOCKET> expiredSockets;
+	for(auto & pair : m_webSockets) {
+		if(pair.second.handshakeDone == false && nowMs - pair.second.acceptMs >= m_handshakeTimeoutMs) {
+			expiredSockets.push_back(pair.first);
 		}
 	}
+	for(SOCKET sock : expiredSockets) {
+		printf("Client %lld WebSocket Handshake Timeout.\n", sock);
+		m_room.m_metrics.m_connectionStats.handshakeTimeouts++;
+		Disconnect(sock);
+	}
 }
 
-void WheatTCPServer::CloseClient(SOCKET sock, fd_set * fdSet, int fdSetMax)
+void WheatTCPServer::ReceiveWebSocket(SOCKET sock, WheatWebSocketConnection & connection)
 {
-	if(FD_ISSET(sock, fdSet) == false) {
+	if(connection.handshakeDone == false) {
+		char buf[1024];
+		int recvRes = ReadSocket(sock, buf, sizeof(buf));
+		if(recvRes == WHEATTLS_WOULD_BLOCK) {
+			return;
+		}
+		if(recvRes == SOCKET_ERROR || recvRes == 0) {
+			Disconnect(sock);
+			return;
+		}
+		connection.request.append(buf, recvRes);
+
+		std::string response;
+		WheatWebSocket::HandshakeResult res = WheatWebSocket::Handshake(connection.request, & response);
+		if(res == WheatWebSocket::HandshakeResult::Bad) {
+			printf("Client %lld Bad WebSocket Handshake.\n", sock);
+			Disconnect(sock);
+		} else if(res == WheatWebSocket::HandshakeResult::Done) {
+			// ȵ 101 ظԺŻᷢϢ治֡
+			SendRaw(sock, response.data(), response.size());
+			connection.handshakeDone = true;
+			if(WheatWebSocket::GetPath(connection.request) == "/watch") {
+				m_spectatorSockets.insert(sock);
+			}
+			connection.request.clear();
+			connection.request.shrink_to_fit();
+			m_sessions.Start(sock, connection.ipAddress.c_str());
+		}
+		return;
+	}
+
+	size_t freeLen = 0;
+	char * buf = m_sessions.GetRecvBuffer(sock, & freeLen);
+	if(buf == nullptr) {
+		return;
+	}
+
+	// ϴһ֡ȷŻػͷյĽһ֡ŲµĻûٴ
+	size_t partialLen = connection.partial.size();
+	if(partialLen >= freeLen) {
+		printf("Client %lld WebSocket Frame Too Long.\n", sock);
+		// ỰѾˣҪ߷뿪ֻ socket
+		m_room.CloseClient(sock);
 		return;
 	}
+	if(partialLen > 0) {
+		memcpy(buf, connection.partial.data(), partialLen);
+	}
+
+	int recvRes = ReadSocket(sock, buf + partialLen, freeLen - partialLen);
+	if(recvRes == WHEATTLS_WOULD_BLOCK) {
+		return;
+	}
+	if(recvRes == SOCKET_ERROR || recvRes == 0) {
+		m_sessions.Hangup(sock);
+		return;
+	}
+
+	// ֡͵ؽ⿪ϢŲͷԭͻֱյֽһ
+	size_t consumed = 0;
+	std::string controlReply;
+	bool closed = false;
+	size_t len = WheatWebSocket::Decode(buf, partialLen + recvRes, m_sessions.GetRecvBufferSize() - WHEATWEBSOCKET_MAX_HEADER_SIZE - 4, & consumed, & controlReply, & closed);
+
+	connection.partial.clear();
+	if(closed == false) {
+		connection.partial.assign(buf + consumed, buf + partialLen + recvRes);
+	}
+	if(controlReply.empty() == false) {
+		SendRaw(sock, controlReply.data(), controlReply.size());
+	}
+
+#ifdef  _DEBUG
+	printf("Client %lld : %.*s\n", sock, int(len), buf);
+#endif //  _DEBUG
+
+	if(len > 0) {
+		m_sessions.CommitRecv(sock, len);
+	}
+	if(closed) {
+		m_sessions.Hangup(sock);
+	}
+}
+
+bool WheatTCPServer::SendWebSocket(SOCKET sock, const char * buf, size_t len)
+{
+	// 㲥ʱͬһڴ淢ÿ˯ֻͣڵһμ֡ͷ
+	bool cached = m_wsFrameSource == buf && m_wsFrameSourceLen == len && m_wsFrameIteration == m_loopIteration;
+	if(cached == false) {
+		m_wsFrame.resize(WHEATWEBSOCKET_MAX_HEADER_SIZE + len);
+		m_wsFrameHeaderLen = WheatWebSocket::WriteHeader(m_wsFrame.data(), len);
+		memcpy(m_wsFrame.data() + m_wsFrameHeaderLen, buf, len);
+		m_wsFrameSource = buf;
+		m_wsFrameSourceLen = len;
+		m_wsFrameIteration = m_loopIteration;
+	}
+
+	return SendRaw(sock, m_wsFrame.data(), m_wsFrameHeaderLen + len);
+}
+
+void WheatTCPServer::RejectClient(SOCKET sock, WheatAdmission::Result reason)
+{
+	// full$ ԭ򣬷ͷ ˯id д -1ӻû˯
+	WheatCommandProgrammer commandProgrammer;
+	WheatCommand command(WheatCommandType::full, "", static_cast<int>(reason), 0);
+
+	char frame[64];
+	size_t frameLen = commandProgrammer.WriteFrame(frame, -1, command);
+	send(sock, frame, int(frameLen), 0);
 
 	closesocket(sock);
-	FD_CLR(sock, fdSet);
+}
 
-	printf("Client %lld Left.\n", sock);
+void WheatTCPServer::RedirectClient(SOCKET sock, const WheatNodeInfo & node)
+{
+	// redirect$ַ:˿ڣͿͻ˵ ServerAddress.txt дһ
+	WheatCommandProgrammer commandProgrammer;
+	WheatCommand command(WheatCommandType::redirect, node.host.c_str(), node.port, 0);
 
-	int leaveSleeperId = m_bedManager.FindSleeperId(sock);
+	char frame[WHEATCOMMAND_INLINE_TEXT_SIZE + 64];
+	size_t frameLen = commandProgrammer.WriteFrame(frame, -1, command);
+	send(sock, frame, int(frameLen), 0);
 
-	if(leaveSleeperId < 0 || leaveSleeperId >= m_bedManager.m_sleepers.size()) {
-		printf("%d I Don't Know Who Left! SKIP!\n", leaveSleeperId);
-	} else {
-		SendCommandToFdSet(*fdSet, fdSetMax, leaveSleeperId, WheatCommand(WheatCommandType::leave, "", leaveSleeperId, 0));
+	closesocket(sock);
+}
+
+SOCKET WheatTCPServer::OpenListener(int port, const char * name)
+{
+	SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(sock == INVALID_SOCKET) {
+		printf("%s socket Error!! %d\n", name, WSAGetLastError());
+		return INVALID_SOCKET;
+	}
+
+	sockaddr_in address = m_address;
+	address.sin_port = htons(port);
+	if(bind(sock, (sockaddr *)& address, sizeof(SOCKADDR_IN)) == SOCKET_ERROR || listen(sock, SOMAXCONN) == SOCKET_ERROR) {
+		printf("%s bind/listen Error!! %d\n", name, WSAGetLastError());
+		closesocket(sock);
+		return INVALID_SOCKET;
 	}
-	m_bedManager.CancelSleeper(leaveSleeperId);
+
+	printf("%s Listening On Port %d.\n", name, port);
+	return sock;
 }
 
 bool WheatTCPServer::WSAStart() {
@@ -427,10 +807,16 @@ bool WheatTCPServer::SocketInit()
 	return true;
 }
 
-void WheatTCPServer::SetServerAddress(int port) {
+void WheatTCPServer::SetServerAddress(const char * ipAddress, int port) {
 	m_address.sin_family = AF_INET;
 	m_address.sin_port = htons(port);
-	m_address.sin_addr.S_un.S_addr = htonl(INADDR_ANY);
+	m_address.sin_addr.S_un.S_addr = inet_addr(ipAddress);
+
+	// д˵ĵַ 0.0.0.0ϼ
+	if(m_address.sin_addr.S_un.S_addr == INADDR_NONE) {
+		printf("Invalid Listen Address %s, Using 0.0.0.0.\n", ipAddress);
+		m_address.sin_addr.S_un.S_addr = htonl(INADDR_ANY);
+	}
 }
 
 bool WheatTCPServer::Bind()
@@ -5,58 +5,162 @@
 #include "WheatCommand.h"
 #include "WheatBedManager.h"
 #include "WheatVote.h"
+#include "WheatTransport.h"
+#include "WheatRoom.h"
+#include "WheatSession.h"
+#include "WheatAdmission.h"
+#include "WheatConfig.h"
+#include "WheatAdminConsole.h"
+#include "WheatDirectory.h"
+#include "WheatGatewayHub.h"
+#include "WheatBus.h"
+#include "WheatWebSocket.h"
+#include "WheatTls.h"
+#include "WheatGovernor.h"
 
 #include <winsock.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 // TCPԱڱ˾TCPЭݴרŴ˯ǵ󣬲˯ǺڲԱ
 // պѷ *޿*鲻̫ãܻһЩBUG
-class WheatTCPServer {
+// ֻ socket շÿӶỰԱ(WheatSessionScheduler)һỰ˯ǵָɷܼ(WheatRoom)
+class WheatTCPServer : public WheatTransport {
 public:
 	WheatTCPServer() {};
 	WheatTCPServer(int port) { Init(port); };
+	// ţ main УԱʱᶨڼļûбĹ
+	WheatTCPServer(WheatConfig * pConfig) { Init(pConfig); };
 	// virtual ~WheatTCPServer();
 
 	bool Init(int port);
+	bool Init(WheatConfig * pConfig);
 	void CloseServer();
 
 	void Run();
 
+	bool Send(SOCKET destSocket, const char * buf, size_t len) override;
+	bool Disconnect(SOCKET sock) override;
+
+	// ںղ¡ŷӵֽԱ鿴ѹʱ
+	size_t GetPendingSendBytes(SOCKET sock);
+
 private:
 
-	WheatVote m_voteKick;
+	WheatClock * m_pClock = GetSystemClock();
+
+	WheatRoom m_room{ this, m_pClock };
+
+	WheatSessionScheduler m_sessions{ m_pClock };
+
+	// Ҫλøõ socket WebSocketTLS ͹ڵģ˿ڡϵ̨õ socketϢߺ·
+	WheatAdmission m_admission{ m_pClock, FD_SETSIZE - 1 - 1 - 1 - 1 - (1 + WHEATADMIN_MAX_CLIENTS) - 1 - 1 - (1 + WHEATGATEWAYHUB_MAX_LINKS) };
+
+	WheatDirectoryAgent m_directoryAgent{ m_pClock };
 
-	// ָ
-	// destSocket				Ŀͻ˵ Socket
-	// sleeperIdWhoMakeThisCommand	дָ˯͵ ˯Id
-	void SendCommand(SOCKET destSocket, int sleeperIdWhoMakeThisCommand, const WheatCommand & command);
-	void SendCommandToFdSet(fd_set destFdSet, int fdMax, int sleeperIdWhoMakeThisCommand, const WheatCommand & command, SOCKET skipSocket = -1);
+	// ͱĽڵ㻥ͨϢͬһ졢ڵ˯ȫ
+	WheatBusClient m_bus{ m_pClock };
+	std::string m_nodeName;
+	long long m_nextPresenceMs = 0;
 
-	// ָϰһη
-	void SendMultiCommand(SOCKET destSocket, std::vector<int> & sleeperIdWhoMakeTheseCommands, const std::vector<WheatCommand> & command);
+	// ıڵĵĻ⣬ѷӵ
+	void SetupBus();
 
-	//  buf һµ bufм '\0' ָ
-	void BufferCatenate(char * destBuf, const char * buf1, size_t buf1Size, const char * buf2, size_t buf2Size);
-	void BufferCatenate(char * destBuf, size_t offset, const char * buf1, size_t buf1Size, const char * buf2, size_t buf2Size);
+	// ת˯Ͳռ select λãҲٹһأѾˣ
+	WheatGatewayHub m_gatewayHub{ & m_sessions };
 
-	void SendBufferToFdSet(fd_set inputFdSet, int fdMax, const char * str);
-	void SendBufferToFdSet(fd_set inputFdSet, int fdMax, const char * str, size_t len, SOCKET skipSocket = -1);
+	WheatAdminConsole m_admin{ & m_room, & m_sessions, & m_admission };
 
-	// Ͽĳһͻ
-	void CloseClient(SOCKET sock, fd_set * fdSet, int fdSetMax);
+	// ûõĻһĬϵ
+	WheatConfig m_defaultConfig;
+	WheatConfig * m_pConfig = & m_defaultConfig;
 
+	// ʱӵδļλ 
+	long long m_tickMs = 10;
+	// WebSocket Ӷûû־ͶϿλ 
+	long long m_handshakeTimeoutMs = 10000;
+
+	// Ա¼ѭæµ̶ȣæʱ
+	WheatGovernor m_governor{ m_pClock };
+
+	// ȸµλԱʱļĹԺ
+	void ApplyConfig();
+	// ԱļõĻϵƵʺҪҪЩҪĻñ˻߼Ժ
+	void ApplyLoadLevel();
+
+	fd_set m_fd;
+	int m_fdMax = 0;
 
 	WSADATA m_WSAData;
 	SOCKET m_socket;
 	sockaddr_in m_address;
 
-	WheatCommandProgrammer * m_pCommandProgrammer = nullptr;
-
-	WheatBedManager m_bedManager;
+	// ˯ʹ˿ڽԺͨһỰԱֻշʱҪװ WebSocket ֡
+	SOCKET m_wsSocket = INVALID_SOCKET;
+	std::unordered_map<SOCKET, WheatWebSocketConnection> m_webSockets;
+
+	// 㲥ʱͬһϢҪܶ WebSocket ˯ͣӺ֡ͷǷŸһ˯ֱ
+	// ䷢ϢһȦʱֿͬһȦ (ַ, ) һͬһٱݣȦ˾
+	unsigned long long m_loopIteration = 0;
+	const char * m_wsFrameSource = nullptr;
+	size_t m_wsFrameSourceLen = 0;
+	unsigned long long m_wsFrameIteration = 0;
+	size_t m_wsFrameHeaderLen = 0;
+	std::vector<char> m_wsFrame;
+
+	// ܵӴ TLS ˿ڽWebSocket ˿ҲҪܣշȾ TLS
+	WheatTls m_tls{ m_pClock };
+	SOCKET m_tlsSocket = INVALID_SOCKET;
+	std::unordered_map<SOCKET, WheatTlsConnection> m_tlsConnections;
+
+	//  listen_address һ˿ϼʧܷ INVALID_SOCKET
+	SOCKET OpenListener(int port, const char * name);
+
+	// ڴ˿ڽĹ WebSocket ˿ڵ /watchỰܵǹڵ
+	SOCKET m_spectatorSocket = INVALID_SOCKET;
+	std::unordered_set<SOCKET> m_spectatorSockets;
+
+	// ӴһӣwebSocket Ϊ true ʱȵ֣tls Ϊ true ʱշҪܣspectator Ϊ true ʱǹ
+	void AcceptClient(SOCKET listenSocket, bool webSocket, bool tls, bool spectator);
+
+	// ϶ݣ÷ recv һTLS Ӷǽ⿪ģûĿɶʱ WHEATTLS_WOULD_BLOCK
+	int ReadSocket(SOCKET sock, char * buf, size_t len);
+	// дݣTLS ţһȦʱһܷȥ
+	bool SendRaw(SOCKET sock, const char * buf, size_t len);
+
+	// ˯͵ socket Ƿģںһղµݰsocket дʱŷ
+	// ܹ WHEATTCP_MAX_PENDING_BYTES ˵Էյ̫ĻỰϿ֮󷢸ݶӵ
+	struct PendingSend {
+		std::string data;
+		size_t sentLen = 0;
+		bool overflowed = false;
+	};
+	std::unordered_map<SOCKET, PendingSend> m_pendingSends;
+
+	// ֽд socket ϣ TLSĲѾ˻̫ܵ෵ false
+	bool WriteSocket(SOCKET sock, const char * buf, size_t len);
+	// socket дˣŵݽŷȥ
+	void FlushPending(SOCKET sock);
+
+	//  TLS ϻн⿪ûȡߵ
+	bool HasTlsPlain(SOCKET sock);
+
+	//  WebSocket ϵݣûʱԺ֡⿪ŽỰĽջ
+	void ReceiveWebSocket(SOCKET sock, WheatWebSocketConnection & connection);
+	// ǰûлỰͿгʱܲɵδãϿԺ̫ûûֵӣȥ
+	void ExpireHandshakes();
+	bool SendWebSocket(SOCKET sock, const char * buf, size_t len);
+
+	// ܾһ accept ӣԭ(full$)Ժ϶Ͽ
+	void RejectClient(SOCKET sock, WheatAdmission::Result reason);
+
+	// һ accept һڵ(redirect$)Ȼ϶Ͽ
+	void RedirectClient(SOCKET sock, const WheatNodeInfo & node);
 
 	bool WSAStart();
 	bool SocketInit();
-	void SetServerAddress(int port);
+	void SetServerAddress(const char * ipAddress, int port);
 	bool Bind();
 	bool Listen();
 };
-
@@ -0,0 +1,317 @@
+#include "WheatTls.h"
+#include "ProjectCommon.h"
+#include "WheatMetrics.h"
+
+#include <cstring>
+#include <cstdio>
+
+#pragma comment(lib, "secur32.lib")
+#pragma comment(lib, "crypt32.lib")
+
+// ˶ÿ TLS ӵҪASC_REQ_ALLOCATE_MEMORY  Schannel Լֻظڴ
+#define WHEATTLS_CONTEXT_FLAGS (ASC_REQ_SEQUENCE_DETECT | ASC_REQ_REPLAY_DETECT | ASC_REQ_CONFIDENTIALITY | ASC_REQ_EXTENDED_ERROR | ASC_REQ_ALLOCATE_MEMORY | ASC_REQ_STREAM)
+
+WheatTls::~WheatTls()
+{
+	if(m_enabled) {
+		FreeCredentialsHandle(& m_credentials);
+	}
+	if(m_pCertificate != nullptr) {
+		CertFreeCertificateContext(m_pCertificate);
+	}
+	if(m_certificateStore != nullptr) {
+		CertCloseStore(m_certificateStore, 0);
+	}
+}
+
+bool WheatTls::Init(const char * certificatePath, const char * password, int sessionMinutes)
+{
+	FILE * file = fopen(certificatePath, "rb");
+	if(file == nullptr) {
+		printf("Open TLS Certificate %s Failed.\n", certificatePath);
+		return false;
+	}
+	std::vector<BYTE> pfx;
+	BYTE chunk[4096];
+	size_t readLen;
+	while((readLen = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		pfx.insert(pfx.end(), chunk, chunk + readLen);
+	}
+	fclose(file);
+
+	// PFX Ҫÿַ
+	int wideLen = MultiByteToWideChar(CP_UTF8, 0, password, -1, nullptr, 0);
+	std::wstring widePassword(MAX(wideLen, 1), L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, password, -1, & widePassword[0], wideLen);
+
+	CRYPT_DATA_BLOB blob;
+	blob.cbData = static_cast<DWORD>(pfx.size());
+	blob.pbData = pfx.data();
+	m_certificateStore = PFXImportCertStore(& blob, widePassword.c_str(), 0);
+	if(m_certificateStore == nullptr) {
+		printf("Import TLS Certificate %s Failed %lu.\n", certificatePath, GetLastError());
+		return false;
+	}
+	m_pCertificate = CertFindCertificateInStore(m_certificateStore, X509_ASN_ENCODING | PKCS_7_ASN_ENCODING, 0, CERT_FIND_ANY, nullptr, nullptr);
+	if(m_pCertificate == nullptr) {
+		printf("No Certificate In %s.\n", certificatePath);
+		return false;
+	}
+
+	SCHANNEL_CRED credentials;
+	memset(& credentials, 0, sizeof(credentials));
+	credentials.dwVersion = SCHANNEL_CRED_VERSION;
+	credentials.cCreds = 1;
+	credentials.paCred = & m_pCertificate;
+	credentials.grbitEnabledProtocols = SP_PROT_TLS1_2_SERVER;
+	credentials.dwSessionLifespan = static_cast<DWORD>(sessionMinutes) * 60 * 1000;
+	credentials.dwFlags = SCH_USE_STRONG_CRYPTO;
+
+	TimeStamp expiry;
+	SECURITY_STATUS status = AcquireCredentialsHandleA(nullptr, const_cast<char *>(UNISP_NAME_A), SECPKG_CRED_INBOUND, nullptr, & credentials, nullptr, nullptr, & m_credentials, & expiry);
+	if(status != SEC_E_OK) {
+		printf("AcquireCredentialsHandle Failed 0x%08lx.\n", static_cast<unsigned long>(status));
+		return false;
+	}
+
+	m_enabled = true;
+	printf("TLS Certificate %s Loaded.\n", certificatePath);
+	return true;
+}
+
+int WheatTls::Read(WheatTlsConnection & connection, SOCKET sock, char * buf, size_t len)
+{
+	if(HasPlain(connection) == false) {
+		if(connection.closed) {
+			return 0;
+		}
+
+		size_t oldSize = connection.inbound.size();
+		if(oldSize >= WHEATTLS_MAX_INBOUND_SIZE) {
+			return SOCKET_ERROR;
+		}
+		connection.inbound.resize(oldSize + WHEATTLS_RECV_SIZE);
+		int recvRes = recv(sock, connection.inbound.data() + oldSize, WHEATTLS_RECV_SIZE, 0);
+		if(recvRes == SOCKET_ERROR || recvRes == 0) {
+			connection.inbound.resize(oldSize);
+			if(recvRes == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+				return WHEATTLS_WOULD_BLOCK;
+			}
+			return recvRes;
+		}
+		connection.inbound.resize(oldSize + recvRes);
+
+		if(connection.handshakeDone == false && Handshake(connection, sock) == false) {
+			return SOCKET_ERROR;
+		}
+		if(connection.handshakeDone && Decrypt(connection) == false) {
+			return SOCKET_ERROR;
+		}
+		if(HasPlain(connection) == false) {
+			return connection.closed ? 0 : WHEATTLS_WOULD_BLOCK;
+		}
+	}
+
+	size_t plainLen = MIN(len, connection.plain.size() - connection.plainOffset);
+	memcpy(buf, connection.plain.data() + connection.plainOffset, plainLen);
+	connection.plainOffset += plainLen;
+	if(connection.plainOffset == connection.plain.size()) {
+		connection.plain.clear();
+		connection.plainOffset = 0;
+	}
+	return static_cast<int>(plainLen);
+}
+
+void WheatTls::Queue(WheatTlsConnection & connection, const char * buf, size_t len)
+{
+	connection.outbound.append(buf, len);
+	m_queuedMessages++;
+}
+
+bool WheatTls::Flush(WheatTlsConnection & connection, SOCKET sock)
+{
+	if(connection.handshakeDone == false || connection.outbound.empty()) {
+		return true;
+	}
+
+	long long startNs = m_pClock->NowNs();
+
+	// ŵİһ¼װпÿһξ͵ؼܣȦֻһ send
+	const SecPkgContext_StreamSizes & sizes = connection.sizes;
+	m_cipher.clear();
+	for(size_t offset = 0; offset < connection.outbound.size(); ) {
+		size_t len = MIN(connection.outbound.size() - offset, static_cast<size_t>(sizes.cbMaximumMessage));
+		size_t recordStart = m_cipher.size();
+		m_cipher.resize(recordStart + sizes.cbHeader + len + sizes.cbTrailer);
+		char * record = m_cipher.data() + recordStart;
+		memcpy(record + sizes.cbHeader, connection.outbound.data() + offset, len);
+
+		SecBuffer buffers[4];
+		buffers[0] = { sizes.cbHeader, SECBUFFER_STREAM_HEADER, record };
+		buffers[1] = { static_cast<unsigned long>(len), SECBUFFER_DATA, record + sizes.cbHeader };
+		buffers[2] = { sizes.cbTrailer, SECBUFFER_STREAM_TRAILER, record + sizes.cbHeader + len };
+		buffers[3] = { 0, SECBUFFER_EMPTY, nullptr };
+		SecBufferDesc desc = { SECBUFFER_VERSION, 4, buffers };
+		if(EncryptMessage(& connection.context, 0, & desc, 0) != SEC_E_OK) {
+			connection.outbound.clear();
+			return false;
+		}
+
+		m_cipher.resize(recordStart + buffers[0].cbBuffer + buffers[1].cbBuffer + buffers[2].cbBuffer);
+		offset += len;
+		m_encryptedRecords++;
+	}
+	m_encryptedBytes += connection.outbound.size();
+	connection.outbound.clear();
+	m_encryptNs += m_pClock->NowNs() - startNs;
+
+	return SendCipher(sock, m_cipher.data(), m_cipher.size());
+}
+
+bool WheatTls::SendCipher(SOCKET sock, const char * buf, size_t len)
+{
+	if(m_sender) {
+		return m_sender(sock, buf, len);
+	}
+	return send(sock, buf, int(len), 0) != SOCKET_ERROR;
+}
+
+void WheatTls::Release(WheatTlsConnection & connection)
+{
+	if(connection.contextValid) {
+		DeleteSecurityContext(& connection.context);
+		connection.contextValid = false;
+	}
+}
+
+void WheatTls::PrintStats(std::string * pOut)
+{
+	if(m_enabled == false) {
+		WheatPrintf(pOut, "TLS Disabled.\n");
+		return;
+	}
+
+	WheatPrintf(pOut, "Handshakes %llu, Resumed %llu, Failed %llu\n", m_handshakes, m_resumedHandshakes, m_failedHandshakes);
+	WheatPrintf(pOut, "Messages %llu In %llu Records, Encrypted %llu Bytes In %.3f ms (%.2f ns/byte)\n",
+		m_queuedMessages, m_encryptedRecords, m_encryptedBytes, m_encryptNs / 1e6, m_encryptedBytes > 0 ? double(m_encryptNs) / m_encryptedBytes : 0.0);
+	WheatPrintf(pOut, "Decrypted %llu Bytes In %.3f ms (%.2f ns/byte)\n",
+		m_decryptedBytes, m_decryptNs / 1e6, m_decryptedBytes > 0 ? double(m_decryptNs) / m_decryptedBytes : 0.0);
+}
+
+bool WheatTls::Handshake(WheatTlsConnection & connection, SOCKET sock)
+{
+	while(connection.inbound.empty() == false) {
+		SecBuffer inBuffers[2];
+		inBuffers[0] = { static_cast<unsigned long>(connection.inbound.size()), SECBUFFER_TOKEN, connection.inbound.data() };
+		inBuffers[1] = { 0, SECBUFFER_EMPTY, nullptr };
+		SecBufferDesc inDesc = { SECBUFFER_VERSION, 2, inBuffers };
+
+		SecBuffer outBuffers[2];
+		outBuffers[0] = { 0, SECBUFFER_TOKEN, nullptr };
+		outBuffers[1] = { 0, SECBUFFER_ALERT, nullptr };
+		SecBufferDesc outDesc = { SECBUFFER_VERSION, 2, outBuffers };
+
+		unsigned long attributes = 0;
+		TimeStamp expiry;
+		SECURITY_STATUS status = AcceptSecurityContext(& m_credentials, connection.contextValid ? & connection.context : nullptr, & inDesc,
+			WHEATTLS_CONTEXT_FLAGS, SECURITY_NATIVE_DREP, & connection.context, & outDesc, & attributes, & expiry);
+
+		// һϢû꣬´
+		if(status == SEC_E_INCOMPLETE_MESSAGE) {
+			return true;
+		}
+
+		if(status == SEC_E_OK || status == SEC_I_CONTINUE_NEEDED) {
+			connection.contextValid = true;
+		}
+
+		// ҪظԷݣʧʱһ澯ֱӷȥ
+		for(SecBuffer & buffer : outBuffers) {
+			if(buffer.pvBuffer != nullptr) {
+				if(buffer.cbBuffer > 0) {
+					SendCipher(sock, static_cast<const char *>(buffer.pvBuffer), buffer.cbBuffer);
+				}
+				FreeContextBuffer(buffer.pvBuffer);
+			}
+		}
+
+		if(FAILED(status)) {
+			m_failedHandshakes++;
+			return false;
+		}
+
+		// ûţһϢҲԺϷĵһ¼
+		if(inBuffers[1].BufferType == SECBUFFER_EXTRA && inBuffers[1].cbBuffer > 0) {
+			size_t extraLen = inBuffers[1].cbBuffer;
+			memmove(connection.inbound.data(), connection.inbound.data() + connection.inbound.size() - extraLen, extraLen);
+			connection.inbound.resize(extraLen);
+		} else {
+			connection.inbound.clear();
+		}
+
+		if(status == SEC_E_OK) {
+			connection.handshakeDone = true;
+			QueryContextAttributes(& connection.context, SECPKG_ATTR_STREAM_SIZES, & connection.sizes);
+
+			SecPkgContext_SessionInfo sessionInfo;
+			if(QueryContextAttributes(& connection.context, SECPKG_ATTR_SESSION_INFO, & sessionInfo) == SEC_E_OK && (sessionInfo.dwFlags & SSL_SESSION_RECONNECT) != 0) {
+				m_resumedHandshakes++;
+			}
+			m_handshakes++;
+			return true;
+		}
+	}
+	return true;
+}
+
+bool WheatTls::Decrypt(WheatTlsConnection & connection)
+{
+	long long startNs = m_pClock->NowNs();
+
+	while(connection.inbound.empty() == false && connection.closed == false) {
+		SecBuffer buffers[4];
+		buffers[0] = { static_cast<unsigned long>(connection.inbound.size()), SECBUFFER_DATA, connection.inbound.data() };
+		buffers[1] = { 0, SECBUFFER_EMPTY, nullptr };
+		buffers[2] = { 0, SECBUFFER_EMPTY, nullptr };
+		buffers[3] = { 0, SECBUFFER_EMPTY, nullptr };
+		SecBufferDesc desc = { SECBUFFER_VERSION, 4, buffers };
+
+		SECURITY_STATUS status = DecryptMessage(& connection.context, & desc, 0, nullptr);
+		if(status == SEC_E_INCOMPLETE_MESSAGE) {
+			break;
+		}
+		if(status == SEC_I_CONTEXT_EXPIRED) {
+			connection.closed = true;
+			break;
+		}
+		// Э̲֧֣
+		if(status != SEC_E_OK) {
+			return false;
+		}
+
+		// ľ inbound 棬ȿŲʣµ
+		SecBuffer * pData = nullptr;
+		SecBuffer * pExtra = nullptr;
+		for(int i = 1; i < 4; i++) {
+			if(buffers[i].BufferType == SECBUFFER_DATA) {
+				pData = & buffers[i];
+			} else if(buffers[i].BufferType == SECBUFFER_EXTRA) {
+				pExtra = & buffers[i];
+			}
+		}
+		if(pData != nullptr) {
+			connection.plain.append(static_cast<const char *>(pData->pvBuffer), pData->cbBuffer);
+			m_decryptedBytes += pData->cbBuffer;
+		}
+		if(pExtra != nullptr) {
+			size_t extraLen = pExtra->cbBuffer;
+			memmove(connection.inbound.data(), pExtra->pvBuffer, extraLen);
+			connection.inbound.resize(extraLen);
+		} else {
+			connection.inbound.clear();
+		}
+	}
+
+	m_decryptNs += m_pClock->NowNs() - startNs;
+	return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "WheatClock.h"
+
+#include <winsock.h>
+#define SECURITY_WIN32
+#include <wincrypt.h>
+#include <schannel.h>
+#include <security.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// һδ socket նֽڵģһ TLS ¼ 16K ļ֡ͷ֡βԴ
+#define WHEATTLS_RECV_SIZE (17 * 1024)
+
+// յ˻û⿪ֽܶڣ˵ԷֱӶϿ
+#define WHEATTLS_MAX_INBOUND_SIZE (64 * 1024)
+
+// Read() ûнģֻûɣһ¼û꣩ʱķֵ
+#define WHEATTLS_WOULD_BLOCK (-2)
+
+// һ TLS ӵ״ֵ̬ġһġûȡߵġһܷ͵
+struct WheatTlsConnection {
+	CtxtHandle context;
+	bool contextValid = false;
+	bool handshakeDone = false;
+	bool closed = false;		// Է close_notify
+	SecPkgContext_StreamSizes sizes;
+
+	std::vector<char> inbound;
+	std::string plain;
+	size_t plainOffset = 0;
+	std::string outbound;
+};
+
+// TLS ڣ˯ǵּܣõ Windows Դ Schannel
+// ˷ͬһ˯͵ϢһȦ¼ѭţһȦʱһܳɾٵ TLS ¼ٷȥ㲥ʱÿ˯ÿȦֻһ
+// ˯ͿԸ֮ǰ TLS Ự Schannel ĻỰ渺𣩣һ
+class WheatTls {
+public:
+	WheatTls(WheatClock * pClock = GetSystemClock()) { m_pClock = pClock; }
+	~WheatTls();
+
+	WheatTls(const WheatTls &) = delete;
+	WheatTls & operator=(const WheatTls &) = delete;
+
+	//  PFX ļ֤˽ԿsessionMinutes Ϊ TLS ỰڻﱣãԺԸã
+	bool Init(const char * certificatePath, const char * password, int sessionMinutes);
+	inline bool IsEnabled() { return m_enabled; }
+
+	//  TLS ϶ģ÷ recv һ 0 ʾӹرգSOCKET_ERROR ʾ
+	// ֻûɻһ¼ûʱ WHEATTLS_WOULD_BLOCKҪԷֱӷȥ
+	// ֻ select ˵ɶ HasPlain() Ϊ true ʱŵã socket ʱûҲ WHEATTLS_WOULD_BLOCK
+	int Read(WheatTlsConnection & connection, SOCKET sock, char * buf, size_t len);
+
+	// ϴνĻûȡ꣬select ѣ¼ѭҪԼȡ
+	static inline bool HasPlain(const WheatTlsConnection & connection) { return connection.plainOffset < connection.plain.size(); }
+
+	// ϣ Flush() ʱһ
+	void Queue(WheatTlsConnection & connection, const char * buf, size_t len);
+
+	// ŵļܳ TLS ¼ȥֻûɵĻţʧܷ false
+	bool Flush(WheatTlsConnection & connection, SOCKET sock);
+
+	// ôȥĬֱ sendsocket ǷĻߣһηĲ
+	using Sender = std::function<bool(SOCKET sock, const char * buf, size_t len)>;
+	inline void SetSender(Sender sender) { m_sender = sender; }
+
+	// ӶϿԺͷ
+	void Release(WheatTlsConnection & connection);
+
+	void PrintStats(std::string * pOut);
+
+private:
+
+	// ֣ʧܷ false
+	bool Handshake(WheatTlsConnection & connection, SOCKET sock);
+	// յľ⿪Ž plainʧܷ false
+	bool Decrypt(WheatTlsConnection & connection);
+	// ģ m_sender ֱ send
+	bool SendCipher(SOCKET sock, const char * buf, size_t len);
+
+	WheatClock * m_pClock = nullptr;
+	Sender m_sender;
+
+	bool m_enabled = false;
+	HCERTSTORE m_certificateStore = nullptr;
+	PCCERT_CONTEXT m_pCertificate = nullptr;
+	CredHandle m_credentials;
+
+	// ʱõĻ
+	std::vector<char> m_cipher;
+
+	unsigned long long m_handshakes = 0;
+	unsigned long long m_resumedHandshakes = 0;
+	unsigned long long m_failedHandshakes = 0;
+	unsigned long long m_queuedMessages = 0;
+	unsigned long long m_encryptedRecords = 0;
+	unsigned long long m_encryptedBytes = 0;
+	unsigned long long m_decryptedBytes = 0;
+	long long m_encryptNs = 0;
+	long long m_decryptNs = 0;
+};
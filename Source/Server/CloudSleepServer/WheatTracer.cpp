@@ -0,0 +1,152 @@
+#include "WheatTracer.h"
+#include "ProjectCommon.h"
+#include "WheatClock.h"
+
+#include <cstdio>
+
+void WheatTracer::SetSampleEvery(int sampleEvery)
+{
+	m_sampleEvery = MAX(sampleEvery, 0);
+	m_countdown = NextCountdown();
+}
+
+int WheatTracer::NextCountdown()
+{
+	if(m_sampleEvery <= 1) {
+		return m_sampleEvery;
+	}
+
+	// xorshiftУȥȫֵ rand()
+	m_random ^= m_random << 13;
+	m_random ^= m_random >> 17;
+	m_random ^= m_random << 5;
+	return 1 + static_cast<int>(m_random % static_cast<unsigned int>(2 * m_sampleEvery - 1));
+}
+
+long long WheatTracer::Now()
+{
+	// ָʱͳһʵӣⱨʱԱģʱҲܲʵĿ
+	return GetSystemClock()->NowNs();
+}
+
+bool WheatTracer::BeginMessage(long long recvNs)
+{
+	m_pCurrent = nullptr;
+	if(m_sampleEvery == 0) {
+		return false;
+	}
+	if(--m_countdown > 0) {
+		return false;
+	}
+	m_countdown = NextCountdown();
+
+	// һȦ׷ٵѾѻռˣͻἷûģһȦ
+	if(m_pendingNum >= m_records.size()) {
+		return false;
+	}
+
+	m_pCurrent = & m_records[m_next];
+	*m_pCurrent = WheatTraceRecord();
+	m_pCurrent->startNs = Now();
+	m_pCurrent->recvNs = recvNs != 0 ? recvNs : m_pCurrent->startNs;
+
+	m_next = (m_next + 1) % m_records.size();
+	m_recordNum = MIN(m_recordNum + 1, m_records.size());
+	m_pendingNum++;
+	m_tracedNum++;
+	return true;
+}
+
+void WheatTracer::MarkParsed(WheatCommandType type, int sleeperId)
+{
+	if(m_pCurrent == nullptr) {
+		return;
+	}
+	m_pCurrent->type = type;
+	m_pCurrent->sleeperId = sleeperId;
+	m_pCurrent->parsedNs = Now();
+}
+
+void WheatTracer::MarkHandled()
+{
+	if(m_pCurrent != nullptr) {
+		m_pCurrent->handledNs = Now();
+	}
+}
+
+void WheatTracer::EndMessage()
+{
+	if(m_pCurrent != nullptr) {
+		m_pCurrent->sentNs = Now();
+		m_pCurrent = nullptr;
+	}
+}
+
+void WheatTracer::EndLoopIteration(WheatMetrics & metrics)
+{
+	m_pCurrent = nullptr;
+	if(m_pendingNum == 0) {
+		return;
+	}
+
+	long long nowNs = Now();
+	size_t index = (m_next + m_records.size() - m_pendingNum) % m_records.size();
+	for(size_t i = 0; i < m_pendingNum; i++) {
+		WheatTraceRecord & record = m_records[index];
+		record.flushedNs = nowNs;
+		metrics.RecordLatency(record.type, record.flushedNs - record.recvNs);
+		index = (index + 1) % m_records.size();
+	}
+	m_pendingNum = 0;
+}
+
+// ʱд Chrome trace Ҫ΢
+static void AppendEvent(std::string & out, bool & first, const char * name, const char * cat, long long beginNs, long long endNs, int sleeperId)
+{
+	if(beginNs == 0 || endNs < beginNs) {
+		return;
+	}
+
+	char event[256];
+	snprintf(event, sizeof(event), "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld.%03lld,\"dur\":%lld.%03lld,\"pid\":1,\"tid\":%d}",
+		first ? "" : ",", name, cat, beginNs / 1000, beginNs % 1000, (endNs - beginNs) / 1000, (endNs - beginNs) % 1000, sleeperId);
+	out += event;
+	first = false;
+}
+
+void WheatTracer::WriteChromeTrace(std::string & out)
+{
+	WheatCommandProgrammer commandProgrammer;
+
+	out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+
+	// ɵһдµһûȵһȦĲд
+	size_t index = (m_next + m_records.size() - m_recordNum) % m_records.size();
+	for(size_t i = 0; i < m_recordNum; i++) {
+		WheatTraceRecord & record = m_records[index];
+		index = (index + 1) % m_records.size();
+		if(record.flushedNs == 0) {
+			continue;
+		}
+
+		// ϢһΣ°վֳɼΣͬһ tid˯ͣʱŵĶ Chrome ử
+		AppendEvent(out, first, commandProgrammer.GetCommandTypeName(record.type), "message", record.recvNs, record.flushedNs, record.sleeperId);
+		AppendEvent(out, first, "queue", "stage", record.recvNs, record.startNs, record.sleeperId);
+		AppendEvent(out, first, "parse", "stage", record.startNs, record.parsedNs, record.sleeperId);
+		AppendEvent(out, first, "handle", "stage", record.parsedNs, record.handledNs, record.sleeperId);
+		AppendEvent(out, first, "encode", "stage", record.handledNs, record.encodedNs, record.sleeperId);
+		AppendEvent(out, first, "send", "stage", MAX(record.handledNs, record.encodedNs), record.sentNs, record.sleeperId);
+		AppendEvent(out, first, "flush", "stage", record.sentNs, record.flushedNs, record.sleeperId);
+	}
+
+	out += "\n]}\n";
+}
+
+void WheatTracer::Reset()
+{
+	m_next = 0;
+	m_recordNum = 0;
+	m_pendingNum = 0;
+	m_pCurrent = nullptr;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "WheatCommand.h"
+#include "WheatMetrics.h"
+
+#include <vector>
+#include <string>
+
+// ׷ټ¼ Chrome trace ʱãԺµһɵһ
+#define WHEATTRACER_RECORD_NUM 4096
+
+// һ׷ٵϢӽŵͳŵÿһվλ 루ʵӣûվΪ 0
+struct WheatTraceRecord {
+	WheatCommandType type = WheatCommandType::unknown;
+	int sleeperId = -1;
+	long long recvNs = 0;		//  socket յղʱĻͬ startNs
+	long long startNs = 0;		// ܼҿʼ
+	long long parsedNs = 0;		// 
+	long long handledNs = 0;	// ˴
+	long long encodedNs = 0;	// һα֡
+	long long sentNs = 0;		// Աһֱ꣨д socketŽ TLSءߵĶ飩
+	long long flushedNs = 0;	// һȦŶӵҲȥˣһλ˯յ
+};
+
+// ׷ԱÿϢһڷÿһվʱ䣬һ move$ ӽŵһλ˯յ׻˶
+// յͳŵܺʱָͽͳԱ(WheatMetrics) ǳɷֲļ¼Ե Chrome trace(chrome://tracingPerfetto) һվһվؿ
+// ͬһʱֻ׷һϢܼҴϢһһģύ
+class WheatTracer {
+public:
+	WheatTracer() { m_records.resize(WHEATTRACER_RECORD_NUM); }
+
+	// ƽÿϢ׷һ0 ʾ׷
+	//  1  2*sampleEvery-1 ֮ͬһָλ˯ move  chat ʱ̶һһԶ move
+	void SetSampleEvery(int sampleEvery);
+	inline int GetSampleEvery() { return m_sampleEvery; }
+
+	// ܼҿʼһϢrecvNs Ϊյʱ䣨֪Ļ 0˷ trueҪһվһվش򿨣 EndMessage()
+	bool BeginMessage(long long recvNs);
+	inline bool IsTracing() { return m_pCurrent != nullptr; }
+
+	// 򿨣û׷ٵʱʲô
+	void MarkParsed(WheatCommandType type, int sleeperId);
+	void MarkHandled();
+	inline void MarkEncoded() { if(m_pCurrent != nullptr && m_pCurrent->encodedNs == 0) { m_pCurrent->encodedNs = Now(); } }
+
+	// ϢԱĶˣһȦܺʱ
+	void EndMessage();
+
+	// ¼ѭתһȦһȦ׷ٵϢ͵ˣܺʱǸ metrics
+	void EndLoopIteration(WheatMetrics & metrics);
+
+	// һ׷˶Ŷ¼
+	inline unsigned long long GetTracedNum() { return m_tracedNum; }
+	inline size_t GetRecordNum() { return m_recordNum; }
+
+	// ŵļ¼ Chrome trace  JSON ʽд outÿϢһУ°վֳɼ
+	void WriteChromeTrace(std::string & out);
+
+	// ŵļ¼
+	void Reset();
+
+private:
+
+	long long Now();
+
+	// һθ
+	int NextCountdown();
+
+	int m_sampleEvery = 0;
+	int m_countdown = 0;
+	unsigned int m_random = 2463534242u;
+
+	// εļ¼m_next ΪһдҲɵһڵλ
+	std::vector<WheatTraceRecord> m_records;
+	size_t m_next = 0;
+	size_t m_recordNum = 0;
+
+	// ׷ٵԼһȦ׷ٹûȵһȦм
+	WheatTraceRecord * m_pCurrent = nullptr;
+	size_t m_pendingNum = 0;
+
+	unsigned long long m_tracedNum = 0;
+};
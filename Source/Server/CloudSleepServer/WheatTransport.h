@@ -0,0 +1,18 @@
+#pragma once
+
+#include <winsock.h>
+
+// ԱֻϢ˯ȥϢдʲôһŲ
+// TCPԱ(WheatTCPServer) һλԱڴػԱ(WheatLoopbackTransport) ҲһλԱ
+// ܼ(WheatRoom) ֻϴԱ socketͬһ׷߼ʵϣҲڴ
+class WheatTransport {
+public:
+	virtual ~WheatTransport() {}
+
+	// Ŀӷ bufǷͳɹ
+	// ䷢ buf һȦʱֿһȦ֮ǰᱻдԱ԰ (buf, len) ϳͬһ㲥
+	virtual bool Send(SOCKET destSocket, const char * buf, size_t len) = 0;
+
+	// ϿĿӣӱͲڣѾϿ false
+	virtual bool Disconnect(SOCKET sock) = 0;
+};
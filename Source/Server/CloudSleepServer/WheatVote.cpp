@@ -11,7 +11,7 @@ WheatVote::~WheatVote()
 
 void WheatVote::Init(int sleeperNum, int _voteKickSleeperId)
 {
-	m_time = time(NULL);
+	m_startMs = m_pClock->NowMs();
 
 	m_isVoting = false;
 
@@ -21,7 +21,7 @@ void WheatVote::Init(int sleeperNum, int _voteKickSleeperId)
 
 	m_sleepersVoteNumMax = sleeperNum;
 	m_pArrSleepersVoteAnwsers = new int[sleeperNum];
-	memset(m_pArrSleepersVoteAnwsers, 0, sleeperNum);
+	memset(m_pArrSleepersVoteAnwsers, 0, sizeof(int) * sleeperNum);
 
 	m_voteKickSleeperId = _voteKickSleeperId;
 }
@@ -55,8 +55,7 @@ bool WheatVote::AddRefuse(int sleeperId)
 
 int WheatVote::GetPastTime()
 {
-	time_t t = time(NULL);
-	int sec = static_cast<int>(difftime(t, m_time));
+	int sec = static_cast<int>((m_pClock->NowMs() - m_startMs) / 1000);
 
 	return sec;
 }
@@ -1,11 +1,13 @@
 #pragma once
 
-#include <time.h>
+#include "WheatClock.h"
 
 class WheatVote {
 public:
 	virtual ~WheatVote();
 
+	inline void SetClock(WheatClock * pClock) { m_pClock = pClock; }
+
 	void Init(int sleeperNum, int _voteKickSleeperId);
 
 	bool AddAgree(int sleeperId);
@@ -22,7 +24,10 @@ public:
 	int m_voteKickSleeperId = -1;
 
 private:
-	time_t m_time = time(NULL);
+	WheatClock * m_pClock = GetSystemClock();
+
+	// ͶƱʼʱ䣬λ 
+	long long m_startMs = 0;
 
 	bool m_isVoting = false;
 
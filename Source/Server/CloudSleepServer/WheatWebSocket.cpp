@@ -0,0 +1,306 @@
+#include "WheatWebSocket.h"
+#include "ProjectCommon.h"
+
+#include <cstring>
+#include <cctype>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WHEAT_WEBSOCKET_X86
+#endif
+
+#ifdef WHEAT_WEBSOCKET_X86
+#include <emmintrin.h>
+#endif
+
+// ʱͿͻ˸ key ƴһ SHA-1 Ĺ̶ַRFC 6455 涨
+#define WHEATWEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+//  request ĳͷֵͷֲִСдҲؿַ
+static std::string FindHeader(const std::string & request, const char * name)
+{
+	size_t nameLen = strlen(name);
+	size_t lineStart = request.find("\r\n");
+	while(lineStart != std::string::npos && lineStart + 2 < request.size()) {
+		lineStart += 2;
+		size_t lineEnd = request.find("\r\n", lineStart);
+		if(lineEnd == std::string::npos) {
+			break;
+		}
+
+		if(lineEnd - lineStart > nameLen && request[lineStart + nameLen] == ':') {
+			bool same = true;
+			for(size_t i = 0; i < nameLen; i++) {
+				if(tolower(static_cast<unsigned char>(request[lineStart + i])) != tolower(static_cast<unsigned char>(name[i]))) {
+					same = false;
+					break;
+				}
+			}
+			if(same) {
+				size_t valueStart = lineStart + nameLen + 1;
+				while(valueStart < lineEnd && request[valueStart] == ' ') {
+					valueStart++;
+				}
+				return request.substr(valueStart, lineEnd - valueStart);
+			}
+		}
+		lineStart = lineEnd;
+	}
+	return "";
+}
+
+WheatWebSocket::HandshakeResult WheatWebSocket::Handshake(const std::string & request, std::string * pResponse)
+{
+	if(request.find("\r\n\r\n") == std::string::npos) {
+		return request.size() < WHEATWEBSOCKET_HANDSHAKE_SIZE ? HandshakeResult::Incomplete : HandshakeResult::Bad;
+	}
+
+	std::string key = FindHeader(request, "Sec-WebSocket-Key");
+	if(request.compare(0, 4, "GET ") != 0 || key.empty()) {
+		return HandshakeResult::Bad;
+	}
+
+	key += WHEATWEBSOCKET_GUID;
+	unsigned char digest[20];
+	Sha1(key.data(), key.size(), digest);
+
+	*pResponse = "HTTP/1.1 101 Switching Protocols\r\n"
+		"Upgrade: websocket\r\n"
+		"Connection: Upgrade\r\n"
+		"Sec-WebSocket-Accept: " + Base64(digest, sizeof(digest)) + "\r\n\r\n";
+	return HandshakeResult::Done;
+}
+
+std::string WheatWebSocket::GetPath(const std::string & request)
+{
+	if(request.compare(0, 4, "GET ") != 0) {
+		return "";
+	}
+	size_t pathEnd = request.find_first_of(" ?\r", 4);
+	if(pathEnd == std::string::npos) {
+		return "";
+	}
+	return request.substr(4, pathEnd - 4);
+}
+
+size_t WheatWebSocket::Decode(char * buf, size_t len, size_t maxPayloadLen, size_t * pConsumed, std::string * pControlReply, bool * pClosed)
+{
+	size_t in = 0;		// һ֡
+	size_t out = 0;		// ϢдԶᳬ in
+	*pClosed = false;
+
+	while(len - in >= 2) {
+		unsigned char b0 = static_cast<unsigned char>(buf[in]);
+		unsigned char b1 = static_cast<unsigned char>(buf[in + 1]);
+		bool fin = (b0 & 0x80) != 0;
+		int opcode = b0 & 0x0F;
+		bool masked = (b1 & 0x80) != 0;
+
+		size_t payloadLen = b1 & 0x7F;
+		size_t headerLen = 2;
+		if(payloadLen == 126) {
+			if(len - in < 4) {
+				break;
+			}
+			payloadLen = (static_cast<size_t>(static_cast<unsigned char>(buf[in + 2])) << 8) | static_cast<unsigned char>(buf[in + 3]);
+			headerLen = 4;
+		} else if(payloadLen == 127) {
+			if(len - in < 10) {
+				break;
+			}
+			unsigned long long longLen = 0;
+			for(int i = 0; i < 8; i++) {
+				longLen = (longLen << 8) | static_cast<unsigned char>(buf[in + 2 + i]);
+			}
+			payloadLen = longLen > maxPayloadLen ? maxPayloadLen + 1 : static_cast<size_t>(longLen);
+			headerLen = 10;
+		}
+
+		// ͻ˷֡룻̫֡ỰĻҲŲ
+		if(masked == false || payloadLen > maxPayloadLen) {
+			*pClosed = true;
+			break;
+		}
+
+		if(len - in < headerLen + 4 + payloadLen) {
+			break;
+		}
+
+		const unsigned char * mask = reinterpret_cast<const unsigned char *>(buf + in + headerLen);
+		char * payload = buf + in + headerLen + 4;
+		Unmask(payload, payloadLen, mask);
+		in += headerLen + 4 + payloadLen;
+
+		switch(opcode) {
+			case 0x0:	// ֡
+			case 0x1:	// ı֡
+			case 0x2:	// ֡
+				// ֡ͷ 6 ֽڣŲǰȥԺ滹ţ '\0' ȵû
+				memmove(buf + out, payload, payloadLen);
+				out += payloadLen;
+				if(fin && out > 0 && buf[out - 1] != '\0') {
+					buf[out++] = '\0';
+				}
+				break;
+
+			case 0x8:	// close
+				*pClosed = true;
+				*pConsumed = in;
+				return out;
+
+			case 0x9:	// pingԭһ pong
+			{
+				char header[WHEATWEBSOCKET_MAX_HEADER_SIZE];
+				size_t replyHeaderLen = WriteHeader(header, payloadLen);
+				header[0] = static_cast<char>(0x8A);
+				pControlReply->append(header, replyHeaderLen);
+				pControlReply->append(payload, payloadLen);
+			}
+			break;
+
+			case 0xA:	// pong
+				break;
+
+			default:
+				*pClosed = true;
+				*pConsumed = in;
+				return out;
+		}
+	}
+
+	*pConsumed = in;
+	return out;
+}
+
+size_t WheatWebSocket::WriteHeader(char * dest, size_t payloadLen)
+{
+	// ˷֡룬һ FIN Ķ֡
+	dest[0] = static_cast<char>(0x82);
+	if(payloadLen < 126) {
+		dest[1] = static_cast<char>(payloadLen);
+		return 2;
+	}
+	if(payloadLen < 65536) {
+		dest[1] = 126;
+		dest[2] = static_cast<char>(payloadLen >> 8);
+		dest[3] = static_cast<char>(payloadLen);
+		return 4;
+	}
+	dest[1] = 127;
+	for(int i = 0; i < 8; i++) {
+		dest[2 + i] = static_cast<char>(static_cast<unsigned long long>(payloadLen) >> (56 - i * 8));
+	}
+	return 10;
+}
+
+void WheatWebSocket::Unmask(char * p, size_t len, const unsigned char mask[4], size_t offset)
+{
+	unsigned char rotated[4];
+	for(int i = 0; i < 4; i++) {
+		rotated[i] = mask[(offset + i) & 3];
+	}
+
+	size_t i = 0;
+#ifdef WHEAT_WEBSOCKET_X86
+	// 16  4 ÿ 16 ֽͬһһ
+	int mask32;
+	memcpy(& mask32, rotated, 4);
+	const __m128i mask128 = _mm_set1_epi32(mask32);
+	for(; i + 16 <= len; i += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), _mm_xor_si128(block, mask128));
+	}
+#endif
+	for(; i < len; i++) {
+		p[i] ^= rotated[i & 3];
+	}
+}
+
+static inline unsigned int RotateLeft(unsigned int value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+void WheatWebSocket::Sha1(const char * data, size_t len, unsigned char digest[20])
+{
+	unsigned int h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+	//  0x80ɸ 0  64 λĳȣճ 64 ֽڵֵ key ̣ܶһηŵ
+	std::string message(data, len);
+	message.push_back(static_cast<char>(0x80));
+	while(message.size() % 64 != 56) {
+		message.push_back('\0');
+	}
+	unsigned long long bitLen = static_cast<unsigned long long>(len) * 8;
+	for(int i = 7; i >= 0; i--) {
+		message.push_back(static_cast<char>(bitLen >> (i * 8)));
+	}
+
+	for(size_t chunk = 0; chunk < message.size(); chunk += 64) {
+		unsigned int w[80];
+		for(int i = 0; i < 16; i++) {
+			const unsigned char * p = reinterpret_cast<const unsigned char *>(message.data() + chunk + i * 4);
+			w[i] = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+		}
+		for(int i = 16; i < 80; i++) {
+			w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+
+		unsigned int a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+		for(int i = 0; i < 80; i++) {
+			unsigned int f, k;
+			if(i < 20) {
+				f = (b & c) | (~b & d);
+				k = 0x5A827999;
+			} else if(i < 40) {
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			} else if(i < 60) {
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8F1BBCDC;
+			} else {
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+			unsigned int temp = RotateLeft(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = RotateLeft(b, 30);
+			b = a;
+			a = temp;
+		}
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+		h[4] += e;
+	}
+
+	for(int i = 0; i < 5; i++) {
+		digest[i * 4] = static_cast<unsigned char>(h[i] >> 24);
+		digest[i * 4 + 1] = static_cast<unsigned char>(h[i] >> 16);
+		digest[i * 4 + 2] = static_cast<unsigned char>(h[i] >> 8);
+		digest[i * 4 + 3] = static_cast<unsigned char>(h[i]);
+	}
+}
+
+std::string WheatWebSocket::Base64(const unsigned char * data, size_t len)
+{
+	static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string res;
+	for(size_t i = 0; i < len; i += 3) {
+		unsigned int group = data[i] << 16;
+		if(i + 1 < len) {
+			group |= data[i + 1] << 8;
+		}
+		if(i + 2 < len) {
+			group |= data[i + 2];
+		}
+		res.push_back(table[(group >> 18) & 63]);
+		res.push_back(table[(group >> 12) & 63]);
+		res.push_back(i + 1 < len ? table[(group >> 6) & 63] : '=');
+		res.push_back(i + 2 < len ? table[group & 63] : '=');
+	}
+	return res;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// ֽڣֱӶϿ
+#define WHEATWEBSOCKET_HANDSHAKE_SIZE 4096
+
+// ˷֡ͷֽڣ2 ֽ + 8 ֽڵĳȣ
+#define WHEATWEBSOCKET_MAX_HEADER_SIZE 10
+
+// һ WebSocket ֺ֡ҪסĶ
+struct WheatWebSocketConnection {
+	bool handshakeDone = false;
+	long long acceptMs = 0;		// ӽʱ䣬 handshake_timeout_ms û־ͶϿ
+	std::string ipAddress;
+	std::string request;		// ûĲ
+	std::vector<char> partial;	// һ֡´ recv ֮ǰȷŻؽջͷ
+};
+
+// WebSocket Ա˯ҲֱپĴ
+// Ժ˯ͷÿһ֡ڻỰĽջ͵ؽ⿪ȥ֡ͷ룩ֽںԭͻ˷һģһķ֡Ự䶼ø
+// ˯͵Ϣǰһ֡ͷУ֡װľԭͻյ "˯id\0Ϣ\0"
+class WheatWebSocket {
+public:
+
+	enum class HandshakeResult {
+		Incomplete,		// û
+		Done,			// ֳɹ*pResponse ΪҪȥĻظ
+		Bad				// ǺϷ WebSocket 
+	};
+
+	// ˵Ļ 101 ظ
+	static HandshakeResult Handshake(const std::string & request, std::string * pResponse);
+
+	// · "GET /watch HTTP/1.1"  "/watch"ҪʺźĲ
+	static std::string GetPath(const std::string & request);
+
+	// ͵ؽ⿪ buf ֡ϢŲ buf ͷؽֽ
+	// ͻ˵һϢFIN ֡ĩβû '\0' Ļһı֡ "move$320,300" Ҳ
+	// *pConsumed Ϊ֡ռ˶ֽڣʣµһ֡ping Ļظ׷ӵ *pControlReply 
+	// յ closeû֡߱ maxPayloadLen ֡ʱ *pClosed Ϊ trueݶٴ
+	static size_t Decode(char * buf, size_t len, size_t maxPayloadLen, size_t * pConsumed, std::string * pControlReply, bool * pClosed);
+
+	// дһ˷Ķ֡֡ͷ֡ͷֽ
+	static size_t WriteHeader(char * dest, size_t payloadLen);
+
+	//  4 ֽڵ͵offset Ϊ p[0] λ
+	static void Unmask(char * p, size_t len, const unsigned char mask[4], size_t offset = 0);
+
+private:
+	static void Sha1(const char * data, size_t len, unsigned char digest[20]);
+	static std::string Base64(const unsigned char * data, size_t len);
+};
@@ -5,13 +5,56 @@
 #include "ProjectCommon.h"
 #include "WheatTCPServer.h"
 #include "WheatCommand.h"
+#include "WheatConfig.h"
+#include "WheatDirectory.h"
+#include "WheatGateway.h"
+#include "WheatAffinity.h"
+#include "WheatSlab.h"
+#include "WheatSimulation.h"
 
-#define MYPORT 11451
-
-int main() {
+int main(int argc, char * argv[]) {
 	system("chcp 65001"); // Ϊ Unicode(UTF-8 ǩ) - ҳ 65001
 
-	WheatTCPServer myServer(MYPORT);
+	// ˿ڡСƶļϵ --=ֵ ʱ
+	WheatConfig config;
+	config.Load(argc, argv);
+
+	// ģʽ¼ѭ߳ϣȰ̶߳ס֮Ҫڴڵ NUMA ڵ
+	if(config.eventLoopCpu != -1 && WheatAffinity::PinCurrentThread(config.eventLoopCpu)) {
+		int numaNode = WheatAffinity::GetNumaNode(config.eventLoopCpu);
+		printf("Event Loop Pinned To CPU %d, NUMA Node %d.\n", config.eventLoopCpu, numaNode);
+		if(config.numaLocalMemory) {
+			WheatSlab::SetNumaNode(numaNode);
+		}
+	}
+
+	// ϰ˿ڣڴѷһ˳ûͨĻ˳벻Ϊ 0
+	if(config.mode == "simulate") {
+		WheatSimulation simulation;
+		return simulation.Run() ? 0 : 1;
+	}
+
+	// ֻ̨¼ڵĸأ
+	if(config.mode == "directory") {
+		WheatDirectory directory;
+		if(directory.Init(config.directoryListenAddress.c_str(), config.directoryPort, config.linkSecret, config.busPort, config.busListenAddress.c_str())) {
+			directory.Run();
+		}
+		directory.Close();
+		return 0;
+	}
+
+	// ֻ˯͵ӣϢתķ
+	if(config.mode == "gateway") {
+		WheatGateway gateway(& config);
+		if(gateway.Init()) {
+			gateway.Run();
+		}
+		gateway.Close();
+		return 0;
+	}
+
+	WheatTCPServer myServer(& config);
 	
 	myServer.Run();
 